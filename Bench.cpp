@@ -0,0 +1,258 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Bench.cpp
+ * @brief      Benchmarks of messageArrived(), the mailboxes, m3pi::motor() 
+ *             and the fixed-point conversions.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Bench.h"
+#include "rtos.h"
+#include "m3pi.h"
+#include "MQTTmbed.h"
+#include "MQTTNetwork.h"
+#include "MQTTClient.h"
+#include "MailMsg.h"
+#include "LEDThread.h"
+#include "Range.h"
+#include "FixedPoint.h"
+#include "Grid.h"
+#include "Ingress.h"
+
+extern m3pi m3pi;
+extern void messageArrived(MQTT::MessageData& md);
+
+typedef struct {
+    const char *name;
+    void (*run)();
+} BenchCase;
+
+/* keeps the compiler from optimizing the benchmarked work away */
+static volatile uint32_t sink;
+static volatile float voltage = 0.5f;
+static volatile uint16_t rawRange = 32768;
+static volatile uint16_t angle = 12345;
+
+static void benchEmpty()
+{
+}
+
+/* No executor runs in a bench build. The benchmarks run the workers' events
+   themselves, with handlers that do nothing. */
+static unsigned char benchQueueBuffer[4 * EVENTS_EVENT_SIZE];
+static EventQueue benchQueue(sizeof(benchQueueBuffer), benchQueueBuffer);
+static EventWorker<MailMsg, 4> benchWorker;
+
+static void benchHandler(MailMsg *msg)
+{
+}
+
+/* messageArrived() dispatching to the led worker, and the executor's side of
+   the mailbox. The ingress buckets are still checked, but admit everything 
+   (see benchRun()). */
+static void benchMessageArrived()
+{
+    char payload[2] = { FWD_TO_LED_THR, LED_ON_ONE_SEC };
+    MQTTString topicName = MQTTString_initializer;
+    MQTT::Message message;
+
+    message.qos = MQTT::QOS0;
+    message.retained = false;
+    message.dup = false;
+    message.payload = (void *)payload;
+    message.payloadlen = sizeof(payload);
+
+    MQTT::MessageData md(topicName, message);
+    messageArrived(md);
+    benchQueue.dispatch(0);
+}
+
+/* alloc/put/get/free of a mailbox in the same thread */
+static void benchMailbox()
+{
+    static Mail<MailMsg, 4> mailbox;
+    MailMsg *msg;
+    osEvent evt;
+
+    msg = mailbox.alloc();
+    msg->content[0] = 0;
+    msg->length = 1;
+    mailbox.put(msg);
+    evt = mailbox.get(0);
+    mailbox.free((MailMsg *)evt.value.p);
+}
+
+/* alloc/put of a worker's mailbox and the event that handles it, like the 
+   executor runs it */
+static void benchWorkerRoundtrip()
+{
+    MailMsg *msg = benchWorker.alloc();
+
+    msg->content[0] = 0;
+    msg->length = 1;
+    benchWorker.put(msg);
+    benchQueue.dispatch(0);
+}
+
+/* opcode and speed encoding of both motors, replayed instead of sent */
+static void benchMotor()
+{
+    m3pi.left_motor(-25);
+    m3pi.right_motor(25);
+}
+
+/* the distance conversion LEDThread used to do in double */
+static void benchDistanceDouble()
+{
+    double distance = voltage / 0.0098;
+    sink = (uint32_t)distance;
+}
+
+/* the same conversion with the range sensor's calibration table */
+static void benchDistance()
+{
+    sink = rangeRawToMm(rawRange);
+}
+
+static void benchSinCos()
+{
+    sink = sinQ15(angle) + cosQ15(angle);
+}
+
+/* the longest ray the grid takes, diagonal so both axes step. Must stay 
+   well within a motion tick. Cast into a scratch map, the robot's grid is 
+   the motion thread's and the planner's. */
+static void benchGridRay()
+{
+    static GridMap scratch;
+    MotionPose pose = { 0, 0, 8192, 0 };
+
+    gridRay(&scratch, &pose, GRID_MAX_RANGE_MM);
+}
+
+static const BenchCase benchCases[] = {
+    { "messageArrived", benchMessageArrived },
+    { "mailbox_roundtrip", benchMailbox },
+    { "worker_roundtrip", benchWorkerRoundtrip },
+    { "m3pi_motor", benchMotor },
+    { "distance_double", benchDistanceDouble },
+    { "distance_fixed", benchDistance },
+    { "sin_cos_q15", benchSinCos },
+    { "grid_ray", benchGridRay }
+};
+
+static uint32_t heapAllocCount()
+{
+#ifdef MBED_HEAP_STATS_ENABLED
+    mbed_stats_heap_t stats;
+    mbed_stats_heap_get(&stats);
+    return stats.alloc_cnt;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief      Returns the fewest cycles per BENCH_ITERATIONS calls of run() 
+ *             over BENCH_REPEATS repeats.
+ */
+static uint32_t benchCycles(void (*run)(), uint32_t *allocs)
+{
+    uint32_t best = 0xFFFFFFFF;
+    uint32_t start;
+    uint32_t cycles;
+    uint32_t allocStart;
+
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        allocStart = heapAllocCount();
+        start = DWT->CYCCNT;
+        for (int i = 0; i < BENCH_ITERATIONS; i++)
+            run();
+        cycles = DWT->CYCCNT - start;
+        *allocs = heapAllocCount() - allocStart;
+
+        if (cycles < best)
+            best = cycles;
+    }
+
+    return best;
+}
+
+void benchRun()
+{
+    uint32_t overhead;
+    uint32_t cycles;
+    uint32_t allocs;
+    uint32_t mhz = SystemCoreClock / 1000000;
+
+    /* start the DWT cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    m3pi.start_replay(NULL, 0);
+
+    /* far more messages than any rate limit allows, none may be dropped */
+    ingressSetUnlimited(true);
+    getLEDThreadMailbox()->start(&benchQueue, benchHandler);
+    benchWorker.start(&benchQueue, benchHandler);
+
+    overhead = benchCycles(benchEmpty, &allocs);
+
+    printf("bench: %d iterations, %d repeats, %lu MHz\n", BENCH_ITERATIONS, 
+           BENCH_REPEATS, (unsigned long)mhz);
+
+    for (size_t i = 0; i < sizeof(benchCases) / sizeof(benchCases[0]); i++) {
+        cycles = benchCycles(benchCases[i].run, &allocs);
+        cycles = cycles > overhead ? cycles - overhead : 0;
+
+        /* allocs/op with two decimals */
+        allocs = allocs * 100 / BENCH_ITERATIONS;
+        printf("bench: %s %lu %lu %lu.%02lu\n", benchCases[i].name,
+               (unsigned long)(cycles / BENCH_ITERATIONS),
+               (unsigned long)((uint64_t)cycles * 1000 / mhz / BENCH_ITERATIONS),
+               (unsigned long)(allocs / 100), (unsigned long)(allocs % 100));
+    }
+
+    m3pi.stop_replay();
+    ingressSetUnlimited(false);
+    printf("bench: done\n");
+}
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Bench.h
+ * @brief      Cycle counting microbenchmarks of the firmware's hot paths.
+ *
+ *             Benchmarks run on the LPC1768 itself and count cycles with the
+ *             Cortex-M3 DWT cycle counter. They are only built into the 
+ *             firmware if M3PI_BENCH is defined. Build with heap statistics 
+ *             to also count allocations:
+ *
+ *                 mbed compile -DM3PI_BENCH -DMBED_HEAP_STATS_ENABLED=1
+ *
+ *             A bench build runs every benchmark at boot instead of the 
+ *             application and prints one line per benchmark:
+ *
+ *                 bench: <name> <cycles/op> <ns/op> <allocs/op>
+ *
+ *             followed by "bench: done". bench_compare.py collects these 
+ *             lines and compares them against earlier commits.
+ *
+ *             Each benchmark runs BENCH_ITERATIONS times per repeat and the 
+ *             fastest of BENCH_REPEATS repeats is reported, minus the cost of
+ *             the benchmark loop itself. Nothing else runs in a bench build, 
+ *             so the numbers repeat to within a few cycles.
+ *
+ *             The benchmarks that need no hardware are also built for the
+ *             computer, against stand-ins for the RTOS and the serial port 
+ *             (see host/bench_host.cpp).
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "mbed.h"
+
+#define BENCH_ITERATIONS    100
+#define BENCH_REPEATS       5
+
+/**
+ * @brief      Runs all benchmarks and prints the results. Call it before any
+ *             other thread is started and before the 3pi is reset. The 3pi 
+ *             serial link is replaced by m3pi's replay mode (see m3pi.h), so
+ *             the motors do not move.
+ */
+void benchRun();
+
+#endif /* _BENCH_H_ */
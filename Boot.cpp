@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Boot.cpp
+ * @brief      Implementation of the boot timeline recorder.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Boot.h"
+#include "FlightRecorder.h"
+
+static const char *stageNames[BOOT_STAGE_COUNT] = {
+    "start",
+    "robot reset",
+    "sensors warm",
+    "control up",
+    "wifi up",
+    "mqtt up",
+    "first command"
+};
+
+static Timer bootTimer;
+static volatile uint32_t stageMs[BOOT_STAGE_COUNT] = {
+    BOOT_NOT_REACHED, BOOT_NOT_REACHED, BOOT_NOT_REACHED, BOOT_NOT_REACHED,
+    BOOT_NOT_REACHED, BOOT_NOT_REACHED, BOOT_NOT_REACHED
+};
+
+void bootMark(int stage)
+{
+    if (stage < 0 || stage >= BOOT_STAGE_COUNT 
+        || stageMs[stage] != BOOT_NOT_REACHED)
+        return;
+
+    if (stage == BOOT_START)
+        bootTimer.start();
+
+    stageMs[stage] = bootTimer.read_ms();
+    frRecord(FR_EVT_BOOT_STAGE, stage, 0);
+}
+
+bool bootReached(int stage)
+{
+    return stage >= 0 && stage < BOOT_STAGE_COUNT 
+           && stageMs[stage] != BOOT_NOT_REACHED;
+}
+
+int bootFormatTimeline(char *buf)
+{
+    uint32_t ms;
+
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        ms = stageMs[i];
+        buf[4 * i] = ms & 0xFF;
+        buf[4 * i + 1] = (ms >> 8) & 0xFF;
+        buf[4 * i + 2] = (ms >> 16) & 0xFF;
+        buf[4 * i + 3] = ms >> 24;
+    }
+
+    return BOOT_TIMELINE_SIZE;
+}
+
+void bootPrintTimeline()
+{
+    for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+        if (stageMs[i] == BOOT_NOT_REACHED)
+            printf("boot: %-14s --\n", stageNames[i]);
+        else
+            printf("boot: %-14s %lu ms\n", stageNames[i], 
+                   (unsigned long)stageMs[i]);
+    }
+}
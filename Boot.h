@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Boot.h
+ * @brief      Boot timeline recorder.
+ *
+ *             main() brings up the ESP8266 and MQTT while a separate thread
+ *             resets the 3pi, warms up the sensors and starts the local 
+ *             control threads. Each stage marks the time it finished here so
+ *             we can track how long it takes until the first command arrives.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+#include "mbed.h"
+
+#define BOOT_TOPIC          "m3pi-mqtt-ee250/boot"
+
+/* robotInit() prints, so it needs more than a minimal stack */
+#define ROBOT_INIT_STACK_SIZE   2048
+
+/**
+ * Boot stages, in the order they are reported
+ */
+enum {
+    BOOT_START,
+    BOOT_ROBOT_RESET,       /* 3pi out of reset */
+    BOOT_SENSORS_WARM,      /* range sensor settled */
+    BOOT_CONTROL_UP,        /* motion and print threads running */
+    BOOT_WIFI_UP,           /* ESP8266 associated and has an IP */
+    BOOT_MQTT_UP,           /* connected and subscribed */
+    BOOT_FIRST_COMMAND,     /* first MQTT message dispatched */
+    BOOT_STAGE_COUNT
+};
+
+/* a stage that has not been reached yet is reported as this */
+#define BOOT_NOT_REACHED    0xFFFFFFFF
+
+/* size of the payload written by bootFormatTimeline() */
+#define BOOT_TIMELINE_SIZE  (4 * BOOT_STAGE_COUNT)
+
+/**
+ * @brief      Records that a boot stage finished. Only the first mark of each
+ *             stage counts, so this is cheap to leave in hot paths.
+ *
+ * @param[in]  stage  The BOOT_* stage
+ */
+void bootMark(int stage);
+
+/**
+ * @brief      Returns true if the stage has been marked.
+ */
+bool bootReached(int stage);
+
+/**
+ * @brief      Fills in the timeline for publishing: one little endian uint32
+ *             per stage, in msec since BOOT_START.
+ *
+ * @param      buf   Buffer of at least BOOT_TIMELINE_SIZE bytes
+ *
+ * @return     Number of bytes written
+ */
+int bootFormatTimeline(char *buf);
+
+/**
+ * @brief      Prints the timeline to the serial console.
+ */
+void bootPrintTimeline();
+
+#endif /* _BOOT_H_ */
@@ -0,0 +1,315 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Config.cpp
+ * @brief      Implementation of the configuration store.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Config.h"
+#include "Motion.h"
+#include "rtos.h"
+
+#define CONFIG_MAGIC        0x4643334D  /* "M3CF" */
+#define CONFIG_VERSION      1
+
+typedef struct {
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  count;
+    uint16_t length;
+    uint16_t checksum;
+    uint16_t reserved;
+} ConfigHeader;
+
+typedef struct {
+    uint8_t len;    /* 0 means not set */
+    uint8_t data[CONFIG_MAX_VALUE_LEN];
+} ConfigValue;
+
+/* the parsed store, indexed by key */
+static ConfigValue values[CFG_KEY_COUNT];
+static Mutex configMtx;
+
+static FlashIAP flash;
+
+/* FlashIAP wants a word aligned RAM buffer */
+static uint32_t image[CONFIG_FLASH_IMAGE_SIZE / sizeof(uint32_t)];
+
+static uint16_t fletcher16(const uint8_t *data, size_t len)
+{
+    uint32_t a = 0, b = 0;
+    size_t n;
+
+    /* 359 bytes is the most we can sum before the 32-bit sums overflow */
+    while (len) {
+        n = (len > 359) ? 359 : len;
+        len -= n;
+        do {
+            a += *data++;
+            b += a;
+        } while (--n);
+        a %= 255;
+        b %= 255;
+    }
+
+    return (uint16_t)((b << 8) | a);
+}
+
+/* address of the last flash sector, which the store occupies */
+static uint32_t configAddress()
+{
+    uint32_t end = flash.get_flash_start() + flash.get_flash_size();
+    return end - flash.get_sector_size(end - 1);
+}
+
+/**
+ * @brief      Parses key/len/value records into the values table. Stops at the
+ *             first malformed record. Call with configMtx held.
+ *
+ * @return     Number of records applied
+ */
+static int parseRecords(const uint8_t *rec, size_t len)
+{
+    int count = 0;
+    uint8_t key, vlen;
+
+    while (len >= 2) {
+        key = rec[0];
+        vlen = rec[1];
+        if (key == 0 || key >= CFG_KEY_COUNT || vlen > CONFIG_MAX_VALUE_LEN
+            || (size_t)vlen + 2 > len)
+            break;
+        values[key].len = vlen;
+        memcpy(values[key].data, &rec[2], vlen);
+        rec += vlen + 2;
+        len -= vlen + 2;
+        count++;
+    }
+
+    return count;
+}
+
+/* Serializes the values table into image. Call with configMtx held. */
+static void buildImage()
+{
+    ConfigHeader *hdr = (ConfigHeader *)image;
+    uint8_t *rec = (uint8_t *)image + sizeof(ConfigHeader);
+    uint16_t length = 0;
+    uint8_t count = 0;
+
+    memset(image, 0xFF, sizeof(image));
+
+    for (int key = 1; key < CFG_KEY_COUNT; key++) {
+        if (values[key].len == 0)
+            continue;
+        rec[length] = key;
+        rec[length + 1] = values[key].len;
+        memcpy(&rec[length + 2], values[key].data, values[key].len);
+        length += values[key].len + 2;
+        count++;
+    }
+
+    hdr->magic = CONFIG_MAGIC;
+    hdr->version = CONFIG_VERSION;
+    hdr->count = count;
+    hdr->length = length;
+    hdr->checksum = fletcher16(rec, length);
+    hdr->reserved = 0xFFFF;
+}
+
+/* Writes the values table to flash. Call with configMtx held. */
+static void saveImage()
+{
+    uint32_t addr = configAddress();
+
+    buildImage();
+    flash.erase(addr, flash.get_sector_size(addr));
+    flash.program(image, addr, sizeof(image));
+}
+
+/* push the hot values to the modules that use them */
+static void applyHotValues()
+{
+    motionSetLimits(configGetInt(CFG_MOTION_ACCEL, MOTION_DEFAULT_ACCEL_LIMIT),
+                    configGetInt(CFG_MOTION_JERK, MOTION_DEFAULT_JERK_LIMIT));
+}
+
+void configInit()
+{
+    ConfigHeader *hdr = (ConfigHeader *)image;
+    const uint8_t *rec = (const uint8_t *)image + sizeof(ConfigHeader);
+    int count = 0;
+
+    flash.init();
+    flash.read(image, configAddress(), sizeof(image));
+
+    configMtx.lock();
+    if (hdr->magic != CONFIG_MAGIC || hdr->version != CONFIG_VERSION) {
+        printf("config: no stored config, using defaults\n");
+    } else if (hdr->length > sizeof(image) - sizeof(ConfigHeader)
+               || fletcher16(rec, hdr->length) != hdr->checksum) {
+        printf("config: stored config is corrupt, using defaults\n");
+    } else {
+        count = parseRecords(rec, hdr->length);
+        printf("config: loaded %d values from flash\n", count);
+    }
+    configMtx.unlock();
+
+    applyHotValues();
+}
+
+int configGetInt(int key, int def)
+{
+    int val = 0;
+
+    if (key <= 0 || key >= CFG_KEY_COUNT)
+        return def;
+
+    configMtx.lock();
+    if (values[key].len == 0) {
+        val = def;
+    } else {
+        for (int i = values[key].len - 1; i >= 0; i--)
+            val = (val << 8) | values[key].data[i];
+    }
+    configMtx.unlock();
+
+    return val;
+}
+
+void configGetString(int key, char *buf, size_t len, const char *def)
+{
+    size_t n;
+
+    if (len == 0)
+        return;
+
+    configMtx.lock();
+    if (key <= 0 || key >= CFG_KEY_COUNT || values[key].len == 0) {
+        strncpy(buf, def, len - 1);
+        buf[len - 1] = '\0';
+    } else {
+        n = (values[key].len < len - 1) ? values[key].len : len - 1;
+        memcpy(buf, values[key].data, n);
+        buf[n] = '\0';
+    }
+    configMtx.unlock();
+}
+
+int configGetBytes(int key, void *buf, size_t len)
+{
+    int n = 0;
+
+    if (key <= 0 || key >= CFG_KEY_COUNT)
+        return 0;
+
+    configMtx.lock();
+    if (values[key].len <= len) {
+        n = values[key].len;
+        memcpy(buf, values[key].data, n);
+    }
+    configMtx.unlock();
+
+    return n;
+}
+
+bool configSetBytes(int key, const void *data, size_t len, bool save)
+{
+    if (key <= 0 || key >= CFG_KEY_COUNT || len == 0 || 
+        len > CONFIG_MAX_VALUE_LEN)
+        return false;
+
+    configMtx.lock();
+    values[key].len = len;
+    memcpy(values[key].data, data, len);
+    if (save)
+        saveImage();
+    configMtx.unlock();
+
+    return true;
+}
+
+bool configHas(int key)
+{
+    bool has;
+
+    if (key <= 0 || key >= CFG_KEY_COUNT)
+        return false;
+
+    configMtx.lock();
+    has = values[key].len != 0;
+    configMtx.unlock();
+
+    return has;
+}
+
+void configMessageArrived(MQTT::MessageData& md)
+{
+    MQTT::Message &message = md.message;
+    const uint8_t *payload = (const uint8_t *)message.payload;
+    uint32_t addr;
+    int count;
+
+    if (message.payloadlen < 1)
+        return;
+
+    switch (payload[0]) {
+        case CONFIG_OP_SET:
+        case CONFIG_OP_SET_AND_SAVE:
+            configMtx.lock();
+            count = parseRecords(payload + 1, message.payloadlen - 1);
+            if (payload[0] == CONFIG_OP_SET_AND_SAVE)
+                saveImage();
+            configMtx.unlock();
+            printf("config: applied %d values%s\n", count, 
+                   (payload[0] == CONFIG_OP_SET_AND_SAVE) ? " and saved" : "");
+            applyHotValues();
+            break;
+        case CONFIG_OP_ERASE:
+            addr = configAddress();
+            flash.erase(addr, flash.get_sector_size(addr));
+            printf("config: erased, defaults apply after reset\n");
+            break;
+        default:
+            printf("config: unknown op\n");
+            break;
+    }
+}
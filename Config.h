@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Config.h
+ * @brief      Flash-backed key-value configuration store.
+ *
+ *             Settings that used to need a reflash (broker, Wi-Fi credentials,
+ *             movement speed and duration, motion limits) live in the last 
+ *             flash sector in a compact binary layout:
+ *
+ *                 header:  magic (4) | version (1) | count (1) | 
+ *                          length (2) | checksum (2) | reserved (2)
+ *                 records: key (1) | len (1) | value (len)  ...
+ *
+ *             The checksum is a Fletcher-16 over the records so the store can
+ *             be validated quickly at boot. Updates arrive on CONFIG_TOPIC in
+ *             the same record format, prefixed by one CONFIG_OP_* byte. Values
+ *             marked "hot" below take effect immediately. The rest are used 
+ *             the next time the robot connects (e.g. after a reset).
+ *
+ *             Integers are little endian.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include "mbed.h"
+#include "MQTTClient.h"
+
+#define CONFIG_TOPIC                "m3pi-mqtt-ee250/config"
+
+#define CONFIG_MAX_VALUE_LEN        32
+#define CONFIG_FLASH_IMAGE_SIZE     512
+
+/* defaults for the values movement() callers used to hard code */
+#define CONFIG_DEFAULT_MOVE_SPEED       25
+#define CONFIG_DEFAULT_MOVE_DURATION    100
+
+/**
+ * Configuration keys. Never renumber these, they are stored in flash.
+ */
+enum {
+    CFG_BROKER_ADDR     = 1,    /* string */
+    CFG_BROKER_PORT     = 2,    /* uint16 */
+    CFG_WIFI_SSID       = 3,    /* string */
+    CFG_WIFI_PASSWORD   = 4,    /* string */
+    CFG_MOVE_SPEED      = 5,    /* uint8, hot */
+    CFG_MOVE_DURATION   = 6,    /* uint16 msec, hot */
+    CFG_MOTION_ACCEL    = 7,    /* uint16, hot (see Motion.h) */
+    CFG_MOTION_JERK     = 8,    /* uint16, hot (see Motion.h) */
+    CFG_ROBOT_ID        = 9,    /* uint8, defaults to the last byte of our IP */
+    CFG_LINE_CALIBRATION = 10,  /* bytes, written by LineSensors.cpp */
+    CFG_KEY_COUNT
+};
+
+/**
+ * First byte of a message on CONFIG_TOPIC
+ */
+enum {
+    CONFIG_OP_SET,          /* apply the records */
+    CONFIG_OP_SET_AND_SAVE, /* apply the records and write them to flash */
+    CONFIG_OP_ERASE         /* erase the flash copy, back to defaults on reset */
+};
+
+/**
+ * @brief      Loads the store from flash. Call this once at boot, before any
+ *             of the getters.
+ */
+void configInit();
+
+/**
+ * @brief      Reads an integer value.
+ *
+ * @param[in]  key   The CFG_* key
+ * @param[in]  def   Returned if the key is not set
+ *
+ * @return     The value
+ */
+int configGetInt(int key, int def);
+
+/**
+ * @brief      Copies a string value into buf (always null terminated).
+ *
+ * @param[in]  key   The CFG_* key
+ * @param      buf   The destination buffer
+ * @param[in]  len   The size of buf
+ * @param[in]  def   Copied instead if the key is not set
+ */
+void configGetString(int key, char *buf, size_t len, const char *def);
+
+/**
+ * @brief      Copies a binary value into buf.
+ *
+ * @param[in]  key   The CFG_* key
+ * @param      buf   The destination buffer
+ * @param[in]  len   The size of buf
+ *
+ * @return     The length of the value, 0 if the key is not set or the value
+ *             does not fit in buf
+ */
+int configGetBytes(int key, void *buf, size_t len);
+
+/**
+ * @brief      Sets a value from the robot itself, like a CONFIG_OP_SET 
+ *             record would.
+ *
+ * @param[in]  key   The CFG_* key
+ * @param[in]  data  The value, integers little endian
+ * @param[in]  len   The length of the value, at most CONFIG_MAX_VALUE_LEN
+ * @param[in]  save  Also write the store to flash. This stalls the CPU while
+ *                   the sector is erased, so do it from the main loop.
+ *
+ * @return     false if the key or length is invalid
+ */
+bool configSetBytes(int key, const void *data, size_t len, bool save);
+
+/**
+ * @brief      Returns true if the key has a value.
+ */
+bool configHas(int key);
+
+/**
+ * @brief      MQTT callback for CONFIG_TOPIC. Subscribe it with 
+ *             client.subscribe(CONFIG_TOPIC, MQTT::QOS1, configMessageArrived).
+ */
+void configMessageArrived(MQTT::MessageData& md);
+
+#endif /* _CONFIG_H_ */
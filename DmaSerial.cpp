@@ -0,0 +1,249 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       DmaSerial.cpp
+ * @brief      Implementation of the DMA driven serial port on the LPC1768.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "DmaSerial.h"
+
+/* GPDMA channel used for UART3 transmit. Channel 0 has the highest priority,
+   leave it to anything that cannot wait. */
+#define DMA_SERIAL_CHANNEL      LPC_GPDMACH7
+#define DMA_SERIAL_CHANNEL_BIT  (1UL << 7)
+
+/* GPDMA request line of UART3 Tx, see the LPC17xx user manual, table 543 */
+#define DMA_REQ_UART3_TX        14
+
+#define PCONP_PCGPDMA           (1UL << 29)
+
+#define DMACC_CONTROL_SI        (1UL << 26)     /* increment source */
+#define DMACC_CONTROL_I         (1UL << 31)     /* terminal count interrupt */
+#define DMACC_CONFIG_E          (1UL << 0)
+#define DMACC_CONFIG_DEST(p)    ((uint32_t)(p) << 6)
+#define DMACC_CONFIG_M2P        (1UL << 11)
+#define DMACC_CONFIG_ITC        (1UL << 15)
+
+#define UART_FCR_FIFO_ENABLE    (1UL << 0)
+#define UART_FCR_DMA_MODE       (1UL << 3)
+
+/* AHB SRAM banks 0 and 1, the only RAM the GPDMA can read */
+#define AHB_SRAM_START          0x2007C000UL
+#define AHB_SRAM_END            0x20084000UL
+
+/* Only one port owns the DMA channel, so one pair of buffers is enough. */
+static __attribute__((section("AHBSRAM0"), aligned(4)))
+    uint8_t dmaTxBuf[2][DMA_SERIAL_TX_BUFFER_SIZE];
+
+static bool dmaReachable(const void *p, size_t len)
+{
+    uint32_t a = (uint32_t)p;
+
+    return a >= AHB_SRAM_START && a + len <= AHB_SRAM_END;
+}
+
+DmaSerial *DmaSerial::_dma_owner = NULL;
+
+DmaSerial::DmaSerial(PinName tx, PinName rx, int baud) : _ser(tx, rx, baud),
+    _dma(false), _tx_buf(dmaTxBuf), _tx_fill(0), _tx_fill_len(0), 
+    _tx_busy(false), _tx_waiting(false), _tx_space(0),
+    _rx_head(0), _rx_tail(0), _overruns(0), _rx_ready(0)
+{
+    /* if the linker did not place the buffers in AHB SRAM the DMA would
+       send garbage, fall back to putc() instead */
+    if (tx == p9 && _dma_owner == NULL && 
+            dmaReachable(dmaTxBuf, sizeof(dmaTxBuf))) {
+        _dma = true;
+        _dma_owner = this;
+
+        LPC_SC->PCONP |= PCONP_PCGPDMA;
+        LPC_GPDMA->DMACConfig = 1;      /* enable, little endian */
+        LPC_GPDMA->DMACIntTCClear = DMA_SERIAL_CHANNEL_BIT;
+        LPC_GPDMA->DMACIntErrClr = DMA_SERIAL_CHANNEL_BIT;
+
+        /* keep the FIFOs on and let the UART request DMA transfers */
+        LPC_UART3->FCR = UART_FCR_FIFO_ENABLE | UART_FCR_DMA_MODE;
+
+        NVIC_SetVector(DMA_IRQn, (uint32_t)&DmaSerial::dma_irq);
+        NVIC_EnableIRQ(DMA_IRQn);
+    }
+
+    _ser.attach(callback(this, &DmaSerial::on_rx), SerialBase::RxIrq);
+}
+
+void DmaSerial::baud(int baud)
+{
+    flush();
+    _ser.baud(baud);
+}
+
+/* Sends the buffer being filled and makes the other one the fill buffer. Call
+   with interrupts masked. */
+void DmaSerial::start_dma()
+{
+    if (_tx_busy || _tx_fill_len == 0)
+        return;
+
+    DMA_SERIAL_CHANNEL->DMACCSrcAddr = (uint32_t)_tx_buf[_tx_fill];
+    DMA_SERIAL_CHANNEL->DMACCDestAddr = (uint32_t)&LPC_UART3->THR;
+    DMA_SERIAL_CHANNEL->DMACCLLI = 0;
+    DMA_SERIAL_CHANNEL->DMACCControl = _tx_fill_len | DMACC_CONTROL_SI | 
+                                       DMACC_CONTROL_I;
+    DMA_SERIAL_CHANNEL->DMACCConfig = DMACC_CONFIG_E | DMACC_CONFIG_M2P |
+                                      DMACC_CONFIG_DEST(DMA_REQ_UART3_TX) |
+                                      DMACC_CONFIG_ITC;
+
+    _tx_busy = true;
+    _tx_fill ^= 1;
+    _tx_fill_len = 0;
+}
+
+void DmaSerial::dma_irq()
+{
+    DmaSerial *self = _dma_owner;
+    uint32_t done = LPC_GPDMA->DMACIntTCStat | LPC_GPDMA->DMACIntErrStat;
+
+    if (!self || !(done & DMA_SERIAL_CHANNEL_BIT))
+        return;
+
+    LPC_GPDMA->DMACIntTCClear = DMA_SERIAL_CHANNEL_BIT;
+    LPC_GPDMA->DMACIntErrClr = DMA_SERIAL_CHANNEL_BIT;
+
+    self->_tx_busy = false;
+    self->start_dma();
+
+    /* only a waiting writer gets a token, so none are left over to let a 
+       later write() through while both buffers are still full */
+    if (self->_tx_waiting) {
+        self->_tx_waiting = false;
+        self->_tx_space.release();
+    }
+}
+
+void DmaSerial::write(const uint8_t *data, size_t len)
+{
+    size_t n;
+    bool full;
+
+    if (!_dma) {
+        while (len--)
+            _ser.putc(*data++);
+        return;
+    }
+
+    while (len > 0) {
+        core_util_critical_section_enter();
+        n = DMA_SERIAL_TX_BUFFER_SIZE - _tx_fill_len;
+        if (n > len)
+            n = len;
+        memcpy(&_tx_buf[_tx_fill][_tx_fill_len], data, n);
+        _tx_fill_len += n;
+        start_dma();
+        /* both buffers are full and there is more, wait for the DMA to 
+           finish one */
+        full = (n < len && _tx_fill_len == DMA_SERIAL_TX_BUFFER_SIZE);
+        _tx_waiting = full;
+        core_util_critical_section_exit();
+
+        data += n;
+        len -= n;
+
+        if (full)
+            _tx_space.wait();
+    }
+}
+
+void DmaSerial::flush()
+{
+    bool busy;
+
+    if (!_dma)
+        return;
+
+    /* write() always starts a filled buffer when the DMA is idle, so this 
+       only has to wait for the DMA */
+    while (1) {
+        core_util_critical_section_enter();
+        busy = _tx_busy;
+        _tx_waiting = busy;
+        core_util_critical_section_exit();
+        if (!busy)
+            break;
+        _tx_space.wait();
+    }
+
+    /* the last bytes are still in the UART's FIFO and shift register */
+    while (!(LPC_UART3->LSR & (1UL << 6)))
+        ;
+}
+
+void DmaSerial::on_rx()
+{
+    while (_ser.readable()) {
+        uint8_t c = _ser.getc();
+        if (_rx_head - _rx_tail < DMA_SERIAL_RX_BUFFER_SIZE) {
+            _rx_buf[_rx_head & (DMA_SERIAL_RX_BUFFER_SIZE - 1)] = c;
+            _rx_head++;
+        } else {
+            _overruns++;
+        }
+    }
+    _rx_ready.release();
+}
+
+int DmaSerial::getc(uint32_t timeout_ms)
+{
+    int c;
+
+    while (_rx_head == _rx_tail) {
+        if (_rx_ready.wait(timeout_ms) <= 0)
+            return -1;
+    }
+
+    c = _rx_buf[_rx_tail & (DMA_SERIAL_RX_BUFFER_SIZE - 1)];
+    _rx_tail++;
+    return c;
+}
+
+void DmaSerial::drain()
+{
+    _rx_tail = _rx_head;
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       DmaSerial.h
+ * @brief      Serial port with DMA driven, double buffered transmit and an 
+ *             interrupt fed receive ring.
+ *
+ *             write() copies bytes into one of two transmit buffers and 
+ *             returns while the GPDMA sends the other one, so a thread only 
+ *             blocks when both buffers are full. Received bytes are moved
+ *             into a ring by the UART interrupt and getc() waits on a 
+ *             semaphore instead of spinning.
+ *
+ *             The DMA path is only wired up for UART3 (tx p9, rx p10), which is
+ *             where the m3pi is connected. On any other pins write() falls 
+ *             back to putc() one byte at a time.
+ *
+ *             The GPDMA can only reach the AHB SRAM banks, not the local SRAM
+ *             the globals live in, so the transmit buffers are not members 
+ *             but a single static pair in AHBSRAM0 owned by the DMA port.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _DMA_SERIAL_H_
+#define _DMA_SERIAL_H_
+
+#include "mbed.h"
+#include "rtos.h"
+
+#define DMA_SERIAL_TX_BUFFER_SIZE   64
+#define DMA_SERIAL_RX_BUFFER_SIZE   64  /* must be a power of 2 */
+
+class DmaSerial {
+public:
+    DmaSerial(PinName tx, PinName rx, int baud);
+
+    /**
+     * @brief      Changes the baud rate once everything queued has been sent.
+     */
+    void baud(int baud);
+
+    /**
+     * @brief      Queues bytes for sending. Blocks only while both transmit 
+     *             buffers are full. Must not be called from an ISR.
+     */
+    void write(const uint8_t *data, size_t len);
+
+    /**
+     * @brief      Blocks until every queued byte has left the UART.
+     */
+    void flush();
+
+    /**
+     * @brief      Takes one received byte out of the ring.
+     *
+     * @param[in]  timeout_ms  How long to wait for a byte to arrive
+     *
+     * @return     The byte, or -1 if none arrived in time
+     */
+    int getc(uint32_t timeout_ms);
+
+    /**
+     * @brief      Throws away everything received so far.
+     */
+    void drain();
+
+    /**
+     * @brief      Returns how many received bytes were dropped because the 
+     *             ring was full.
+     */
+    uint32_t overruns() const { return _overruns; }
+
+private:
+    void start_dma();
+    void on_rx();
+    static void dma_irq();
+
+    RawSerial _ser;
+    bool _dma;
+
+    uint8_t (*_tx_buf)[DMA_SERIAL_TX_BUFFER_SIZE];  /* two, in AHB SRAM */
+    volatile int _tx_fill;          /* buffer being filled by write() */
+    volatile size_t _tx_fill_len;
+    volatile bool _tx_busy;         /* the other buffer is being sent */
+    volatile bool _tx_waiting;      /* a writer waits for _tx_space */
+    Semaphore _tx_space;
+
+    uint8_t _rx_buf[DMA_SERIAL_RX_BUFFER_SIZE];
+    volatile uint32_t _rx_head;
+    volatile uint32_t _rx_tail;
+    volatile uint32_t _overruns;
+    Semaphore _rx_ready;
+
+    /* the GPDMA has a single interrupt for all channels */
+    static DmaSerial *_dma_owner;
+};
+
+#endif /* _DMA_SERIAL_H_ */
@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       FixedPoint.cpp
+ * @brief      Fixed-point sine and calibration tables.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "FixedPoint.h"
+
+/* sin() over a quarter turn in Q15, 64 steps */
+static const int16_t sinTable[65] = {
+        0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+     6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767
+};
+
+int32_t sinQ15(uint16_t angle)
+{
+    uint32_t idx = angle >> 8;
+    int32_t frac = angle & 0xFF;
+    uint32_t i = idx & 63;
+    int32_t s0, s1;
+
+    switch (idx >> 6) {
+        case 0:
+            s0 = sinTable[i];
+            s1 = sinTable[i + 1];
+            break;
+        case 1:
+            s0 = sinTable[64 - i];
+            s1 = sinTable[63 - i];
+            break;
+        case 2:
+            s0 = -sinTable[i];
+            s1 = -sinTable[i + 1];
+            break;
+        default:
+            s0 = -sinTable[64 - i];
+            s1 = -sinTable[63 - i];
+            break;
+    }
+
+    return s0 + (((s1 - s0) * frac) >> 8);
+}
+
+int32_t cosQ15(uint16_t angle)
+{
+    return sinQ15(angle + 16384);
+}
+
+int32_t fixCalibrate(const FixCalPoint *table, int count, int32_t raw)
+{
+    int i;
+
+    if (raw <= table[0].raw)
+        return table[0].value;
+    if (raw >= table[count - 1].raw)
+        return table[count - 1].value;
+
+    for (i = 1; raw > table[i].raw; i++)
+        ;
+
+    /* 32 bits are enough (see FixedPoint.h), and the M3 multiplies and 
+       divides those in hardware instead of calling __aeabi_ldivmod */
+    return table[i - 1].value + 
+           (raw - table[i - 1].raw) * (table[i].value - table[i - 1].value) /
+           (table[i].raw - table[i - 1].raw);
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       FixedPoint.h
+ * @brief      Fixed-point numbers for sensor conversions and control math.
+ *
+ *             The LPC1768's Cortex-M3 has no FPU, so every float or double 
+ *             operation runs through a software library. Use these instead:
+ *
+ *             - Q15 (fix15_t): -1.0 to just under 1.0, for ratios, sine and
+ *               cosine and the line position.
+ *             - Q16.16 (fix16_t): about +-32767 with 1/65536 resolution, for
+ *               gains and physical quantities that need a fraction.
+ *
+ *             Nonlinear sensors are converted with a calibration table of
+ *             (raw, value) points and linear interpolation between them.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _FIXED_POINT_H_
+#define _FIXED_POINT_H_
+
+#include "mbed.h"
+
+typedef int16_t fix15_t;
+typedef int32_t fix16_t;
+
+#define FIX15_ONE       32767
+#define FIX15_MINUS_ONE (-32768)
+#define FIX16_ONE       65536
+
+/* constant conversions, e.g. FIX16_CONST(0.0098), are done by the compiler */
+#define FIX15_CONST(x)  ((fix15_t)((x) * 32768.0 + ((x) >= 0 ? 0.5 : -0.5)))
+#define FIX16_CONST(x)  ((fix16_t)((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+/**
+ * One point of a calibration table. Tables are sorted by raw value. Between 
+ * two neighboring points, the raw span times the value span must fit in an 
+ * int32_t, e.g. 16-bit raw readings with value steps under 32768.
+ */
+typedef struct {
+    int32_t raw;
+    int32_t value;
+} FixCalPoint;
+
+static inline fix16_t fix16FromInt(int32_t x)
+{
+    return x << 16;
+}
+
+/* rounds to the nearest integer */
+static inline int32_t fix16ToInt(fix16_t x)
+{
+    return (x + (FIX16_ONE >> 1)) >> 16;
+}
+
+static inline fix16_t fix16Mul(fix16_t a, fix16_t b)
+{
+    return (fix16_t)(((int64_t)a * b) >> 16);
+}
+
+static inline fix16_t fix16Div(fix16_t a, fix16_t b)
+{
+    return (fix16_t)(((int64_t)a << 16) / b);
+}
+
+static inline fix15_t fix15Mul(fix15_t a, fix15_t b)
+{
+    return (fix15_t)(((int32_t)a * b) >> 15);
+}
+
+/* saturates instead of wrapping around */
+static inline fix15_t fix15Sat(int32_t x)
+{
+    if (x > FIX15_ONE)
+        return FIX15_ONE;
+    if (x < FIX15_MINUS_ONE)
+        return FIX15_MINUS_ONE;
+    return (fix15_t)x;
+}
+
+/**
+ * @brief      Q15 sine of a binary angle, where 65536 is a full turn. 
+ *             Linearly interpolated from a 64 step quarter wave table.
+ */
+int32_t sinQ15(uint16_t angle);
+
+/**
+ * @brief      Q15 cosine of a binary angle, where 65536 is a full turn.
+ */
+int32_t cosQ15(uint16_t angle);
+
+/**
+ * @brief      Converts a raw reading with a calibration table.
+ *
+ * @param[in]  table  Calibration points sorted by raw value
+ * @param[in]  count  Number of points, at least 2
+ * @param[in]  raw    The raw reading
+ *
+ * @return     The value linearly interpolated between the two points around 
+ *             raw. Readings outside the table are clamped to its ends.
+ */
+int32_t fixCalibrate(const FixCalPoint *table, int count, int32_t raw);
+
+#endif /* _FIXED_POINT_H_ */
@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       FlightRecorder.cpp
+ * @brief      Implementation of the flight recorder.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "FlightRecorder.h"
+
+#define FR_MAGIC    0x52465233  /* "3RFR" */
+
+#if defined(__GNUC__) && !defined(__CC_ARM)
+/* NOLOAD section in the LPC1768 GCC_ARM linker script */
+#define FR_SECTION  __attribute__((section("AHBSRAM0"), aligned(4)))
+#else
+/* other toolchains zero this at startup, so nothing survives a reset */
+#define FR_SECTION
+#endif
+
+typedef struct {
+    uint32_t timestamp;
+    uint8_t  type;
+    uint8_t  a;
+    uint16_t b;
+} FrEvent;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t bootNumber;
+    uint8_t  resetCause;    /* RSID of the boot that followed this bank */
+    uint8_t  reserved;
+    volatile uint32_t head; /* total number of events ever recorded */
+    FrEvent  events[FR_EVENT_COUNT];
+} FrBank;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t magicInv;
+    uint32_t active;
+    uint16_t bootNumber;
+    uint16_t reserved;
+    FrBank   banks[2];
+} FrStore;
+
+static FrStore store FR_SECTION;
+
+static FrBank *current = NULL;
+static FrBank *previous = NULL;
+
+void frInit()
+{
+    uint8_t rsid = LPC_SC->RSID & 0x0F;
+    uint32_t prev;
+
+    /* clear the reset reason so the next boot sees only its own */
+    LPC_SC->RSID = 0x0F;
+
+    if (store.magic == FR_MAGIC && store.magicInv == ~(uint32_t)FR_MAGIC 
+        && store.active < 2) {
+        prev = store.active;
+        if (store.banks[prev].magic == FR_MAGIC) {
+            previous = &store.banks[prev];
+            previous->resetCause = rsid;
+        }
+        store.active = 1 - prev;
+        store.bootNumber++;
+    } else {
+        /* power on, or the memory was never ours */
+        store.magic = FR_MAGIC;
+        store.magicInv = ~(uint32_t)FR_MAGIC;
+        store.active = 0;
+        store.bootNumber = 0;
+    }
+
+    current = &store.banks[store.active];
+    current->magic = FR_MAGIC;
+    current->bootNumber = store.bootNumber;
+    current->resetCause = 0;
+    current->head = 0;
+
+    frRecord(FR_EVT_BOOT, rsid, store.bootNumber);
+}
+
+void frRecord(uint8_t type, uint8_t a, uint16_t b)
+{
+    uint32_t idx;
+    FrEvent *e;
+
+    if (!current)
+        return;
+
+    idx = core_util_atomic_incr_u32(&current->head, 1) - 1;
+    e = &current->events[idx & (FR_EVENT_COUNT - 1)];
+    e->timestamp = us_ticker_read();
+    e->type = type;
+    e->a = a;
+    e->b = b;
+}
+
+int frFormatChunk(int chunk, char *buf)
+{
+    uint32_t count, first, chunks, idx;
+    int n = 0;
+    FrEvent *e;
+    char *p;
+
+    if (!previous)
+        return 0;
+
+    /* oldest event first; only the last FR_EVENT_COUNT are still there */
+    count = (previous->head > FR_EVENT_COUNT) ? FR_EVENT_COUNT : previous->head;
+    first = previous->head - count;
+    chunks = (count + FR_EVENTS_PER_CHUNK - 1) / FR_EVENTS_PER_CHUNK;
+    if ((uint32_t)chunk >= chunks)
+        return 0;
+
+    buf[0] = previous->bootNumber & 0xFF;
+    buf[1] = previous->bootNumber >> 8;
+    buf[2] = chunk;
+    buf[3] = chunks;
+    buf[4] = previous->resetCause;
+    p = buf + FR_CHUNK_HEADER_SIZE;
+
+    for (idx = chunk * FR_EVENTS_PER_CHUNK; 
+         idx < count && n < FR_EVENTS_PER_CHUNK; idx++, n++) {
+        e = &previous->events[(first + idx) & (FR_EVENT_COUNT - 1)];
+        p[0] = e->timestamp & 0xFF;
+        p[1] = (e->timestamp >> 8) & 0xFF;
+        p[2] = (e->timestamp >> 16) & 0xFF;
+        p[3] = e->timestamp >> 24;
+        p[4] = e->type;
+        p[5] = e->a;
+        p[6] = e->b & 0xFF;
+        p[7] = e->b >> 8;
+        p += 8;
+    }
+
+    return FR_CHUNK_HEADER_SIZE + 8 * n;
+}
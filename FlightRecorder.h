@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       FlightRecorder.h
+ * @brief      Ring buffer of binary events that survives a reset.
+ *
+ *             The recorder lives in the LPC1768's AHB SRAM bank 0, which the 
+ *             GCC_ARM linker script maps as NOLOAD. The startup code does not
+ *             clear it, so its contents survive mbed_reset() and watchdog 
+ *             resets (not power cycles). There are two banks: the previous 
+ *             boot's bank is kept intact for dumping while this boot records
+ *             into the other one.
+ *
+ *             Recording an event is an atomic increment plus an 8 byte store,
+ *             so it is cheap enough for messageArrived() and ISRs.
+ *
+ *             After MQTT connects, the previous boot's events are published 
+ *             to FR_TOPIC in chunks. Each chunk is raw bytes:
+ *
+ *                 [0-1]  boot number of the dumped bank
+ *                 [2]    chunk index
+ *                 [3]    chunk count
+ *                 [4]    LPC_SC->RSID of the boot that followed it
+ *                 [5-]   events, 8 bytes each: timestamp in usec (4), 
+ *                        type (1), a (1), b (2), little endian
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _FLIGHT_RECORDER_H_
+#define _FLIGHT_RECORDER_H_
+
+#include "mbed.h"
+
+#define FR_TOPIC                "m3pi-mqtt-ee250/flight-recorder"
+
+/* must be a power of 2 */
+#define FR_EVENT_COUNT          256
+
+/* events per published chunk, sized to fit MQTTClient's 100 byte packets */
+#define FR_EVENTS_PER_CHUNK     6
+#define FR_CHUNK_HEADER_SIZE    5
+#define FR_CHUNK_SIZE           (FR_CHUNK_HEADER_SIZE + 8 * FR_EVENTS_PER_CHUNK)
+
+/**
+ * Event types
+ */
+enum {
+    FR_EVT_BOOT,            /* a: LPC_SC->RSID */
+    FR_EVT_BOOT_STAGE,      /* a: BOOT_* stage */
+    FR_EVT_DISPATCH,        /* a: fwd target, b: (msg type << 8) | depth */
+    FR_EVT_MAILBOX_FULL,    /* a: fwd target */
+    FR_EVT_MOTOR,           /* a: left speed, b: right speed (both int8) */
+    FR_EVT_REFLEX,          /* b: distance in mm */
+    FR_EVT_RECONNECT,       /* connection lost, about to reset */
+    FR_EVT_FAULT,           /* a: FR_FAULT_* code, b: detail */
+    FR_EVT_LINK_MODE,       /* a: LINK_MODE_*, b: link quality */
+    FR_EVT_OVERLOAD,        /* a: 1 when it starts, 0 when it ends, b: drops */
+    FR_EVT_LINE_CAL         /* a: LINE_CAL_*, b: detail */
+};
+
+/**
+ * Fault codes for FR_EVT_FAULT
+ */
+enum {
+    FR_FAULT_WIFI_CONNECT,
+    FR_FAULT_TCP_CONNECT,   /* b: return value */
+    FR_FAULT_MQTT_CONNECT,  /* b: return value */
+    FR_FAULT_SUBSCRIBE,     /* b: return value */
+    FR_FAULT_PUBLISH,       /* b: return value */
+    FR_FAULT_BAD_MESSAGE    /* b: payload length */
+};
+
+/**
+ * @brief      Switches to a fresh bank and keeps the previous boot's bank for
+ *             dumping. Call this once, as early as possible in main().
+ */
+void frInit();
+
+/**
+ * @brief      Records an event. Safe to call from any thread or ISR.
+ *
+ * @param[in]  type  The FR_EVT_* type
+ * @param[in]  a     Type specific argument
+ * @param[in]  b     Type specific argument
+ */
+void frRecord(uint8_t type, uint8_t a, uint16_t b);
+
+/**
+ * @brief      Formats one chunk of the previous boot's events for publishing.
+ *
+ * @param[in]  chunk  The chunk index, starting at 0
+ * @param      buf    Buffer of at least FR_CHUNK_SIZE bytes
+ *
+ * @return     Number of bytes written, 0 once there are no more chunks
+ */
+int frFormatChunk(int chunk, char *buf);
+
+#endif /* _FLIGHT_RECORDER_H_ */
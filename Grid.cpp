@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Grid.cpp
+ * @brief      Implementation of the occupancy grid.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Grid.h"
+#include "FixedPoint.h"
+
+#define GRID_MAX_TOPIC_LEN      64
+#define GRID_WORDS_PER_ROW      (GRID_SIZE / 16)
+#define GRID_HALF_MM            (GRID_SIZE / 2 * GRID_CELL_MM)
+
+MBED_STATIC_ASSERT(GRID_SIZE % 16 == 0, "16 cells per word");
+MBED_STATIC_ASSERT(GRID_WORDS <= 256, "word indexes are sent as one byte");
+MBED_STATIC_ASSERT(GRID_REFRESH_WORDS < GRID_DIFF_MAX_WORDS,
+                   "room for dirty words in a diff");
+
+/* Written by the motion thread only. The export reads words without a lock,
+   which is fine since a word is read in one access. */
+static GridMap grid;
+
+/* next state after a ray passes through a cell, and after it ends in one */
+static const uint8_t missNext[4] = {
+    GRID_FREE, GRID_FREE, GRID_FREE, GRID_MAYBE_OCCUPIED
+};
+static const uint8_t hitNext[4] = {
+    GRID_MAYBE_OCCUPIED, GRID_MAYBE_OCCUPIED, GRID_OCCUPIED, GRID_OCCUPIED
+};
+
+static char topic[GRID_MAX_TOPIC_LEN];
+static Timer exportTimer;
+static uint16_t sequence = 0;
+static int refreshNext = 0;
+static int maxWords = GRID_DIFF_MAX_WORDS;
+
+void gridInit(const char *clientId, int room)
+{
+    snprintf(topic, sizeof(topic), "%s%s", GRID_TOPIC_PREFIX, clientId);
+
+    /* A long client id leaves less room for words. Keep at least one dirty
+       word, a packet that small would fail to publish anyway. */
+    maxWords = (room - (int)strlen(topic) - 3) / 5;
+    if (maxWords > GRID_DIFF_MAX_WORDS)
+        maxWords = GRID_DIFF_MAX_WORDS;
+    if (maxWords < GRID_REFRESH_WORDS + 1)
+        maxWords = GRID_REFRESH_WORDS + 1;
+
+    exportTimer.start();
+}
+
+const char *gridTopic()
+{
+    return topic;
+}
+
+/* cell coordinate of a position in mm, out of range outside of the grid */
+static inline int toCell(int32_t mm)
+{
+    mm += GRID_HALF_MM;
+    if (mm < 0)
+        return -1;
+    return mm / GRID_CELL_MM;
+}
+
+static inline bool inGrid(int cx, int cy)
+{
+    return (unsigned)cx < GRID_SIZE && (unsigned)cy < GRID_SIZE;
+}
+
+static inline void applyToCell(GridMap *map, int cx, int cy, 
+                               const uint8_t *next)
+{
+    int w = cy * GRID_WORDS_PER_ROW + (cx >> 4);
+    int shift = (cx & 15) << 1;
+    uint32_t word = map->cells[w];
+    uint32_t state = (word >> shift) & 3;
+    uint32_t updated = next[state];
+
+    if (updated == state)
+        return;
+    map->cells[w] = (word & ~(3UL << shift)) | (updated << shift);
+
+    /* the export clears dirty bits from another thread */
+    core_util_critical_section_enter();
+    map->dirty[w >> 5] |= 1UL << (w & 31);
+    core_util_critical_section_exit();
+}
+
+void gridRay(GridMap *map, const MotionPose *pose, int distanceMm)
+{
+    bool hit = true;
+    int32_t ex, ey;
+    int x0, y0, x1, y1, dx, dy, sx, sy, err, e2, n;
+
+    if (distanceMm < GRID_MIN_RANGE_MM)
+        return;
+    if (distanceMm > GRID_MAX_RANGE_MM) {
+        distanceMm = GRID_MAX_RANGE_MM;
+        hit = false;
+    }
+
+    ex = pose->x + ((distanceMm * cosQ15(pose->heading)) >> 15);
+    ey = pose->y + ((distanceMm * sinQ15(pose->heading)) >> 15);
+    x0 = toCell(pose->x);
+    y0 = toCell(pose->y);
+    x1 = toCell(ex);
+    y1 = toCell(ey);
+
+    /* Bresenham from the robot to the end of the ray. It takes 
+       max(|dx|, |dy|) steps, which is at most GRID_MAX_RAY_CELLS. */
+    dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    dy = y1 > y0 ? y0 - y1 : y1 - y0;
+    sx = x0 < x1 ? 1 : -1;
+    sy = y0 < y1 ? 1 : -1;
+    err = dx + dy;
+    for (n = 0; n < GRID_MAX_RAY_CELLS; n++) {
+        if (x0 == x1 && y0 == y1)
+            break;
+        if (inGrid(x0, y0))
+            applyToCell(map, x0, y0, missNext);
+        e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+    if (inGrid(x1, y1))
+        applyToCell(map, x1, y1, hit ? hitNext : missNext);
+}
+
+void gridUpdate(const MotionPose *pose, int distanceMm)
+{
+    gridRay(&grid, pose, distanceMm);
+}
+
+int gridCellAt(int32_t x, int32_t y)
+{
+    int cx = toCell(x);
+    int cy = toCell(y);
+
+    if (!inGrid(cx, cy))
+        return GRID_UNKNOWN;
+    return (grid.cells[cy * GRID_WORDS_PER_ROW + (cx >> 4)] 
+            >> ((cx & 15) << 1)) & 3;
+}
+
+uint32_t gridWord(int index)
+{
+    return grid.cells[index];
+}
+
+static int putWord(char *buf, int i, int w)
+{
+    /* clear the dirty bit before reading, so a change in between is sent 
+       again next time instead of being lost */
+    core_util_critical_section_enter();
+    grid.dirty[w >> 5] &= ~(1UL << (w & 31));
+    core_util_critical_section_exit();
+
+    uint32_t word = grid.cells[w];
+    char *p = &buf[3 + 5 * i];
+    p[0] = w;
+    for (int b = 0; b < 4; b++)
+        p[1 + b] = (word >> (8 * b)) & 0xFF;
+    return i + 1;
+}
+
+int gridNextDiff(char *buf, int periodMs)
+{
+    int n = 0;
+
+    if (exportTimer.read_ms() < periodMs)
+        return 0;
+    exportTimer.reset();
+
+    for (int d = 0; d < (GRID_WORDS + 31) / 32 && 
+                    n < maxWords - GRID_REFRESH_WORDS; d++) {
+        uint32_t bits = grid.dirty[d];
+        while (bits && n < maxWords - GRID_REFRESH_WORDS) {
+            int bit = __CLZ(__RBIT(bits));
+            bits &= bits - 1;
+            n = putWord(buf, n, d * 32 + bit);
+        }
+    }
+    for (int r = 0; r < GRID_REFRESH_WORDS; r++) {
+        n = putWord(buf, n, refreshNext);
+        refreshNext = (refreshNext + 1) % GRID_WORDS;
+    }
+
+    buf[0] = sequence & 0xFF;
+    buf[1] = sequence >> 8;
+    buf[2] = n;
+    sequence++;
+    return 3 + 5 * n;
+}
+
+void gridDiffLost(const char *buf)
+{
+    int n = (uint8_t)buf[2];
+
+    core_util_critical_section_enter();
+    for (int i = 0; i < n; i++) {
+        int w = (uint8_t)buf[3 + 5 * i];
+        grid.dirty[w >> 5] |= 1UL << (w & 31);
+    }
+    core_util_critical_section_exit();
+}
@@ -0,0 +1,185 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Grid.h
+ * @brief      Occupancy grid built from the range sensor and the dead 
+ *             reckoned pose.
+ *
+ *             The grid is GRID_SIZE x GRID_SIZE cells of GRID_CELL_MM, 
+ *             centered on where the robot booted, with x and y as in 
+ *             MotionPose. Each cell takes 2 bits, so the whole grid is 1 KB:
+ *
+ *                 0  unknown
+ *                 1  free
+ *                 2  occupied, seen once
+ *                 3  occupied
+ *
+ *             Every GRID_UPDATE_TICKS motion ticks, the motion thread casts a
+ *             ray from the robot along its heading (the way the range sensor
+ *             faces). Cells the ray passes through step towards free, and the
+ *             cell it ends in steps towards occupied unless the reading is 
+ *             beyond GRID_MAX_RANGE_MM. One step per reading means a single
+ *             bad reading cannot clear a wall or make one up. A ray visits at 
+ *             most GRID_MAX_RAY_CELLS cells, so an update takes a fixed 
+ *             worst case time (see the grid_ray benchmark in Bench.cpp).
+ *
+ *             Cells are stored 16 to a 32-bit word, row by row, and every 
+ *             word that changes is marked dirty. Every GRID_EXPORT_MS (longer
+ *             on a bad link, see Link.h), the dirty words are published on 
+ *             GRID_TOPIC_PREFIX<client id>, as raw bytes, little endian:
+ *
+ *                 [0-1]    sequence number
+ *                 [2]      number of words n, up to GRID_DIFF_MAX_WORDS or
+ *                          what fits in a packet with the topic
+ *                 [3-]     n times: word index (row * GRID_SIZE / 16 + 
+ *                          column / 16), then the word. Cell column % 16
+ *                          is in bits 2 * (column % 16) and up.
+ *
+ *             The last GRID_REFRESH_WORDS words of every diff are not dirty 
+ *             but taken in turn from the whole grid, so a host that missed
+ *             diffs or started late still gets the full map within 
+ *             GRID_WORDS / GRID_REFRESH_WORDS exports. gridmap.py assembles
+ *             and shows the map. If a diff cannot be published, 
+ *             gridDiffLost() marks its words dirty again.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _GRID_H_
+#define _GRID_H_
+
+#include "mbed.h"
+#include "Motion.h"
+
+#define GRID_TOPIC_PREFIX       "m3pi-mqtt-ee250/grid/"
+
+/* cells per side, a multiple of 16 */
+#define GRID_SIZE               64
+#define GRID_CELL_MM            50
+#define GRID_WORDS              (GRID_SIZE * GRID_SIZE / 16)
+
+enum {
+    GRID_UNKNOWN,
+    GRID_FREE,
+    GRID_MAYBE_OCCUPIED,
+    GRID_OCCUPIED
+};
+
+/* a new reading every RANGE_SAMPLE_PERIOD_MS */
+#define GRID_UPDATE_TICKS       5
+
+/* readings outside of these are not trusted to have hit anything */
+#define GRID_MIN_RANGE_MM       40
+#define GRID_MAX_RANGE_MM       1500
+#define GRID_MAX_RAY_CELLS      (GRID_MAX_RANGE_MM / GRID_CELL_MM + 1)
+
+#define GRID_EXPORT_MS          500
+#define GRID_DIFF_MAX_WORDS     12
+#define GRID_REFRESH_WORDS      2
+#define GRID_DIFF_MAX_SIZE      (3 + 5 * GRID_DIFF_MAX_WORDS)
+
+/* the cells and which of their words changed since the last export */
+typedef struct {
+    uint32_t cells[GRID_WORDS];
+    uint32_t dirty[(GRID_WORDS + 31) / 32];
+} GridMap;
+
+/**
+ * @brief      Sets up the export topic and sizes the diffs to fit in a 
+ *             packet with it.
+ *
+ * @param[in]  clientId  Our MQTT client id, to make the topic unique
+ * @param[in]  room      Bytes a publish has for its topic and payload
+ */
+void gridInit(const char *clientId, int room);
+
+/**
+ * @brief      Returns the topic to publish the diffs on.
+ */
+const char *gridTopic();
+
+/**
+ * @brief      Updates the grid with one range reading. Called by the motion 
+ *             thread, and nowhere else since only one thread may write the 
+ *             grid.
+ *
+ * @param[in]  pose        Where the robot was when it took the reading
+ * @param[in]  distanceMm  The filtered reading (rangeReadMm())
+ */
+void gridUpdate(const MotionPose *pose, int distanceMm);
+
+/**
+ * @brief      Casts one ray into a map other than the robot's. gridUpdate() 
+ *             is this on the robot's grid; the grid_ray benchmark uses it on 
+ *             a scratch map so it leaves the real one alone.
+ */
+void gridRay(GridMap *map, const MotionPose *pose, int distanceMm);
+
+/**
+ * @brief      Returns the state (GRID_*) of the cell at a position in mm. 
+ *             Outside of the grid, everything is GRID_UNKNOWN.
+ */
+int gridCellAt(int32_t x, int32_t y);
+
+/**
+ * @brief      Returns one word of 16 cells, laid out as in the diffs. Used by
+ *             the planner (Nav.h) to read the grid a word at a time.
+ */
+uint32_t gridWord(int index);
+
+/**
+ * @brief      Fills in the next diff, at most once per periodMs.
+ *
+ * @param      buf       Buffer of at least GRID_DIFF_MAX_SIZE bytes
+ * @param[in]  periodMs  GRID_EXPORT_MS, or longer when the link is bad (see
+ *                       linkPeriod())
+ *
+ * @return     Number of bytes to publish, 0 if it is not time yet
+ */
+int gridNextDiff(char *buf, int periodMs);
+
+/**
+ * @brief      Marks the words of a diff that could not be published dirty 
+ *             again, so they go out with the next one.
+ *
+ * @param[in]  buf   The diff from gridNextDiff()
+ */
+void gridDiffLost(const char *buf);
+
+#endif /* _GRID_H_ */
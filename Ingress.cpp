@@ -0,0 +1,273 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Ingress.cpp
+ * @brief      Rate limiting for incoming commands.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Ingress.h"
+#include "FlightRecorder.h"
+#include "Path.h"
+
+/* tokens are counted in thousandths of a message */
+#define TOKEN                   1000
+
+/* refilling for longer than this fills any bucket anyway, and keeps the
+   math in 32 bits */
+#define MAX_REFILL_MS           10000
+
+typedef struct {
+    uint16_t ratePerSec;
+    uint16_t burst;
+} IngressLimit;
+
+/* a whole path, sent back to back */
+#define PATH_UPLOAD_MESSAGES    ((PATH_MAX_SEGMENTS + PATH_UPLOAD_SEGMENTS - 1)\
+                                 / PATH_UPLOAD_SEGMENTS)
+#define PATH_BURST              (PATH_UPLOAD_MESSAGES + 1)
+
+/* Per FWD_TO_* target. The print and LED mailboxes hold 16 messages. Path 
+   uploads come in bursts of up to PATH_UPLOAD_MESSAGES messages, with room 
+   for a PATH_PLAY right after. Teleop controllers resend every 50 ms or 
+   so. */
+static const IngressLimit limits[] = {
+    { 10,  8 },     /* FWD_TO_PRINT_THR */
+    { 10,  8 },     /* FWD_TO_LED_THR */
+    {  2,  2 },     /* FWD_TO_POWER */
+    {  2,  4 },     /* FWD_TO_SERIAL_LOG */
+    { 10, PATH_BURST },     /* FWD_TO_PATH */
+    { 40, 10 },     /* FWD_TO_TELEOP */
+    {  1,  2 },     /* FWD_TO_LINE */
+    {  2,  4 },     /* FWD_TO_NAV */
+};
+
+MBED_STATIC_ASSERT(sizeof(limits) / sizeof(limits[0]) == FWD_TARGET_COUNT,
+                   "one ingress limit per FWD_TO_* target");
+
+typedef struct {
+    uint8_t target;
+    uint8_t type;
+    IngressLimit limit;
+} IngressTypeLimit;
+
+/* Types that come in bursts by design get more than half of their target's
+   limit. Every message of an upload is needed, dropping one loses the 
+   whole path. */
+static const IngressTypeLimit typeLimits[] = {
+    { FWD_TO_PATH, PATH_UPLOAD, { 10, PATH_UPLOAD_MESSAGES } },
+};
+
+MBED_STATIC_ASSERT(PATH_UPLOAD < INGRESS_TYPE_BUCKETS,
+                   "uploads have a bucket of their own");
+MBED_STATIC_ASSERT(PATH_UPLOAD_MESSAGES < PATH_BURST, 
+                   "a full upload and a PATH_PLAY fit in the path burst");
+
+typedef struct {
+    uint32_t tokens;
+    uint32_t lastUs;
+} TokenBucket;
+
+static TokenBucket targetBuckets[FWD_TARGET_COUNT];
+static TokenBucket typeBuckets[FWD_TARGET_COUNT][INGRESS_TYPE_BUCKETS];
+static bool bucketsFilled = false;
+
+/* drops since the last report, only touched by the MQTT thread */
+static uint32_t policedDrops[FWD_TARGET_COUNT];
+static uint32_t fullDrops[FWD_TARGET_COUNT];
+static uint32_t invalidDrops = 0;
+static uint32_t dropsThisInterval = 0;
+
+static bool overloaded = false;
+static bool unlimited = false;
+static Timer reportTimer;
+
+/* refills a bucket for the time since it was last used, then takes a token
+   if there is one */
+static bool take(TokenBucket *b, uint32_t ratePerSec, uint32_t burst, 
+                 uint32_t nowUs)
+{
+    uint32_t ms = (nowUs - b->lastUs) / 1000;
+
+    if (ms > MAX_REFILL_MS) {
+        ms = MAX_REFILL_MS;
+        b->lastUs = nowUs;
+    } else {
+        /* keep the fraction of a ms for next time */
+        b->lastUs += ms * 1000;
+    }
+
+    b->tokens += ms * ratePerSec;
+    if (b->tokens > burst * TOKEN) {
+        b->tokens = burst * TOKEN;
+    }
+
+    if (b->tokens < TOKEN) {
+        return false;
+    }
+    b->tokens -= TOKEN;
+    return true;
+}
+
+/* the limit of one type bucket, half of the target's unless the type has 
+   its own */
+static IngressLimit typeLimit(int target, int bucket)
+{
+    IngressLimit l;
+
+    for (size_t i = 0; i < sizeof(typeLimits) / sizeof(typeLimits[0]); i++) {
+        if (typeLimits[i].target == target && typeLimits[i].type == bucket) {
+            return typeLimits[i].limit;
+        }
+    }
+    l.ratePerSec = (limits[target].ratePerSec + 1) / 2;
+    l.burst = (limits[target].burst + 1) / 2;
+    return l;
+}
+
+static void fillBuckets(uint32_t nowUs)
+{
+    for (int t = 0; t < FWD_TARGET_COUNT; t++) {
+        targetBuckets[t].tokens = limits[t].burst * TOKEN;
+        targetBuckets[t].lastUs = nowUs;
+        for (int i = 0; i < INGRESS_TYPE_BUCKETS; i++) {
+            typeBuckets[t][i].tokens = typeLimit(t, i).burst * TOKEN;
+            typeBuckets[t][i].lastUs = nowUs;
+        }
+    }
+    reportTimer.start();
+    bucketsFilled = true;
+}
+
+bool ingressAdmit(int target, int type)
+{
+    uint32_t now = us_ticker_read();
+
+    if (!bucketsFilled) {
+        fillBuckets(now);
+    }
+    if (target < 0 || target >= FWD_TARGET_COUNT) {
+        ingressDrop(target, INGRESS_DROP_INVALID);
+        return false;
+    }
+
+    const IngressLimit *l = &limits[target];
+    int bucket = type >= 0 && type < INGRESS_TYPE_BUCKETS 
+                 ? type : INGRESS_TYPE_BUCKETS - 1;
+    IngressLimit tl = typeLimit(target, bucket);
+
+    /* the type bucket first, so a type over its limit does not use up the
+       target's tokens */
+    if ((!take(&typeBuckets[target][bucket], tl.ratePerSec, tl.burst, now) ||
+         !take(&targetBuckets[target], l->ratePerSec, l->burst, now)) &&
+        !unlimited) {
+        ingressDrop(target, INGRESS_DROP_POLICED);
+        return false;
+    }
+    return true;
+}
+
+void ingressSetUnlimited(bool enable)
+{
+    unlimited = enable;
+}
+
+void ingressDrop(int target, int reason)
+{
+    dropsThisInterval++;
+
+    if (reason == INGRESS_DROP_INVALID) {
+        invalidDrops++;
+    } else if (reason == INGRESS_DROP_FULL) {
+        fullDrops[target]++;
+    } else {
+        policedDrops[target]++;
+    }
+}
+
+bool ingressOverloaded()
+{
+    return overloaded;
+}
+
+static void put16(char *buf, uint32_t value)
+{
+    if (value > 0xFFFF) {
+        value = 0xFFFF;
+    }
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+int ingressNextReport(char *buf)
+{
+    if (!bucketsFilled) {
+        fillBuckets(us_ticker_read());
+    }
+    if (reportTimer.read_ms() < INGRESS_REPORT_INTERVAL_MS) {
+        return 0;
+    }
+    reportTimer.reset();
+
+    bool wasOverloaded = overloaded;
+    overloaded = dropsThisInterval > 0;
+    if (overloaded != wasOverloaded) {
+        frRecord(FR_EVT_OVERLOAD, overloaded, 
+                 dropsThisInterval > 0xFFFF ? 0xFFFF : dropsThisInterval);
+    }
+    dropsThisInterval = 0;
+
+    /* nothing was dropped in this interval or the one before */
+    if (!overloaded && !wasOverloaded) {
+        return 0;
+    }
+
+    buf[0] = overloaded;
+    put16(&buf[1], invalidDrops);
+    invalidDrops = 0;
+    for (int t = 0; t < FWD_TARGET_COUNT; t++) {
+        put16(&buf[3 + 4 * t], policedDrops[t]);
+        put16(&buf[5 + 4 * t], fullDrops[t]);
+        policedDrops[t] = 0;
+        fullDrops[t] = 0;
+    }
+
+    return INGRESS_REPORT_SIZE;
+}
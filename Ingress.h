@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Ingress.h
+ * @brief      Rate limiting for incoming commands.
+ *
+ *             messageArrived() runs in the MQTT thread, so every message it
+ *             handles delays client.yield() and the keepalive. Before a 
+ *             message is copied anywhere, ingressAdmit() checks it against 
+ *             two token buckets: one for its forward target and one for its
+ *             message type within that target. A type gets half of its 
+ *             target's rate, so a flood of one type leaves room for the 
+ *             others, unless it is listed with a limit of its own (path 
+ *             uploads, which must arrive whole). Messages over the limit are
+ *             dropped and only counted.
+ *
+ *             While anything is being dropped, a report is published to 
+ *             INGRESS_TOPIC at most once per INGRESS_REPORT_INTERVAL_MS, and
+ *             once more when the drops stop. Counts are since the previous 
+ *             report, little endian, and saturate at 0xFFFF:
+ *
+ *                 [0]      1 while overloaded, 0 in the last report
+ *                 [1-2]    invalid messages (bad length, unknown target)
+ *                 [3-]     per FWD_TO_* target, in order:
+ *                            [0-1]  dropped by the rate limit
+ *                            [2-3]  dropped because the mailbox was full
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _INGRESS_H_
+#define _INGRESS_H_
+
+#include "mbed.h"
+#include "MQTTNetwork.h"
+
+#define INGRESS_TOPIC               "m3pi-mqtt-ee250/overload"
+#define INGRESS_REPORT_INTERVAL_MS  5000
+#define INGRESS_REPORT_SIZE         (3 + 4 * FWD_TARGET_COUNT)
+
+/* message types with their own bucket per target, the rest share the last */
+#define INGRESS_TYPE_BUCKETS        8
+
+/**
+ * Reasons for ingressDrop()
+ */
+enum {
+    INGRESS_DROP_POLICED,
+    INGRESS_DROP_FULL,
+    INGRESS_DROP_INVALID
+};
+
+/**
+ * @brief      Takes a token for a message. Call it from messageArrived() 
+ *             before allocating anything for the message.
+ *
+ * @param[in]  target  The FWD_TO_* target
+ * @param[in]  type    The message type
+ *
+ * @return     false if the message is over the limit (or the target is 
+ *             unknown) and must be dropped. It is already counted.
+ */
+bool ingressAdmit(int target, int type);
+
+/**
+ * @brief      Admits every message while enabled, still going through the 
+ *             buckets. Only for the benchmarks, which send far more than any
+ *             limit.
+ */
+void ingressSetUnlimited(bool unlimited);
+
+/**
+ * @brief      Counts a message dropped for another reason.
+ *
+ * @param[in]  target  The FWD_TO_* target, ignored for INGRESS_DROP_INVALID
+ * @param[in]  reason  An INGRESS_DROP_* reason
+ */
+void ingressDrop(int target, int reason);
+
+/**
+ * @brief      Returns true if messages were dropped during the last report 
+ *             interval.
+ */
+bool ingressOverloaded();
+
+/**
+ * @brief      Fills in the overload report when one is due. Call it from the
+ *             main loop, the same thread as messageArrived().
+ *
+ * @param      buf   Buffer of at least INGRESS_REPORT_SIZE bytes
+ *
+ * @return     Number of bytes written, 0 if there is nothing to publish
+ */
+int ingressNextReport(char *buf);
+
+#endif /* _INGRESS_H_ */
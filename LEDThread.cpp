@@ -37,7 +37,7 @@
 
 /**
  * @file       LEDThread.cpp
- * @brief      Implementation of thread that handles LED requests.
+ * @brief      Implementation of the worker that handles LED requests.
  *
  * @author     Jason Tran <jasontra@usc.edu>
  * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
@@ -46,91 +46,111 @@
 #include "LEDThread.h"
 #include "MQTTmbed.h"
 #include "MQTTNetwork.h"
+#include "Range.h"
 
-#include "MQTTClient.h"
-
-Mail<MailMsg, LEDTHREAD_MAILBOX_SIZE> LEDMailbox;
+/* the mailbox of the LED worker is allocated here, it runs on the normal
+   executor (see Topology.h) */
+static LEDWorker ledWorker;
+static EventQueue *queue;
 
 static DigitalOut led2(LED2);
 
-static const char *topic = "m3pi-mqtt-ee250/led-thread";
+#define LED_BLINK_TOGGLES   10
+#define LED_BLINK_MS        100
+
+/* the pending timer event of the current LED action, 0 if none */
+static int ledEvent = 0;
+static int blinkToggles;
+
+/* Publishing blocks on the MQTT mutex and the network, which a handler must
+   not do. The handler only counts the requests, the main loop publishes them
+   (ledNextPublish()). Each counter is written by one thread only. */
+static volatile uint32_t publishRequested = 0;
+static volatile uint32_t publishDone = 0;
+
+static void ledOff()
+{
+    ledEvent = 0;
+    led2 = 0;
+}
+
+static void ledBlinkStep()
+{
+    led2 = !led2;
+    if (--blinkToggles > 0) {
+        ledEvent = queue->call_in(LED_BLINK_MS, ledBlinkStep);
+    } else {
+        ledOff();
+    }
+}
+
+/* a new LED action replaces the one in progress */
+static void ledCancel()
+{
+    if (ledEvent) {
+        queue->cancel(ledEvent);
+    }
+    ledOff();
+}
+
+/* Called by the executor for every message in the LED worker's mailbox. The
+   worker frees the message after this returns. Instead of waiting, the LED 
+   actions finish in timer events, so the executor is free in the meantime. */
+static void handleLEDMessage(MailMsg *msg)
+{
+    /* integer math and no %f, see FixedPoint.h */
+    printf("Distance: %d mm\n", rangeReadMm());
+
+    /* the second byte in the message denotes the action type */
+    switch (msg->content[1]) {
+        case LED_THR_PUBLISH_MSG:
+            printf("LEDThread: received command to publish to topic"
+                   "m3pi-mqtt-example/led-thread\n");
+            publishRequested++;
+            break;
+        case LED_ON_ONE_SEC:
+            printf("LEDThread: received message to turn LED2 on for"
+                   "one second...\n");
+            ledCancel();
+            led2 = 1;
+            ledEvent = queue->call_in(1000, ledOff);
+            break;
+        case LED_BLINK_FAST:
+            printf("LEDThread: received message to blink LED2 fast for"
+                   "one second...\n");
+            ledCancel();
+            blinkToggles = LED_BLINK_TOGGLES;
+            ledBlinkStep();
+            break;
+        default:
+            printf("LEDThread: invalid message\n");
+            break;
+    }
+}
 
-void LEDThread(void *args) 
+void startLEDThread(EventQueue *eventQueue) 
 {
-    MQTT::Client<MQTTNetwork, Countdown> *client = (MQTT::Client<MQTTNetwork, Countdown> *)args;
-    extern void movement(char command, char speed, int delta_t);
-
-    MailMsg *msg;
-    MQTT::Message message;
-    osEvent evt;
-    char pub_buf[16];
-	double distance = 0;
-	double voltage = 0;
-
-    while(1) {
-    
-    	
-		AnalogIn Ain(p15);
-		voltage = Ain.read();
-		distance = voltage / 0.0098; //inches, Vcc = 5V
-		printf("Distance: %f \n", distance);
-
-   
-
-        evt = LEDMailbox.get();
-
-        if(evt.status == osEventMail) {
-            msg = (MailMsg *)evt.value.p;
-
-            /* the second byte in the message denotes the action type */
-            switch (msg->content[1]) {
-                case LED_THR_PUBLISH_MSG:
-                    printf("LEDThread: received command to publish to topic"
-                           "m3pi-mqtt-example/led-thread\n");
-                    pub_buf[0] = 'h';
-                    pub_buf[1] = 'i';
-                    message.qos = MQTT::QOS0;
-                    message.retained = false;
-                    message.dup = false;
-                    message.payload = (void*)pub_buf;
-                    message.payloadlen = 2; //MQTTclient.h takes care of adding null char?
-                    /* Lock the global MQTT mutex before publishing */
-                    mqttMtx.lock();
-                    client->publish(topic, message);
-                    mqttMtx.unlock();
-                    break;
-                case LED_ON_ONE_SEC:
-                    printf("LEDThread: received message to turn LED2 on for"
-                           "one second...\n");
-                    led2 = 1;
-                    wait(1);
-                    led2 = 0;
-                    break;
-                case LED_BLINK_FAST:
-                    printf("LEDThread: received message to blink LED2 fast for"
-                           "one second...\n");
-                    for(int i = 0; i < 10; i++)
-                    {
-                        led2 = !led2;
-                        wait(0.1);
-                    }
-                    led2 = 0;
-                    break;
-                default:
-                    printf("LEDThread: invalid message\n");
-                    break;
-            }            
-
-            LEDMailbox.free(msg);
-        }
-    } /* while */
-
-    /* this should never be reached */
+    queue = eventQueue;
+    ledWorker.start(queue, handleLEDMessage);
 }
 
-Mail<MailMsg, LEDTHREAD_MAILBOX_SIZE> *getLEDThreadMailbox() 
+LEDWorker *getLEDThreadMailbox() 
 {
-    return &LEDMailbox;
+    return &ledWorker;
 }
 
+uint32_t getLEDThreadHandledCount()
+{
+    return ledWorker.handled();
+}
 
+int ledNextPublish(char *buf)
+{
+    if (publishDone == publishRequested)
+        return 0;
+    publishDone++;
+
+    buf[0] = 'h';
+    buf[1] = 'i';
+    return LED_PUBLISH_SIZE;
+}
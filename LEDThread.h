@@ -37,7 +37,7 @@
 
 /**
  * @file       LEDThread.h
- * @brief      Thread that handles LED requests.
+ * @brief      Worker that handles LED requests.
  *
  * @author     Jason Tran <jasontra@usc.edu>
  * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
@@ -48,20 +48,44 @@
 
 #include "rtos.h"
 #include "MailMsg.h"
+#include "Worker.h"
 
-#define LEDTHREAD_MAILBOX_SIZE  32
+#define LEDTHREAD_MAILBOX_SIZE  16
+
+#define LED_TOPIC               "m3pi-mqtt-ee250/led-thread"
+#define LED_PUBLISH_SIZE        2
+
+/* see Worker.h and Topology.h */
+typedef EventWorker<MailMsg, LEDTHREAD_MAILBOX_SIZE> LEDWorker;
 
 /**
- * @brief      Main LED thread function.
+ * @brief      Starts handling LED requests.
  *
- * @param      args  Pointer to the MQTT client so the LED thread can .publish().
+ * @param      queue  Queue of the executor to run on
+ */
+void startLEDThread(EventQueue *queue);
+
+/**
+ * @brief      Returns a pointer to the led worker's mailbox
+ * @return     Pointer to LED worker's mailbox
  */
-void LEDThread(void *args);
+LEDWorker *getLEDThreadMailbox();
 
 /**
- * @brief      Returns a pointer to the led thread's mailbox
- * @return     Pointer to LED thread's mailbox
+ * @brief      Returns how many messages the led worker has handled so far.
+ *             Together with a count of put()s, this gives the mailbox depth.
+ */
+uint32_t getLEDThreadHandledCount();
+
+/**
+ * @brief      Formats the next message the LED worker was asked to publish to
+ *             LED_TOPIC. Call this from the MQTT thread until it returns 0, 
+ *             the worker does not publish itself.
+ *
+ * @param      buf   Buffer of at least LED_PUBLISH_SIZE bytes
+ *
+ * @return     Number of bytes written, 0 if there is nothing to publish
  */
-Mail<MailMsg, LEDTHREAD_MAILBOX_SIZE> *getLEDThreadMailbox();
+int ledNextPublish(char *buf);
 
 #endif /* _LEDTHREAD_H_ */
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Latest.h
+ * @brief      Single-slot register that always holds the newest value.
+ *
+ *             For inputs where only the newest one matters, like a joystick
+ *             direction. A writer overwrites the slot instead of queueing, so
+ *             a burst of updates costs no memory and leaves no backlog.
+ *             Readers never block and never see a half written value.
+ *
+ *             It is a sequence lock: the writer makes the sequence number
+ *             odd, writes, then makes it even again. A read that saw an odd
+ *             number, or a number that changed while it copied, is retried.
+ *             The sequence number also tells readers whether anything new
+ *             arrived.
+ *
+ *             There must only be one writer at a time. A reader that can
+ *             interrupt the writer (an ISR reading what a thread writes) must
+ *             use tryRead(), since retrying would spin forever. It simply
+ *             gets the value at its next tick instead.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _LATEST_H_
+#define _LATEST_H_
+
+#include "mbed.h"
+
+template <typename T>
+class LatestValue {
+public:
+    LatestValue() : _seq(0) {
+        memset(&_value, 0, sizeof(_value));
+    }
+
+    /**
+     * @brief      Replaces the value. Only one writer at a time.
+     */
+    void write(const T &value) {
+        _seq++;
+        __DMB();
+        _value = value;
+        __DMB();
+        _seq++;
+    }
+
+    /**
+     * @brief      Copies out the newest value, retrying while a write is in
+     *             progress. Never call this from an ISR that can interrupt
+     *             the writer.
+     *
+     * @param      value  Receives the value
+     *
+     * @return     The sequence number of the value, 0 if nothing has been
+     *             written yet. It grows by 2 with every write.
+     */
+    uint32_t read(T *value) const {
+        uint32_t seq;
+
+        while (!tryRead(value, &seq)) {
+            /* a write is in progress */
+        }
+        return seq;
+    }
+
+    /**
+     * @brief      Copies out the newest value in one attempt. Safe anywhere.
+     *
+     * @param      value  Receives the value. Left unspecified on failure.
+     * @param      seq    Receives the sequence number of the value
+     *
+     * @return     false if a write was in progress
+     */
+    bool tryRead(T *value, uint32_t *seq) const {
+        uint32_t before = _seq;
+        __DMB();
+        *value = _value;
+        __DMB();
+        *seq = before;
+        return !(before & 1) && before == _seq;
+    }
+
+    /**
+     * @brief      Returns the sequence number of the newest value without
+     *             copying it.
+     */
+    uint32_t sequence() const {
+        return _seq & ~1UL;
+    }
+
+private:
+    volatile uint32_t _seq;
+    T _value;
+};
+
+#endif /* _LATEST_H_ */
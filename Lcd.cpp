@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Lcd.cpp
+ * @brief      Implementation of the LCD framebuffer and its update thread.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Lcd.h"
+#include "rtos.h"
+#include "m3pi.h"
+#include <stdarg.h>
+
+extern m3pi m3pi;
+extern Mutex m3piMtx;
+
+/* Moving the cursor costs 3 bytes and starting a print 2, so two changed
+   characters this close together are cheaper to send as one run. */
+#define LCD_MAX_GAP             4
+
+/* what we want on the LCD, and what it shows */
+static char frame[LCD_ROWS][LCD_COLUMNS];
+static char shown[LCD_ROWS][LCD_COLUMNS];
+
+static Semaphore lcdDirty(0);
+static bool lcdPending = false;    /* lcdDirty has been released */
+
+/* Copies len characters into the framebuffer and wakes the LCD thread if 
+   that changed anything */
+static void lcdSet(int col, int row, const char *text, int len)
+{
+    bool wake = false;
+
+    if (row < 0 || row >= LCD_ROWS || col < 0 || col >= LCD_COLUMNS)
+        return;
+    if (len > LCD_COLUMNS - col)
+        len = LCD_COLUMNS - col;
+
+    core_util_critical_section_enter();
+    for (int i = 0; i < len; i++) {
+        if (frame[row][col + i] != text[i]) {
+            frame[row][col + i] = text[i];
+            if (!lcdPending) {
+                lcdPending = true;
+                wake = true;
+            }
+        }
+    }
+    core_util_critical_section_exit();
+
+    if (wake)
+        lcdDirty.release();
+}
+
+void lcdWrite(int col, int row, const char *text)
+{
+    lcdSet(col, row, text, strlen(text));
+}
+
+void lcdPrintf(int row, const char *fmt, ...)
+{
+    char line[LCD_COLUMNS + 1];
+    va_list args;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (len < 0)
+        len = 0;
+    for (int i = len; i < LCD_COLUMNS; i++)
+        line[i] = ' ';
+
+    lcdSet(0, row, line, LCD_COLUMNS);
+}
+
+void lcdClear()
+{
+    char blank[LCD_COLUMNS];
+
+    memset(blank, ' ', sizeof(blank));
+    for (int row = 0; row < LCD_ROWS; row++)
+        lcdSet(0, row, blank, LCD_COLUMNS);
+}
+
+/* Sends the changed characters of one row, one run at a time */
+static void lcdUpdateRow(int row)
+{
+    char want[LCD_COLUMNS];
+    int col = 0;
+    int start, end;
+
+    core_util_critical_section_enter();
+    memcpy(want, frame[row], LCD_COLUMNS);
+    core_util_critical_section_exit();
+
+    while (col < LCD_COLUMNS) {
+        if (want[col] == shown[row][col]) {
+            col++;
+            continue;
+        }
+
+        /* extend the run over short gaps of unchanged characters */
+        start = col;
+        end = col + 1;
+        for (col = end; col < LCD_COLUMNS && col - end < LCD_MAX_GAP; col++) {
+            if (want[col] != shown[row][col])
+                end = col + 1;
+        }
+        col = end;
+
+        m3piMtx.lock();
+        m3pi.locate(start, row);
+        m3pi.print(&want[start], end - start);
+        m3piMtx.unlock();
+
+        memcpy(&shown[row][start], &want[start], end - start);
+    }
+}
+
+void lcdThread()
+{
+    memset(shown, ' ', sizeof(shown));
+    core_util_critical_section_enter();
+    for (int row = 0; row < LCD_ROWS; row++) {
+        for (int col = 0; col < LCD_COLUMNS; col++) {
+            if (frame[row][col] == '\0')
+                frame[row][col] = ' ';
+        }
+    }
+    core_util_critical_section_exit();
+
+    m3piMtx.lock();
+    m3pi.cls();
+    m3piMtx.unlock();
+
+    while (1) {
+        lcdDirty.wait();
+
+        core_util_critical_section_enter();
+        lcdPending = false;
+        core_util_critical_section_exit();
+
+        for (int row = 0; row < LCD_ROWS; row++)
+            lcdUpdateRow(row);
+
+        /* bound the refresh rate, changes in the meantime are batched */
+        Thread::wait(LCD_REFRESH_MS);
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Lcd.h
+ * @brief      Framebuffer for the 3pi's 8x2 character LCD.
+ *
+ *             Any thread can write to the framebuffer at any time. Writes only
+ *             touch RAM, so they are cheap enough for loops. The LCD thread 
+ *             compares the framebuffer against what the LCD shows and sends 
+ *             only the characters that changed, at most once every 
+ *             LCD_REFRESH_MS, and only while something changed. It locks 
+ *             m3piMtx once per run of changed characters, so motor commands 
+ *             never wait long behind the LCD.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _LCD_H_
+#define _LCD_H_
+
+#include "mbed.h"
+
+#define LCD_COLUMNS             8
+#define LCD_ROWS                2
+
+/* shortest time between two LCD updates */
+#define LCD_REFRESH_MS          200
+
+#define LCD_THREAD_STACK_SIZE   1024
+
+/**
+ * @brief      Main LCD thread function. Clears the LCD, then keeps it in sync 
+ *             with the framebuffer. Start it after the 3pi is reset.
+ */
+void lcdThread();
+
+/**
+ * @brief      Writes text into the framebuffer. Text past the end of the row 
+ *             is cut off.
+ *
+ * @param[in]  col   Column to start at, 0 - 7
+ * @param[in]  row   Row, 0 or 1
+ * @param[in]  text  The text
+ */
+void lcdWrite(int col, int row, const char *text);
+
+/**
+ * @brief      Formats a whole row of the framebuffer, padded with spaces.
+ *
+ * @param[in]  row   Row, 0 or 1
+ * @param[in]  fmt   printf() format
+ */
+void lcdPrintf(int row, const char *fmt, ...);
+
+/**
+ * @brief      Blanks the framebuffer.
+ */
+void lcdClear();
+
+#endif /* _LCD_H_ */
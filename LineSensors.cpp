@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       LineSensors.cpp
+ * @brief      Line sensor calibration that survives resets.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "LineSensors.h"
+#include "m3pi.h"
+#include "Config.h"
+#include "Path.h"
+#include "Teleop.h"
+#include "Nav.h"
+#include "FixedPoint.h"
+#include "FlightRecorder.h"
+
+extern m3pi m3pi;
+
+/* left, right, left again, so the sensors pass over the line both ways */
+static const PathSegment calibrationPath[] = {
+    {  LINE_CAL_SPEED, -LINE_CAL_SPEED,     LINE_CAL_SWEEP_MS },
+    { -LINE_CAL_SPEED,  LINE_CAL_SPEED, 2 * LINE_CAL_SWEEP_MS },
+    {  LINE_CAL_SPEED, -LINE_CAL_SPEED,     LINE_CAL_SWEEP_MS },
+};
+
+static uint16_t calDark[LINE_SENSOR_COUNT];
+static uint16_t calBright[LINE_SENSOR_COUNT];
+static volatile bool calibrated = false;
+
+/* set by lineCalibrate(), cleared by the motion thread when the spin ends */
+static volatile bool calibrating = false;
+static uint16_t newDark[LINE_SENSOR_COUNT];
+static uint16_t newBright[LINE_SENSOR_COUNT];
+
+static volatile bool savePending = false;
+static volatile bool drifted = false;
+static int driftReads = 0;
+static int driftTicks = 0;
+
+static int pack(uint8_t *buf)
+{
+    buf[0] = LINE_CAL_VERSION;
+    for (int i = 0; i < LINE_SENSOR_COUNT; i++) {
+        buf[1 + 2 * i] = calDark[i] & 0xFF;
+        buf[2 + 2 * i] = calDark[i] >> 8;
+        buf[1 + 2 * LINE_SENSOR_COUNT + 2 * i] = calBright[i] & 0xFF;
+        buf[2 + 2 * LINE_SENSOR_COUNT + 2 * i] = calBright[i] >> 8;
+    }
+    return LINE_CAL_SIZE;
+}
+
+void lineInit()
+{
+    uint8_t buf[LINE_CAL_SIZE];
+
+    if (configGetBytes(CFG_LINE_CALIBRATION, buf, sizeof(buf)) != 
+            LINE_CAL_SIZE || buf[0] != LINE_CAL_VERSION) {
+        printf("line: not calibrated\n");
+        return;
+    }
+
+    for (int i = 0; i < LINE_SENSOR_COUNT; i++) {
+        calDark[i] = buf[1 + 2 * i] | (buf[2 + 2 * i] << 8);
+        calBright[i] = buf[1 + 2 * LINE_SENSOR_COUNT + 2 * i] | 
+                       (buf[2 + 2 * LINE_SENSOR_COUNT + 2 * i] << 8);
+    }
+    calibrated = true;
+    frRecord(FR_EVT_LINE_CAL, LINE_CAL_RESTORED, 0);
+    printf("line: calibration restored\n");
+}
+
+bool lineIsCalibrated()
+{
+    return calibrated;
+}
+
+void lineCalibrate()
+{
+    if (calibrating || pathIsPlaying() || teleopIsActive())
+        return;
+
+    for (int i = 0; i < LINE_SENSOR_COUNT; i++) {
+        newDark[i] = 0;
+        newBright[i] = 0xFFFF;
+    }
+    drifted = false;
+    driftReads = 0;
+
+    /* start the spin first so the motion thread cannot take a path that has
+       not started yet for one that ended */
+    pathPlay(calibrationPath, 
+             sizeof(calibrationPath) / sizeof(calibrationPath[0]));
+    calibrating = true;
+}
+
+void lineForget()
+{
+    uint8_t none = 0;
+
+    calibrated = false;
+    drifted = false;
+    /* a version of 0 never matches, so this is the same as not set */
+    configSetBytes(CFG_LINE_CALIBRATION, &none, 1, true);
+}
+
+void lineCalibrationTick()
+{
+    uint16_t raw[LINE_SENSOR_COUNT];
+    int16_t pos;
+    int i;
+
+    if (!calibrating) {
+        /* the position itself is not needed here, only the drift check */
+        if (calibrated && !drifted && ++driftTicks >= LINE_DRIFT_CHECK_TICKS) {
+            driftTicks = 0;
+            lineReadPosition(&pos);
+        }
+        return;
+    }
+
+    if (pathIsPlaying()) {
+        m3pi.raw_sensor_values(raw);
+        for (i = 0; i < LINE_SENSOR_COUNT; i++) {
+            if (raw[i] > newDark[i])
+                newDark[i] = raw[i];
+            if (raw[i] < newBright[i])
+                newBright[i] = raw[i];
+        }
+        return;
+    }
+
+    /* the spin is over. Keep the old calibration if a sensor never saw 
+       the line. */
+    calibrating = false;
+    for (i = 0; i < LINE_SENSOR_COUNT; i++) {
+        if (newDark[i] < newBright[i] + LINE_CAL_MIN_RANGE) {
+            frRecord(FR_EVT_LINE_CAL, LINE_CAL_FAILED, i);
+            return;
+        }
+    }
+
+    memcpy(calDark, newDark, sizeof(calDark));
+    memcpy(calBright, newBright, sizeof(calBright));
+    calibrated = true;
+    savePending = true;
+    frRecord(FR_EVT_LINE_CAL, LINE_CAL_DONE, 0);
+}
+
+bool lineReadPosition(int16_t *posQ15)
+{
+    uint16_t raw[LINE_SENSOR_COUNT];
+    uint32_t sum = 0, weighted = 0;
+    bool onLine = false;
+    bool outside = false;
+
+    if (!calibrated || calibrating)
+        return false;
+
+    m3pi.raw_sensor_values(raw);
+
+    for (int i = 0; i < LINE_SENSOR_COUNT; i++) {
+        int range = calDark[i] - calBright[i];
+        int v = (int)raw[i] - calBright[i];
+
+        if (raw[i] + LINE_DRIFT_MARGIN < calBright[i] || 
+            raw[i] > calDark[i] + LINE_DRIFT_MARGIN)
+            outside = true;
+
+        /* 0 (bright) to 1000 (dark) */
+        v = (v <= 0) ? 0 : (v >= range) ? 1000 : v * 1000 / range;
+        if (v > 200)
+            onLine = true;
+        /* ignore noise, like the 3pi's own read_line() */
+        if (v > 50) {
+            weighted += (uint32_t)v * i * 1000;
+            sum += v;
+        }
+    }
+
+    driftReads = outside ? driftReads + 1 : 0;
+    if (driftReads == LINE_DRIFT_READS) {
+        drifted = true;
+        frRecord(FR_EVT_LINE_CAL, LINE_CAL_DRIFT, 0);
+    }
+
+    if (!onLine || sum == 0)
+        return false;
+
+    /* 0 to 4000, 2000 in the middle */
+    *posQ15 = fix15Sat(((int32_t)(weighted / sum) - 2000) << 4);
+    return true;
+}
+
+void linePoll()
+{
+    uint8_t buf[LINE_CAL_SIZE];
+
+    if (savePending) {
+        savePending = false;
+        configSetBytes(CFG_LINE_CALIBRATION, buf, pack(buf), true);
+        printf("line: calibration saved\n");
+    }
+
+    /* recalibrate only while nothing else drives the robot */
+    if (drifted && !calibrating && !pathIsPlaying() && !teleopIsActive() &&
+        !navIsActive())
+        lineCalibrate();
+}
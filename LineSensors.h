@@ -0,0 +1,144 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       LineSensors.h
+ * @brief      Line sensor calibration that survives resets.
+ *
+ *             The 3pi keeps its line sensor calibration in RAM and has no 
+ *             way to hand it over, so it is lost on every reset. Instead, we
+ *             calibrate on the mbed: lineCalibrate() spins the robot left and
+ *             right while the motion thread reads the raw sensors and keeps
+ *             the darkest and brightest reading of each. The result is 
+ *             stored in the config store (CFG_LINE_CALIBRATION), which has a 
+ *             version and a checksum, and restored by lineInit() at boot. 
+ *             The robot only spins again when asked to, or when readings 
+ *             drift outside the stored range (e.g. on a different floor).
+ *
+ *             Stored value, little endian:
+ *
+ *                 [0]      LINE_CAL_VERSION
+ *                 [1-10]   darkest raw reading of each sensor
+ *                 [11-20]  brightest raw reading of each sensor
+ *
+ *             Controlled with FWD_TO_LINE messages (see MQTTNetwork.h).
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _LINESENSORS_H_
+#define _LINESENSORS_H_
+
+#include "mbed.h"
+
+#define LINE_SENSOR_COUNT       5
+#define LINE_CAL_VERSION        1
+#define LINE_CAL_SIZE           (1 + 4 * LINE_SENSOR_COUNT)
+
+/* raw readings run from 0 (bright) to 2000 (dark). A sensor that saw less 
+   difference than this while spinning did not see a line. */
+#define LINE_CAL_MIN_RANGE      200
+
+#define LINE_CAL_SPEED          30
+#define LINE_CAL_SWEEP_MS       400
+
+/* readings this far outside the calibration count as drift, and this many 
+   in a row start a new calibration once the robot is idle. While the robot
+   drives, the motion thread reads the sensors every LINE_DRIFT_CHECK_TICKS
+   to look for drift, so it takes LINE_DRIFT_READS * 100 ms on a new floor. */
+#define LINE_DRIFT_MARGIN       150
+#define LINE_DRIFT_READS        20
+#define LINE_DRIFT_CHECK_TICKS  10
+
+/**
+ * Calibration events in the flight recorder (FR_EVT_LINE_CAL)
+ */
+enum {
+    LINE_CAL_RESTORED,
+    LINE_CAL_DONE,
+    LINE_CAL_FAILED,    /* b: the sensor that never saw the line */
+    LINE_CAL_DRIFT
+};
+
+/**
+ * @brief      Restores the stored calibration. Call after configInit().
+ */
+void lineInit();
+
+/**
+ * @brief      Returns true if a calibration is loaded.
+ */
+bool lineIsCalibrated();
+
+/**
+ * @brief      Starts calibrating. The robot spins in place for about 
+ *             4 * LINE_CAL_SWEEP_MS. Ignored while a path is playing or 
+ *             teleop is driving.
+ */
+void lineCalibrate();
+
+/**
+ * @brief      Forgets the calibration, also in flash.
+ */
+void lineForget();
+
+/**
+ * @brief      Motion thread hook, samples the sensors on every tick while 
+ *             calibrating, and every LINE_DRIFT_CHECK_TICKS otherwise to 
+ *             watch for drift. Call it with m3piMtx held.
+ */
+void lineCalibrationTick();
+
+/**
+ * @brief      Reads the position of the line with our calibration. Also 
+ *             watches for drift. Call it with m3piMtx held.
+ *
+ * @param      posQ15  Receives the position in Q15, -1.0 on the left to 1.0
+ *                     on the right, like m3pi::line_position_q15()
+ *
+ * @return     false if there is no calibration or no line under the robot
+ */
+bool lineReadPosition(int16_t *posQ15);
+
+/**
+ * @brief      Saves a finished calibration and starts a new one after drift.
+ *             Call it from the main loop, since saving stalls the CPU.
+ */
+void linePoll();
+
+#endif /* _LINESENSORS_H_ */
@@ -0,0 +1,209 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Link.cpp
+ * @brief      Implementation of the link quality measurement.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Link.h"
+#include "FlightRecorder.h"
+
+#define LINK_MAX_TOPIC_LEN  64
+
+MBED_STATIC_ASSERT(LINK_WINDOW * LINK_PROBE_INTERVAL_MS > LINK_PROBE_TIMEOUT_MS,
+                   "a probe times out before its slot is reused");
+
+enum {
+    PROBE_UNUSED,
+    PROBE_PENDING,
+    PROBE_ACKED,
+    PROBE_LOST
+};
+
+typedef struct {
+    uint8_t  state;
+    uint16_t seq;
+    uint32_t sentUs;
+} LinkProbe;
+
+static char probeTopic[LINK_MAX_TOPIC_LEN];
+static LinkProbe probes[LINK_WINDOW];
+static uint16_t nextSeq = 0;
+
+/* smoothed round trip time in us, like TCP's */
+static uint32_t srttUs = 0;
+
+static uint8_t quality = 100;
+static volatile int mode = LINK_MODE_STREAMING;
+
+void linkInit(const char *clientId)
+{
+    snprintf(probeTopic, sizeof(probeTopic), "%s%s", LINK_PROBE_TOPIC_PREFIX,
+             clientId);
+}
+
+const char *linkProbeTopic()
+{
+    return probeTopic;
+}
+
+/* loss over the resolved probes in the window, in permille */
+static uint16_t lossPermille()
+{
+    int lost = 0, resolved = 0;
+
+    for (int i = 0; i < LINK_WINDOW; i++) {
+        if (probes[i].state == PROBE_LOST)
+            lost++;
+        if (probes[i].state == PROBE_LOST || probes[i].state == PROBE_ACKED)
+            resolved++;
+    }
+
+    return resolved ? lost * 1000 / resolved : 0;
+}
+
+static void updateQuality()
+{
+    uint32_t rttMs = srttUs / 1000;
+    int q = 100;
+
+    /* every 1% of loss costs 2 points, a slow round trip up to 50 */
+    q -= lossPermille() / 5;
+    if (rttMs > LINK_RTT_BAD_MS)
+        q -= 50;
+    else if (rttMs > LINK_RTT_GOOD_MS)
+        q -= 50 * (rttMs - LINK_RTT_GOOD_MS) / 
+             (LINK_RTT_BAD_MS - LINK_RTT_GOOD_MS);
+    if (q < 0)
+        q = 0;
+    quality = q;
+
+    /* hysteresis, so a link on the edge does not flip back and forth */
+    if (mode == LINK_MODE_STREAMING && quality < LINK_BATCH_BELOW) {
+        mode = LINK_MODE_BATCHED;
+        frRecord(FR_EVT_LINK_MODE, mode, quality);
+    } else if (mode == LINK_MODE_BATCHED && quality > LINK_STREAM_ABOVE) {
+        mode = LINK_MODE_STREAMING;
+        frRecord(FR_EVT_LINK_MODE, mode, quality);
+    }
+}
+
+int linkFormatProbe(char *buf)
+{
+    uint32_t now = us_ticker_read();
+    LinkProbe *p;
+
+    for (int i = 0; i < LINK_WINDOW; i++) {
+        if (probes[i].state == PROBE_PENDING && 
+            now - probes[i].sentUs > LINK_PROBE_TIMEOUT_MS * 1000UL)
+            probes[i].state = PROBE_LOST;
+    }
+
+    /* the oldest probe makes room. It timed out long before, so it is 
+       already counted as acked or lost. */
+    p = &probes[nextSeq & (LINK_WINDOW - 1)];
+    p->state = PROBE_PENDING;
+    p->seq = nextSeq;
+    p->sentUs = now;
+
+    buf[0] = nextSeq & 0xFF;
+    buf[1] = nextSeq >> 8;
+    nextSeq++;
+
+    updateQuality();
+    return LINK_PROBE_SIZE;
+}
+
+void linkMessageArrived(MQTT::MessageData& md)
+{
+    MQTT::Message &message = md.message;
+    const uint8_t *b = (const uint8_t *)message.payload;
+    uint16_t seq;
+    uint32_t rtt;
+    LinkProbe *p;
+
+    if (message.payloadlen < LINK_PROBE_SIZE)
+        return;
+
+    seq = b[0] | (b[1] << 8);
+    p = &probes[seq & (LINK_WINDOW - 1)];
+    if (p->state != PROBE_PENDING || p->seq != seq)
+        return;
+
+    p->state = PROBE_ACKED;
+    rtt = us_ticker_read() - p->sentUs;
+
+    if (srttUs == 0)
+        srttUs = rtt;
+    else
+        srttUs += ((int32_t)rtt - (int32_t)srttUs) / 8;
+
+    updateQuality();
+}
+
+int linkFormatStatus(char *buf)
+{
+    uint16_t rttMs = (srttUs / 1000 > 0xFFFF) ? 0xFFFF : srttUs / 1000;
+    uint16_t loss = lossPermille();
+    int rate = LINK_MIN_RATE_HZ + 
+               (LINK_MAX_RATE_HZ - LINK_MIN_RATE_HZ) * quality / 100;
+
+    buf[0] = mode;
+    buf[1] = quality;
+    buf[2] = rttMs & 0xFF;
+    buf[3] = rttMs >> 8;
+    buf[4] = loss & 0xFF;
+    buf[5] = loss >> 8;
+    buf[6] = rate;
+
+    return LINK_STATUS_SIZE;
+}
+
+int linkGetMode()
+{
+    return mode;
+}
+
+int linkPeriod(int streamingMs)
+{
+    return mode == LINK_MODE_BATCHED ? streamingMs * LINK_BATCH_FACTOR 
+                                     : streamingMs;
+}
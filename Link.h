@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Link.h
+ * @brief      Link quality measurement and adaptive publish rate.
+ *
+ *             Every LINK_PROBE_INTERVAL_MS, the robot publishes a probe to its
+ *             own probe topic and the broker echoes it back. From the echoes
+ *             we keep a smoothed round trip time and the loss over the last 
+ *             LINK_WINDOW probes, and turn them into a quality from 0 to 100.
+ *
+ *             When the quality drops below LINK_BATCH_BELOW, the robot 
+ *             switches from streaming to batched mode, and goes back above 
+ *             LINK_STREAM_ABOVE. In batched mode, the periodic publishes 
+ *             (swarm state, grid diffs, nav status, time sync and power 
+ *             reports) go out LINK_BATCH_FACTOR times less often (see 
+ *             linkPeriod()) so commands still get through. Nothing is 
+ *             combined into fewer messages. Probes, the link status and 
+ *             publishes that answer a command or an event keep their rate.
+ *
+ *             The status is published to LINK_STATUS_TOPIC after every probe,
+ *             as raw bytes, little endian:
+ *
+ *                 [0]      mode (LINK_MODE_*)
+ *                 [1]      quality, 0 - 100
+ *                 [2-3]    smoothed round trip time in ms
+ *                 [4-5]    loss in permille
+ *                 [6]      recommended command rate in Hz
+ *
+ *             Controllers should not send commands faster than the 
+ *             recommended rate.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _LINK_H_
+#define _LINK_H_
+
+#include "mbed.h"
+#include "MQTTClient.h"
+
+#define LINK_STATUS_TOPIC       "m3pi-mqtt-ee250/status"
+
+/* each robot echoes probes on LINK_PROBE_TOPIC_PREFIX<client id> */
+#define LINK_PROBE_TOPIC_PREFIX "m3pi-mqtt-ee250/link-probe/"
+
+#define LINK_PROBE_INTERVAL_MS  1000
+#define LINK_PROBE_TIMEOUT_MS   3000
+#define LINK_PROBE_SIZE         2
+#define LINK_STATUS_SIZE        7
+
+/* probes that loss is counted over, must be a power of 2 */
+#define LINK_WINDOW             16
+
+/* round trip times that cost nothing and everything in quality */
+#define LINK_RTT_GOOD_MS        100
+#define LINK_RTT_BAD_MS         1500
+
+#define LINK_BATCH_BELOW        50
+#define LINK_STREAM_ABOVE       70
+/* Keep this below 4 so the swarm state still arrives before neighbors expire 
+   (SWARM_EXPIRY_MS) */
+#define LINK_BATCH_FACTOR       3
+
+#define LINK_MAX_RATE_HZ        20
+#define LINK_MIN_RATE_HZ        2
+
+enum {
+    LINK_MODE_STREAMING,
+    LINK_MODE_BATCHED
+};
+
+/**
+ * @brief      Sets up the probe topic. Call it before subscribing.
+ *
+ * @param[in]  clientId  Our MQTT client id, to make the topic unique
+ */
+void linkInit(const char *clientId);
+
+/**
+ * @brief      Returns the topic to subscribe linkMessageArrived() to and to
+ *             publish probes on.
+ */
+const char *linkProbeTopic();
+
+/**
+ * @brief      Fills in the next probe and starts timing it. Also times out
+ *             probes that never came back.
+ *
+ * @param      buf   Buffer of at least LINK_PROBE_SIZE bytes
+ *
+ * @return     Number of bytes written
+ */
+int linkFormatProbe(char *buf);
+
+/**
+ * @brief      MQTT callback for linkProbeTopic().
+ */
+void linkMessageArrived(MQTT::MessageData& md);
+
+/**
+ * @brief      Fills in the link status for publishing.
+ *
+ * @param      buf   Buffer of at least LINK_STATUS_SIZE bytes
+ *
+ * @return     Number of bytes written
+ */
+int linkFormatStatus(char *buf);
+
+/**
+ * @brief      Returns LINK_MODE_STREAMING or LINK_MODE_BATCHED.
+ */
+int linkGetMode();
+
+/**
+ * @brief      Returns the period to publish at, stretched in batched mode.
+ *
+ * @param[in]  streamingMs  The period in streaming mode
+ */
+int linkPeriod(int streamingMs);
+
+#endif /* _LINK_H_ */
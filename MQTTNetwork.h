@@ -13,7 +13,14 @@ extern Mutex mqttMtx;
  */
 enum {
     FWD_TO_PRINT_THR = 0,
-    FWD_TO_LED_THR   = 1
+    FWD_TO_LED_THR   = 1,
+    FWD_TO_POWER     = 2,
+    FWD_TO_SERIAL_LOG = 3,
+    FWD_TO_PATH      = 4,
+    FWD_TO_TELEOP    = 5,
+    FWD_TO_LINE      = 6,
+    FWD_TO_NAV       = 7,
+    FWD_TARGET_COUNT
 }; 
 
 /**
@@ -33,6 +40,68 @@ enum {
     PRINT_MSG_TYPE_1
 };
 
+/**
+ * Power management task types. These are handled right in messageArrived()
+ * since they only flip a flag.
+ */
+enum {
+    POWER_SLEEP_OFF,
+    POWER_SLEEP_ON
+};
+
+/**
+ * m3pi serial record/replay task types (see SerialLog.h)
+ */
+enum {
+    SERIAL_LOG_RECORD,
+    SERIAL_LOG_STOP,
+    SERIAL_LOG_REPLAY,
+    SERIAL_LOG_REPLAY_STOP
+};
+
+/**
+ * Path record/playback task types (see Path.h)
+ */
+enum {
+    PATH_RECORD,
+    PATH_STOP,
+    PATH_PLAY,
+    PATH_ABORT,
+    PATH_UPLOAD,
+    PATH_DOWNLOAD
+};
+
+/**
+ * Line sensor task types (see LineSensors.h)
+ */
+enum {
+    LINE_CALIBRATE,
+    LINE_FORGET
+};
+
+/**
+ * Navigation task types (see Nav.h)
+ */
+enum {
+    NAV_GOTO,
+    NAV_CANCEL
+};
+
+/**
+ * Teleop directions (see Teleop.h)
+ */
+enum {
+    MOVE_STOP,
+    MOVE_LEFT,
+    MOVE_FORWARD_LEFT,
+    MOVE_FORWARD,
+    MOVE_FORWARD_RIGHT,
+    MOVE_RIGHT,
+    MOVE_BACK_RIGHT,
+    MOVE_BACK,
+    MOVE_BACK_LEFT
+};
+
 /**
  * @brief      ESP8266 and TCPSocket Wrapper for MQTTClient.h
  */
@@ -0,0 +1,339 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Motion.cpp
+ * @brief      Implementation of the motion profile generator.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Motion.h"
+#include "Reflex.h"
+#include "LineSensors.h"
+#include "FlightRecorder.h"
+#include "m3pi.h"
+#include "FixedPoint.h"
+#include "Path.h"
+#include "Grid.h"
+#include "Range.h"
+
+extern m3pi m3pi;
+
+/* Wheel speeds are kept in Q8 fixed point (speed units * 256) so that small
+   per-tick acceleration steps do not get lost to integer rounding. */
+#define Q8(x)   ((int32_t)(x) << 8)
+
+/* Convert limits given per second into limits per tick */
+#define ACCEL_PER_TICK(a)   ((int32_t)(a) * 256 * MOTION_TICK_MS / 1000)
+#define JERK_PER_TICK(j)    ((int32_t)(j) * 256 * MOTION_TICK_MS \
+                             * MOTION_TICK_MS / 1000000)
+
+typedef struct {
+    int32_t vel;    /* current speed, Q8 */
+    int32_t acc;    /* current acceleration, Q8 per tick */
+    int     sent;   /* last speed written to the m3pi */
+} WheelProfile;
+
+/* The command shared with motionCommand(). Only touch it inside a critical 
+   section since motionCommand() may be called from an ISR. */
+static int32_t targetLeft;
+static int32_t targetRight;
+static uint32_t holdTicks;
+
+static int32_t accelLimit = ACCEL_PER_TICK(MOTION_DEFAULT_ACCEL_LIMIT);
+static int32_t jerkLimit = JERK_PER_TICK(MOTION_DEFAULT_JERK_LIMIT);
+
+/* Pose in Q8 mm, updated by the motion thread. Read it with motionGetPose(). */
+static int32_t poseX = 0;
+static int32_t poseY = 0;
+static uint16_t poseHeading = 0;
+static int16_t poseSpeed = 0;
+
+static Ticker motionTicker;
+static Semaphore motionTick(0);
+
+/* The ticker is detached while both wheels are at rest so the CPU can stay
+   asleep (see Power.h). motionCommand() wakes the thread back up. */
+static volatile bool ticking = false;
+
+static void onMotionTick()
+{
+    motionTick.release();
+}
+
+static int32_t clampSpeed(int speed)
+{
+    if (speed > MAX_SPEED)
+        return MAX_SPEED;
+    if (speed < MAX_REVERSE)
+        return MAX_REVERSE;
+    return speed;
+}
+
+/**
+ * @brief      Moves one wheel a single tick closer to its target speed.
+ *
+ *             The acceleration itself may only change by jerkLimit per tick.
+ *             Once the speed left to gain is no more than what we would gain
+ *             anyway while easing the acceleration back to zero, we start 
+ *             easing off so the wheel lands on the target without overshoot.
+ */
+static void stepWheel(WheelProfile *w, int32_t target, int32_t amax,
+                      int32_t jmax)
+{
+    int32_t old = w->vel;
+    int32_t dv = target - old;
+    int32_t a = w->acc;
+    int32_t absA = (a < 0) ? -a : a;
+    int32_t easing = absA * (absA / jmax + 1) / 2;
+    int32_t want;
+
+    if (dv == 0 && a == 0)
+        return;
+
+    if ((dv > 0 && a > 0 && dv <= easing) || (dv < 0 && a < 0 && -dv <= easing))
+        want = 0;
+    else if (dv > 0)
+        want = amax;
+    else if (dv < 0)
+        want = -amax;
+    else
+        want = 0;
+
+    if (want > a + jmax)
+        a += jmax;
+    else if (want < a - jmax)
+        a -= jmax;
+    else
+        a = want;
+
+    w->vel += a;
+
+    /* never run past the target. Only when this tick crossed it: if the 
+       target moved behind a wheel that is still accelerating, the jerk 
+       limit turns it around instead. */
+    if ((old <= target && w->vel > target) || 
+            (old >= target && w->vel < target)) {
+        w->vel = target;
+        a = 0;
+    }
+
+    w->acc = a;
+}
+
+/**
+ * @brief      Dead reckons one tick of motion from the speeds sent to the 3pi.
+ */
+static void updatePose(int left, int right)
+{
+    int32_t vl = left * MOTION_MM_PER_S_PER_UNIT;
+    int32_t vr = right * MOTION_MM_PER_S_PER_UNIT;
+    int32_t v = MOTION_FORWARD_SIGN * (vl + vr) / 2;
+    /* 10430 binary angle units per radian */
+    int32_t dtheta = (vr - vl) * 10430 / MOTION_WHEELBASE_MM 
+                     * MOTION_TICK_MS / 1000;
+    /* distance this tick in Q8 mm */
+    int32_t d = v * 256 * MOTION_TICK_MS / 1000;
+    uint16_t mid = poseHeading + dtheta / 2;
+    int32_t dx = (d * cosQ15(mid)) >> 15;
+    int32_t dy = (d * sinQ15(mid)) >> 15;
+
+    core_util_critical_section_enter();
+    poseX += dx;
+    poseY += dy;
+    poseHeading += dtheta;
+    poseSpeed = v;
+    core_util_critical_section_exit();
+}
+
+/* round a Q8 speed to the nearest m3pi speed unit */
+static int toSpeed(int32_t q8)
+{
+    return (q8 >= 0) ? ((q8 + 128) >> 8) : -((-q8 + 128) >> 8);
+}
+
+void motionThread()
+{
+    WheelProfile left = {0, 0, 0};
+    WheelProfile right = {0, 0, 0};
+    int32_t tl, tr, amax, jmax;
+    int speed;
+    bool idle;
+    bool changed = false;
+    int gridTicks = 0;
+    MotionPose pose;
+
+    while(1) {
+        /* released by the ticker every MOTION_TICK_MS, or by motionCommand()
+           while the ticker is detached */
+        motionTick.wait();
+
+        if (!ticking) {
+            ticking = true;
+            motionTicker.attach_us(callback(onMotionTick), 
+                                   MOTION_TICK_MS * 1000);
+        }
+
+        core_util_critical_section_enter();
+        if (holdTicks > 0 && --holdTicks == 0) {
+            /* the last command ran out without being replaced */
+            targetLeft = 0;
+            targetRight = 0;
+        }
+        tl = Q8(targetLeft);
+        tr = Q8(targetRight);
+        amax = accelLimit;
+        jmax = jerkLimit;
+        core_util_critical_section_exit();
+
+        stepWheel(&left, tl, amax, jmax);
+        stepWheel(&right, tr, amax, jmax);
+
+        /* The reflex gets the last word before the motors. If it clamps, the
+           profile continues from the clamped speeds so it ramps back up 
+           smoothly once the way is clear. */
+        if (reflexLimit(&left.vel, &right.vel)) {
+            left.acc = 0;
+            right.acc = 0;
+        }
+
+        /* only talk to the 3pi when a wheel speed actually changes */
+        m3piMtx.lock();
+        speed = toSpeed(left.vel);
+        if (speed != left.sent) {
+            m3pi.left_motor(speed);
+            left.sent = speed;
+            changed = true;
+        }
+        speed = toSpeed(right.vel);
+        if (speed != right.sent) {
+            m3pi.right_motor(speed);
+            right.sent = speed;
+            changed = true;
+        }
+        /* the sensors are read while the robot spins to calibrate them, and
+           now and then while it drives to notice a different floor */
+        lineCalibrationTick();
+        m3piMtx.unlock();
+
+        if (changed) {
+            frRecord(FR_EVT_MOTOR, (uint8_t)left.sent, (uint8_t)right.sent);
+            changed = false;
+        }
+
+        updatePose(left.sent, right.sent);
+
+        /* the ticker only runs while the robot moves, so a robot standing
+           still does not map the same ray over and over */
+        if (++gridTicks >= GRID_UPDATE_TICKS) {
+            gridTicks = 0;
+            motionGetPose(&pose);
+            gridUpdate(&pose, rangeReadMm());
+        }
+
+        /* Check the targets again under the critical section so we cannot
+           miss a command that arrives while we are detaching. */
+        core_util_critical_section_enter();
+        idle = (targetLeft == 0 && targetRight == 0 && left.vel == 0 
+                && right.vel == 0 && left.acc == 0 && right.acc == 0);
+        if (idle)
+            ticking = false;
+        core_util_critical_section_exit();
+
+        if (idle)
+            motionTicker.detach();
+    } /* while */
+
+    /* this should never be reached */
+}
+
+void motionCommand(int left, int right, int duration_ms)
+{
+    uint32_t ticks = (duration_ms + MOTION_BLEND_MS + MOTION_TICK_MS - 1) 
+                     / MOTION_TICK_MS;
+    bool wake;
+
+    core_util_critical_section_enter();
+    targetLeft = clampSpeed(left);
+    targetRight = clampSpeed(right);
+    holdTicks = ticks;
+    wake = !ticking;
+    core_util_critical_section_exit();
+
+    if (wake)
+        motionTick.release();
+
+    pathRecordCommand(left, right, duration_ms);
+}
+
+void motionStop()
+{
+    core_util_critical_section_enter();
+    targetLeft = 0;
+    targetRight = 0;
+    holdTicks = 0;
+    core_util_critical_section_exit();
+}
+
+void motionGetPose(MotionPose *pose)
+{
+    core_util_critical_section_enter();
+    pose->x = poseX >> 8;
+    pose->y = poseY >> 8;
+    pose->heading = poseHeading;
+    pose->speed = poseSpeed;
+    core_util_critical_section_exit();
+}
+
+void motionSetLimits(int accel, int jerk)
+{
+    int32_t a = ACCEL_PER_TICK(accel);
+    int32_t j = JERK_PER_TICK(jerk);
+
+    /* a limit of zero would stall the wheels (and divide by zero) */
+    if (a < 1)
+        a = 1;
+    if (j < 1)
+        j = 1;
+
+    core_util_critical_section_enter();
+    accelLimit = a;
+    jerkLimit = j;
+    core_util_critical_section_exit();
+}
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Motion.h
+ * @brief      Motion profile generator that ramps the m3pi wheel speeds.
+ *
+ *             The m3pi motors used to be switched straight from 0 to the 
+ *             commanded speed and back to 0 on every movement() call. These
+ *             step changes make the wheels slip and pull current spikes that
+ *             can brown out the ESP8266. Instead, the motion thread owns the 
+ *             motors and moves each wheel towards its target speed at a fixed
+ *             tick, bounded by an acceleration and a jerk limit.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _MOTION_H_
+#define _MOTION_H_
+
+#include "mbed.h"
+#include "rtos.h"
+
+/* period of the motion profile generator in msec */
+#define MOTION_TICK_MS              10
+
+/* The m3pi takes speeds in the range of -127 to 127. The limits below are in
+   those same speed units per second (and per second^2 for jerk). */
+#define MOTION_DEFAULT_ACCEL_LIMIT  500
+#define MOTION_DEFAULT_JERK_LIMIT   5000
+
+/* A command keeps its target speed this long past its duration so that the
+   next command can take over without the wheels returning to zero. */
+#define MOTION_BLEND_MS             (2 * MOTION_TICK_MS)
+
+#define MOTION_THREAD_STACK_SIZE    1024
+
+/* movement('w', ...) drives both wheels backwards, and that is the way the 
+   range sensor faces. So for the robot, "forward" wheel speeds are negative. */
+#define MOTION_FORWARD_SIGN         (-1)
+
+/* Rough conversion of m3pi speed units to wheel speed, and the distance 
+   between the wheels. Used to dead reckon the pose, calibrate for your 3pi. */
+#define MOTION_MM_PER_S_PER_UNIT    6
+#define MOTION_WHEELBASE_MM         84
+
+/**
+ * Dead reckoned pose, from the wheel speeds sent to the 3pi. Heading is a 
+ * binary angle: 65536 is a full turn, 0 is the heading at boot and it grows
+ * counter-clockwise.
+ */
+typedef struct {
+    int32_t  x;         /* mm */
+    int32_t  y;         /* mm */
+    uint16_t heading;
+    int16_t  speed;     /* mm/s, positive when driving forward */
+} MotionPose;
+
+/**
+ * Lock this global mutex before any calls to the m3pi object. The motion 
+ * thread is the only place that should drive the motors.
+ */
+extern Mutex m3piMtx;
+
+/**
+ * @brief      Main motion thread function. Start this before any calls to
+ *             motionCommand().
+ */
+void motionThread();
+
+/**
+ * @brief      Sets new target wheel speeds. The wheels ramp towards these 
+ *             speeds and hold them for duration_ms (plus MOTION_BLEND_MS).
+ *             After that, they ramp back down to zero unless another command
+ *             arrives first. Safe to call from any thread or ISR.
+ *
+ * @param[in]  left         The left wheel target speed (-127 to 127)
+ * @param[in]  right        The right wheel target speed (-127 to 127)
+ * @param[in]  duration_ms  How long to hold the targets in msec
+ */
+void motionCommand(int left, int right, int duration_ms);
+
+/**
+ * @brief      Ramps both wheels down to zero as fast as the limits allow.
+ */
+void motionStop();
+
+/**
+ * @brief      Returns the current dead reckoned pose.
+ *
+ * @param      pose  Filled in with the pose
+ */
+void motionGetPose(MotionPose *pose);
+
+/**
+ * @brief      Changes the acceleration and jerk limits at runtime.
+ *
+ * @param[in]  accel  Max acceleration in speed units per second
+ * @param[in]  jerk   Max jerk in speed units per second^2
+ */
+void motionSetLimits(int accel, int jerk);
+
+#endif /* _MOTION_H_ */
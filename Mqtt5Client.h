@@ -0,0 +1,849 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Mqtt5Client.h
+ * @brief      Minimal MQTT 5 client with the same interface as MQTTClient.h.
+ *
+ *             The Paho embedded client only speaks MQTT 3.1.1. This client 
+ *             speaks MQTT 5 and adds three of its features:
+ *
+ *             - Topic aliases. The first publish to a topic sends the topic
+ *               and an alias for it. Every later publish sends only the 
+ *               2 byte alias, so periodic telemetry no longer repeats topics
+ *               like m3pi-mqtt-ee250/status. Up to MQTT5_TOPIC_ALIASES 
+ *               topics get one, or fewer if the broker allows fewer.
+ *             - Receive maximum. The broker never has more than 
+ *               MQTT5_RECEIVE_MAXIMUM QoS 1 messages outstanding to us, and 
+ *               never sends a packet larger than MAX_PACKET_SIZE. Both are 
+ *               broker-side limits, so a flood queues at the broker instead
+ *               of in our socket buffers. QoS 0 messages are not counted by
+ *               the broker (see Ingress.h for those).
+ *             - Message expiry. Publishes carry an expiry interval, 
+ *               MQTT5_MESSAGE_EXPIRY_S unless given, so a broker does not 
+ *               hand stale telemetry to a subscriber that connects late.
+ *
+ *             Only QoS 0 and 1 are supported. Like in MQTTClient.h, topic
+ *             strings passed to subscribe() and publish() are kept by 
+ *             pointer, so they must stay valid (literals or static buffers).
+ *
+ *             Build with -DM3PI_MQTT5 to use it for the robot's connection 
+ *             (see MQTTClientType below). mqtt5_broker.py is a local broker 
+ *             stand-in to test it against.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _MQTT5CLIENT_H_
+#define _MQTT5CLIENT_H_
+
+#include "mbed.h"
+#include "MQTTmbed.h"
+#include "MQTTClient.h"
+#include "MQTTNetwork.h"
+
+#define MQTT5_TOPIC_ALIASES     8
+#define MQTT5_RECEIVE_MAXIMUM   4
+#define MQTT5_MESSAGE_EXPIRY_S  10
+
+/* for the rest of a packet once its first byte arrived */
+#define MQTT5_READ_TIMEOUT_MS   1000
+
+namespace MQTT5 {
+
+/**
+ * Packet types (first byte >> 4)
+ */
+enum {
+    PKT_CONNECT = 1,
+    PKT_CONNACK,
+    PKT_PUBLISH,
+    PKT_PUBACK,
+    PKT_PUBREC,
+    PKT_PUBREL,
+    PKT_PUBCOMP,
+    PKT_SUBSCRIBE,
+    PKT_SUBACK,
+    PKT_UNSUBSCRIBE,
+    PKT_UNSUBACK,
+    PKT_PINGREQ,
+    PKT_PINGRESP,
+    PKT_DISCONNECT,
+    PKT_AUTH
+};
+
+/**
+ * Property identifiers that we send or read
+ */
+enum {
+    PROP_MESSAGE_EXPIRY         = 0x02,
+    PROP_RECEIVE_MAXIMUM        = 0x21,
+    PROP_TOPIC_ALIAS_MAXIMUM    = 0x22,
+    PROP_TOPIC_ALIAS            = 0x23,
+    PROP_MAXIMUM_PACKET_SIZE    = 0x27
+};
+
+/**
+ * @brief      Writes a variable byte integer.
+ *
+ * @return     Number of bytes written (1 to 4)
+ */
+inline int writeVarInt(unsigned char *buf, uint32_t value)
+{
+    int n = 0;
+
+    do {
+        unsigned char c = value % 128;
+        value /= 128;
+        buf[n++] = value > 0 ? (c | 0x80) : c;
+    } while (value > 0 && n < 4);
+
+    return n;
+}
+
+/**
+ * @brief      Reads a variable byte integer.
+ *
+ * @return     Number of bytes read, 0 if it is malformed or runs past end
+ */
+inline int readVarInt(const unsigned char *buf, const unsigned char *end, 
+                      uint32_t *value)
+{
+    uint32_t multiplier = 1;
+    int n = 0;
+
+    *value = 0;
+    do {
+        if (buf + n >= end || n == 4) {
+            return 0;
+        }
+        *value += (buf[n] & 0x7F) * multiplier;
+        multiplier *= 128;
+    } while (buf[n++] & 0x80);
+
+    return n;
+}
+
+inline int varIntSize(uint32_t value)
+{
+    return value < 128 ? 1 : value < 16384 ? 2 : value < 2097152 ? 3 : 4;
+}
+
+/**
+ * @brief      Skips one property.
+ *
+ * @return     Pointer past the property, NULL if it is unknown or runs past
+ *             end
+ */
+inline const unsigned char *skipProperty(const unsigned char *p, 
+                                         const unsigned char *end)
+{
+    uint32_t len;
+    int n;
+
+    if (p >= end) {
+        return NULL;
+    }
+    switch (*p++) {
+        /* byte */
+        case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: 
+        case 0x29: case 0x2A:
+            p += 1;
+            break;
+        /* two byte integer */
+        case 0x13: case 0x21: case 0x22: case 0x23:
+            p += 2;
+            break;
+        /* four byte integer */
+        case 0x02: case 0x11: case 0x18: case 0x27:
+            p += 4;
+            break;
+        /* variable byte integer */
+        case 0x0B:
+            if ((n = readVarInt(p, end, &len)) == 0) {
+                return NULL;
+            }
+            p += n;
+            break;
+        /* string or binary data */
+        case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: 
+        case 0x1A: case 0x1C: case 0x1F:
+            if (p + 2 > end) {
+                return NULL;
+            }
+            p += 2 + ((p[0] << 8) | p[1]);
+            break;
+        /* string pair */
+        case 0x26:
+            for (int i = 0; i < 2; i++) {
+                if (p + 2 > end) {
+                    return NULL;
+                }
+                p += 2 + ((p[0] << 8) | p[1]);
+            }
+            break;
+        default:
+            return NULL;
+    }
+
+    return p <= end ? p : NULL;
+}
+
+/**
+ * @brief      Matches a topic against a subscription filter with + and #.
+ */
+inline bool topicMatches(const char *filter, const char *topic, int len)
+{
+    const char *end = topic + len;
+
+    while (*filter && topic < end) {
+        if (*filter == '#') {
+            return true;
+        }
+        if (*filter == '+') {
+            while (topic < end && *topic != '/') {
+                topic++;
+            }
+            filter++;
+            continue;
+        }
+        if (*filter != *topic) {
+            return false;
+        }
+        filter++;
+        topic++;
+    }
+
+    /* "a/#" also matches "a" */
+    return topic == end && (*filter == '\0' || strcmp(filter, "#") == 0 ||
+                            strcmp(filter, "/#") == 0);
+}
+
+template <class Network, class Timer, int MAX_PACKET_SIZE = 100, 
+          int MAX_MESSAGE_HANDLERS = 5>
+class Client {
+public:
+    typedef void (*messageHandler)(MQTT::MessageData&);
+
+    Client(Network &network, unsigned int commandTimeoutMs = 30000) 
+        : _network(network), _commandTimeoutMs(commandTimeoutMs), 
+          _keepAliveMs(0), _connected(false), _pingOutstanding(false),
+          _packetId(0), _serverAliasMax(0), _aliasCount(0), 
+          _aliasBytesSaved(0) {
+        for (int i = 0; i < MAX_MESSAGE_HANDLERS; i++) {
+            _handlers[i].topicFilter = NULL;
+            _handlers[i].fp = NULL;
+        }
+    }
+
+    /**
+     * @brief      Sends CONNECT and waits for CONNACK. options.MQTTVersion is
+     *             ignored, this always speaks MQTT 5.
+     *
+     * @return     MQTT::SUCCESS, or the CONNACK reason code if the broker
+     *             refused
+     */
+    int connect(MQTTPacket_connectData &options) {
+        Timer timer(_commandTimeoutMs);
+        unsigned char *p = _sendbuf + 5;    /* room for the fixed header */
+        int userLen = stringLen(options.username);
+        int passLen = stringLen(options.password);
+        unsigned char flags = options.cleansession ? 0x02 : 0;
+
+        if (_connected) {
+            return MQTT::FAILURE;
+        }
+
+        if (userLen >= 0) {
+            flags |= 0x80;
+        }
+        if (passLen >= 0) {
+            flags |= 0x40;
+        }
+
+        static const unsigned char protocol[] = { 0, 4, 'M', 'Q', 'T', 'T', 5 };
+        memcpy(p, protocol, sizeof(protocol));
+        p += sizeof(protocol);
+        *p++ = flags;
+        p = put16(p, options.keepAliveInterval);
+
+        /* properties: our flow control limits */
+        *p++ = 8;
+        *p++ = PROP_RECEIVE_MAXIMUM;
+        p = put16(p, MQTT5_RECEIVE_MAXIMUM);
+        *p++ = PROP_MAXIMUM_PACKET_SIZE;
+        p = put32(p, MAX_PACKET_SIZE);
+
+        if (!putString(&p, options.clientID) ||
+            (userLen >= 0 && !putString(&p, options.username)) ||
+            (passLen >= 0 && !putString(&p, options.password))) {
+            return MQTT::BUFFER_OVERFLOW;
+        }
+
+        if (sendPacket(PKT_CONNECT << 4, p, timer) != MQTT::SUCCESS ||
+            waitFor(PKT_CONNACK, timer) != PKT_CONNACK) {
+            return MQTT::FAILURE;
+        }
+
+        /* [0] ack flags, [1] reason code, then the properties */
+        const unsigned char *q = _payload;
+        const unsigned char *end = _payload + _payloadLen;
+        uint32_t propLen;
+        int n;
+
+        if (_payloadLen < 3) {
+            return MQTT::FAILURE;
+        }
+        if (q[1] != 0) {
+            return q[1];
+        }
+        q += 2;
+        if ((n = readVarInt(q, end, &propLen)) == 0 || q + n + propLen > end) {
+            return MQTT::FAILURE;
+        }
+        q += n;
+        end = q + propLen;
+
+        _serverAliasMax = 0;
+        while (q < end) {
+            if (*q == PROP_TOPIC_ALIAS_MAXIMUM && q + 3 <= end) {
+                _serverAliasMax = (q[1] << 8) | q[2];
+            }
+            if ((q = skipProperty(q, end)) == NULL) {
+                return MQTT::FAILURE;
+            }
+        }
+
+        /* aliases only last as long as the connection */
+        _aliasCount = 0;
+        _keepAliveMs = options.keepAliveInterval * 1000;
+        _pingTimer.countdown_ms(_keepAliveMs);
+        _pingOutstanding = false;
+        _connected = true;
+
+        return MQTT::SUCCESS;
+    }
+
+    /**
+     * @brief      Subscribes and waits for SUBACK.
+     */
+    int subscribe(const char *topicFilter, enum MQTT::QoS qos, 
+                  messageHandler mh) {
+        Timer timer(_commandTimeoutMs);
+        unsigned char *p = _sendbuf + 5;
+        int len = strlen(topicFilter);
+        int slot = -1;
+
+        if (!_connected || qos == MQTT::QOS2) {
+            return MQTT::FAILURE;
+        }
+        for (int i = 0; i < MAX_MESSAGE_HANDLERS; i++) {
+            if (_handlers[i].topicFilter == NULL) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0) {
+            return MQTT::FAILURE;
+        }
+        if (5 + 2 + 1 + 2 + len + 1 > MAX_PACKET_SIZE) {
+            return MQTT::BUFFER_OVERFLOW;
+        }
+
+        p = put16(p, nextPacketId());
+        *p++ = 0;                           /* no properties */
+        p = put16(p, len);
+        memcpy(p, topicFilter, len);
+        p += len;
+        *p++ = qos;                         /* subscription options */
+
+        if (sendPacket((PKT_SUBSCRIBE << 4) | 0x02, p, timer) != 
+                MQTT::SUCCESS || waitFor(PKT_SUBACK, timer) != PKT_SUBACK) {
+            return MQTT::FAILURE;
+        }
+
+        /* [0-1] packet id, properties, then one reason code */
+        const unsigned char *q = _payload + 2;
+        const unsigned char *end = _payload + _payloadLen;
+        uint32_t propLen;
+        int n;
+
+        if ((n = readVarInt(q, end, &propLen)) == 0 || 
+            q + n + propLen >= end || q[n + propLen] >= 0x80) {
+            return MQTT::FAILURE;
+        }
+
+        _handlers[slot].topicFilter = topicFilter;
+        _handlers[slot].fp = mh;
+        return MQTT::SUCCESS;
+    }
+
+    int publish(const char *topicName, MQTT::Message &message) {
+        return publish(topicName, message, MQTT5_MESSAGE_EXPIRY_S);
+    }
+
+    /**
+     * @brief      Publishes a message. QoS 1 waits for PUBACK.
+     *
+     * @param[in]  expirySec  Seconds the broker may keep the message for 
+     *                        subscribers, 0 for no limit
+     */
+    int publish(const char *topicName, MQTT::Message &message, 
+                uint32_t expirySec) {
+        Timer timer(_commandTimeoutMs);
+        unsigned char *p = _sendbuf + 5;
+        int topicLen = strlen(topicName);
+        int alias = findAlias(topicName);
+        bool newAlias = false;
+        unsigned short id = 0;
+
+        if (!_connected || message.qos == MQTT::QOS2) {
+            return MQTT::FAILURE;
+        }
+
+        if (alias == 0 && _aliasCount < MQTT5_TOPIC_ALIASES && 
+            _aliasCount < _serverAliasMax) {
+            alias = _aliasCount + 1;
+            newAlias = true;
+        }
+
+        int propLen = (expirySec ? 5 : 0) + (alias ? 3 : 0);
+        int sentTopicLen = (alias && !newAlias) ? 0 : topicLen;
+        if (5 + 2 + sentTopicLen + 2 + 1 + propLen + (int)message.payloadlen 
+                > MAX_PACKET_SIZE) {
+            return MQTT::BUFFER_OVERFLOW;
+        }
+
+        p = put16(p, sentTopicLen);
+        memcpy(p, topicName, sentTopicLen);
+        p += sentTopicLen;
+        if (message.qos == MQTT::QOS1) {
+            id = nextPacketId();
+            p = put16(p, id);
+        }
+        *p++ = propLen;
+        if (expirySec) {
+            *p++ = PROP_MESSAGE_EXPIRY;
+            p = put32(p, expirySec);
+        }
+        if (alias) {
+            *p++ = PROP_TOPIC_ALIAS;
+            p = put16(p, alias);
+        }
+        memcpy(p, message.payload, message.payloadlen);
+        p += message.payloadlen;
+
+        unsigned char header = (PKT_PUBLISH << 4) | (message.qos << 1) | 
+                               (message.dup ? 0x08 : 0) | 
+                               (message.retained ? 0x01 : 0);
+        if (sendPacket(header, p, timer) != MQTT::SUCCESS) {
+            return MQTT::FAILURE;
+        }
+
+        /* only use the alias once the broker has seen it with its topic */
+        if (newAlias) {
+            _aliases[_aliasCount++] = topicName;
+        } else if (alias) {
+            _aliasBytesSaved += topicLen;
+        }
+
+        if (message.qos == MQTT::QOS1) {
+            if (waitFor(PKT_PUBACK, timer) != PKT_PUBACK || 
+                _payloadLen < 2 || 
+                ((_payload[0] << 8) | _payload[1]) != id) {
+                return MQTT::FAILURE;
+            }
+            /* a reason code of 0x80 and up is a failure */
+            if (_payloadLen > 2 && _payload[2] >= 0x80) {
+                return MQTT::FAILURE;
+            }
+        }
+
+        return MQTT::SUCCESS;
+    }
+
+    /**
+     * @brief      Handles incoming packets and the keepalive for timeoutMs.
+     */
+    int yield(unsigned long timeoutMs = 1000L) {
+        Timer timer(timeoutMs);
+
+        do {
+            if (cycle(timer) < 0) {
+                return MQTT::FAILURE;
+            }
+        } while (!timer.expired());
+
+        return MQTT::SUCCESS;
+    }
+
+    bool isConnected() {
+        return _connected;
+    }
+
+    /**
+     * @brief      Returns the number of topic aliases the broker allowed in 
+     *             this connection.
+     */
+    int aliasLimit() {
+        return _serverAliasMax < MQTT5_TOPIC_ALIASES ? _serverAliasMax 
+                                                     : MQTT5_TOPIC_ALIASES;
+    }
+
+    /**
+     * @brief      Returns the number of topic bytes not sent thanks to aliases.
+     */
+    uint32_t aliasBytesSaved() {
+        return _aliasBytesSaved;
+    }
+
+private:
+    /* a negative socket timeout would block forever */
+    static int leftMs(Timer &timer) {
+        int ms = timer.left_ms();
+        return ms > 0 ? ms : 0;
+    }
+
+    static unsigned char *put16(unsigned char *p, uint16_t v) {
+        p[0] = v >> 8;
+        p[1] = v & 0xFF;
+        return p + 2;
+    }
+
+    static unsigned char *put32(unsigned char *p, uint32_t v) {
+        p[0] = v >> 24;
+        p[1] = (v >> 16) & 0xFF;
+        p[2] = (v >> 8) & 0xFF;
+        p[3] = v & 0xFF;
+        return p + 4;
+    }
+
+    /* length of an MQTTString, -1 if it is not set */
+    static int stringLen(const MQTTString &s) {
+        if (s.cstring) {
+            return strlen(s.cstring);
+        }
+        return s.lenstring.data ? s.lenstring.len : -1;
+    }
+
+    bool putString(unsigned char **p, const MQTTString &s) {
+        int len = stringLen(s);
+
+        if (len < 0) {
+            len = 0;
+        }
+        if (*p + 2 + len > _sendbuf + MAX_PACKET_SIZE) {
+            return false;
+        }
+        *p = put16(*p, len);
+        memcpy(*p, s.cstring ? s.cstring : s.lenstring.data, len);
+        *p += len;
+        return true;
+    }
+
+    unsigned short nextPacketId() {
+        _packetId = (_packetId == 0xFFFF) ? 1 : _packetId + 1;
+        return _packetId;
+    }
+
+    /* alias of a topic, 0 if it has none */
+    int findAlias(const char *topicName) {
+        for (int i = 0; i < _aliasCount; i++) {
+            if (_aliases[i] == topicName || strcmp(_aliases[i], topicName) == 0) {
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+
+    /* Fills in the fixed header in front of the variable header and payload
+       that were written at _sendbuf + 5, and sends the packet. */
+    int sendPacket(unsigned char header, unsigned char *end, Timer &timer) {
+        uint32_t remaining = end - (_sendbuf + 5);
+        int n = varIntSize(remaining);
+        unsigned char *start = _sendbuf + 5 - 1 - n;
+        int len = end - start;
+        int sent = 0;
+
+        start[0] = header;
+        writeVarInt(start + 1, remaining);
+
+        while (sent < len && !timer.expired()) {
+            int rc = _network.write(start + sent, len - sent, leftMs(timer));
+            if (rc < 0) {
+                break;
+            }
+            sent += rc;
+        }
+        if (sent != len) {
+            _connected = false;
+            return MQTT::FAILURE;
+        }
+
+        /* any packet counts as activity for the keepalive */
+        _pingTimer.countdown_ms(_keepAliveMs);
+        return MQTT::SUCCESS;
+    }
+
+    int readBytes(unsigned char *buf, int len, int timeoutMs) {
+        Timer timer(timeoutMs);
+        int got = 0;
+
+        while (got < len) {
+            int rc = _network.read(buf + got, len - got, leftMs(timer));
+            if (rc < 0 || (rc == 0 && timer.expired())) {
+                return MQTT::FAILURE;
+            }
+            got += rc;
+        }
+        return got;
+    }
+
+    /* Reads one packet into _readbuf. Returns its type, 0 if nothing 
+       arrived, or a negative error. */
+    int readPacket(Timer &timer) {
+        uint32_t remaining = 0;
+        uint32_t multiplier = 1;
+        unsigned char c;
+        int n = 0;
+
+        int rc = _network.read(_readbuf, 1, leftMs(timer));
+        if (rc == 0) {
+            return 0;
+        } else if (rc < 0) {
+            return MQTT::FAILURE;
+        }
+
+        do {
+            if (++n > 4 || readBytes(&c, 1, MQTT5_READ_TIMEOUT_MS) != 1) {
+                return MQTT::FAILURE;
+            }
+            remaining += (c & 0x7F) * multiplier;
+            multiplier *= 128;
+        } while (c & 0x80);
+
+        /* we told the broker our maximum packet size, so this is a broker 
+           bug. Throw the packet away to stay in sync. */
+        if (remaining > (uint32_t)MAX_PACKET_SIZE - 1) {
+            while (remaining > 0) {
+                int chunk = remaining < MAX_PACKET_SIZE - 1 ? remaining 
+                                                            : MAX_PACKET_SIZE - 1;
+                if (readBytes(_readbuf + 1, chunk, MQTT5_READ_TIMEOUT_MS) != 
+                        chunk) {
+                    return MQTT::FAILURE;
+                }
+                remaining -= chunk;
+            }
+            return MQTT::BUFFER_OVERFLOW;
+        }
+
+        if (remaining > 0 && 
+            readBytes(_readbuf + 1, remaining, MQTT5_READ_TIMEOUT_MS) != 
+                (int)remaining) {
+            return MQTT::FAILURE;
+        }
+        _payload = _readbuf + 1;
+        _payloadLen = remaining;
+
+        return _readbuf[0] >> 4;
+    }
+
+    void deliver(const unsigned char *p, const unsigned char *end) {
+        MQTT::Message message;
+        MQTTString topicName = MQTTString_initializer;
+        uint32_t propLen;
+        int n;
+
+        message.qos = (enum MQTT::QoS)((_readbuf[0] >> 1) & 0x03);
+        message.dup = (_readbuf[0] & 0x08) != 0;
+        message.retained = (_readbuf[0] & 0x01) != 0;
+        message.id = 0;
+
+        if (p + 2 > end) {
+            return;
+        }
+        topicName.lenstring.len = (p[0] << 8) | p[1];
+        topicName.lenstring.data = (char *)p + 2;
+        p += 2 + topicName.lenstring.len;
+        if (message.qos != MQTT::QOS0) {
+            if (p + 2 > end) {
+                return;
+            }
+            message.id = (p[0] << 8) | p[1];
+            p += 2;
+        }
+        /* nothing in the properties matters to the handlers */
+        if ((n = readVarInt(p, end, &propLen)) == 0 || p + n + propLen > end) {
+            return;
+        }
+        p += n + propLen;
+
+        message.payload = (void *)p;
+        message.payloadlen = end - p;
+
+        for (int i = 0; i < MAX_MESSAGE_HANDLERS; i++) {
+            if (_handlers[i].topicFilter && 
+                topicMatches(_handlers[i].topicFilter, 
+                             topicName.lenstring.data, 
+                             topicName.lenstring.len)) {
+                MQTT::MessageData md(topicName, message);
+                _handlers[i].fp(md);
+                break;
+            }
+        }
+
+        /* acknowledged after the handler ran, so the broker's receive 
+           maximum window only opens again once we have room */
+        if (message.qos == MQTT::QOS1) {
+            Timer timer(_commandTimeoutMs);
+            unsigned char *q = put16(_sendbuf + 5, message.id);
+            sendPacket(PKT_PUBACK << 4, q, timer);
+        }
+    }
+
+    int keepalive() {
+        if (_keepAliveMs == 0 || !_pingTimer.expired()) {
+            return MQTT::SUCCESS;
+        }
+        if (_pingOutstanding) {
+            _connected = false;
+            return MQTT::FAILURE;
+        }
+
+        Timer timer(_commandTimeoutMs);
+        if (sendPacket(PKT_PINGREQ << 4, _sendbuf + 5, timer) != 
+                MQTT::SUCCESS) {
+            return MQTT::FAILURE;
+        }
+        _pingOutstanding = true;
+        return MQTT::SUCCESS;
+    }
+
+    /* Reads and handles one packet. Returns its type, 0 if nothing arrived, 
+       or a negative error. */
+    int cycle(Timer &timer) {
+        int type = readPacket(timer);
+
+        switch (type) {
+            case PKT_PUBLISH:
+                deliver(_payload, _payload + _payloadLen);
+                break;
+            case PKT_PINGRESP:
+                _pingOutstanding = false;
+                break;
+            case PKT_DISCONNECT:
+                _connected = false;
+                return MQTT::FAILURE;
+            case MQTT::BUFFER_OVERFLOW:
+                type = 0;
+                break;
+            default:
+                break;
+        }
+        if (type < 0) {
+            _connected = false;
+            return type;
+        }
+        if (keepalive() != MQTT::SUCCESS) {
+            return MQTT::FAILURE;
+        }
+        return type;
+    }
+
+    int waitFor(int packetType, Timer &timer) {
+        int rc;
+
+        do {
+            if (timer.expired()) {
+                return MQTT::FAILURE;
+            }
+            rc = cycle(timer);
+        } while (rc >= 0 && rc != packetType);
+
+        return rc;
+    }
+
+    Network &_network;
+    unsigned int _commandTimeoutMs;
+    unsigned int _keepAliveMs;
+    bool _connected;
+    bool _pingOutstanding;
+    Timer _pingTimer;
+    unsigned short _packetId;
+
+    unsigned char _sendbuf[MAX_PACKET_SIZE];
+    unsigned char _readbuf[MAX_PACKET_SIZE];
+    unsigned char *_payload;            /* after the fixed header */
+    int _payloadLen;
+
+    uint16_t _serverAliasMax;
+    const char *_aliases[MQTT5_TOPIC_ALIASES];
+    int _aliasCount;
+    uint32_t _aliasBytesSaved;
+
+    struct {
+        const char *topicFilter;
+        messageHandler fp;
+    } _handlers[MAX_MESSAGE_HANDLERS];
+};
+
+} /* namespace MQTT5 */
+
+/* subscriptions the robot makes, see main() */
+#define MQTT_MESSAGE_HANDLERS   6
+
+/* Largest packet either client sends or receives, and the most a publish 
+   adds to its topic and payload: the fixed header, topic length, packet id
+   and, for MQTT 5, the message expiry and topic alias properties. */
+#define MQTT_MAX_PACKET_SIZE    100
+#define MQTT_PUBLISH_OVERHEAD   18
+
+/**
+ * The client type the robot uses for its connection
+ */
+#ifdef M3PI_MQTT5
+typedef MQTT5::Client<MQTTNetwork, Countdown, MQTT_MAX_PACKET_SIZE, 
+                      MQTT_MESSAGE_HANDLERS> 
+        MQTTClientType;
+#else
+typedef MQTT::Client<MQTTNetwork, Countdown, MQTT_MAX_PACKET_SIZE, 
+                      MQTT_MESSAGE_HANDLERS> 
+        MQTTClientType;
+#endif
+
+#endif /* _MQTT5CLIENT_H_ */
@@ -0,0 +1,659 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Nav.cpp
+ * @brief      Implementation of the waypoint navigation (D* Lite).
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Nav.h"
+#include "Motion.h"
+#include "MQTTNetwork.h"
+#include "Path.h"
+#include "Teleop.h"
+#include "Link.h"
+
+#define NAV_MAX_TOPIC_LEN   64
+#define NAV_INF             0xFFFF
+#define NAV_NOT_OPEN        0xFF
+#define NAV_HALF_MM         (NAV_SIZE / 2 * NAV_CELL_MM)
+
+/* edge costs, a cell apart is 10 */
+#define NAV_STRAIGHT        10
+#define NAV_DIAGONAL        14
+
+MBED_STATIC_ASSERT(NAV_SIZE == 32, "a row of blocked cells is one word");
+MBED_STATIC_ASSERT(NAV_OPEN_SIZE <= NAV_NOT_OPEN, "open positions are a byte");
+
+/* The planner's memory goes to the AHB SRAM bank USB would use, which the 
+   linker leaves uninitialized. navGoto() sets it up. */
+#define NAV_RAM __attribute__((section("AHBSRAM0")))
+
+typedef struct {
+    uint32_t k1;
+    uint16_t k2;
+    uint16_t cell;
+} OpenEntry;
+
+static NAV_RAM uint16_t g[NAV_CELLS];
+static NAV_RAM uint16_t rhs[NAV_CELLS];
+static NAV_RAM OpenEntry openList[NAV_OPEN_SIZE];
+static NAV_RAM uint8_t openPos[NAV_CELLS];
+static int openCount;
+static bool openOverflow;
+
+/* one bit per cell, row by row */
+static uint32_t blocked[NAV_SIZE];
+
+static int startCell, lastStart, goalCell;
+static uint32_t km;
+
+static int state = NAV_IDLE;
+static int32_t goalX, goalY;
+static int navSpeed;
+static uint16_t expanded, repairs, pollUs;
+
+static char topic[NAV_MAX_TOPIC_LEN];
+static Timer pollTimer, statusTimer;
+static bool statusChanged = false;
+
+/* neighbors, straight ones first */
+static const int8_t dirX[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+static const int8_t dirY[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+static inline int cellX(int c) { return c & (NAV_SIZE - 1); }
+static inline int cellY(int c) { return c / NAV_SIZE; }
+
+static inline bool isBlocked(int x, int y)
+{
+    return (blocked[y] >> x) & 1;
+}
+
+static inline bool inside(int x, int y)
+{
+    return (unsigned)x < NAV_SIZE && (unsigned)y < NAV_SIZE;
+}
+
+/* cell of a position in mm, -1 outside of the grid */
+static int toCell(int32_t x, int32_t y)
+{
+    x += NAV_HALF_MM;
+    y += NAV_HALF_MM;
+    if (x < 0 || y < 0 || x >= NAV_SIZE * NAV_CELL_MM || 
+        y >= NAV_SIZE * NAV_CELL_MM)
+        return -1;
+    return (y / NAV_CELL_MM) * NAV_SIZE + x / NAV_CELL_MM;
+}
+
+static int32_t centerMm(int c)
+{
+    return c * NAV_CELL_MM - NAV_HALF_MM + NAV_CELL_MM / 2;
+}
+
+/* Cost of moving from c in direction d. The same both ways, which the 
+   search relies on. */
+static uint16_t cost(int c, int d)
+{
+    int x = cellX(c), y = cellY(c);
+    int nx = x + dirX[d], ny = y + dirY[d];
+
+    if (!inside(nx, ny) || isBlocked(x, y) || isBlocked(nx, ny))
+        return NAV_INF;
+    if (d < 4)
+        return NAV_STRAIGHT;
+    if (isBlocked(nx, y) || isBlocked(x, ny))
+        return NAV_INF;
+    return NAV_DIAGONAL;
+}
+
+static inline uint16_t addCost(uint16_t a, uint16_t b)
+{
+    uint32_t sum = (uint32_t)a + b;
+    return sum >= NAV_INF ? NAV_INF : sum;
+}
+
+/* octile distance, never more than the real cost */
+static uint16_t heuristic(int a, int b)
+{
+    int dx = cellX(a) - cellX(b), dy = cellY(a) - cellY(b);
+
+    if (dx < 0) dx = -dx;
+    if (dy < 0) dy = -dy;
+    return dx > dy ? NAV_STRAIGHT * dx + (NAV_DIAGONAL - NAV_STRAIGHT) * dy
+                   : NAV_STRAIGHT * dy + (NAV_DIAGONAL - NAV_STRAIGHT) * dx;
+}
+
+static void calculateKey(int c, uint32_t *k1, uint16_t *k2)
+{
+    uint16_t m = g[c] < rhs[c] ? g[c] : rhs[c];
+
+    *k2 = m;
+    *k1 = m == NAV_INF ? 0xFFFFFFFF : m + heuristic(startCell, c) + km;
+}
+
+static inline bool keyLess(uint32_t a1, uint16_t a2, uint32_t b1, uint16_t b2)
+{
+    return a1 < b1 || (a1 == b1 && a2 < b2);
+}
+
+/* open list: a binary heap with each cell's position in openPos */
+
+static inline void openSet(int i, const OpenEntry &e)
+{
+    openList[i] = e;
+    openPos[e.cell] = i;
+}
+
+static void siftUp(int i)
+{
+    OpenEntry e = openList[i];
+
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!keyLess(e.k1, e.k2, openList[parent].k1, openList[parent].k2))
+            break;
+        openSet(i, openList[parent]);
+        i = parent;
+    }
+    openSet(i, e);
+}
+
+static void siftDown(int i)
+{
+    OpenEntry e = openList[i];
+
+    while (2 * i + 1 < openCount) {
+        int child = 2 * i + 1;
+        if (child + 1 < openCount && 
+            keyLess(openList[child + 1].k1, openList[child + 1].k2, 
+                    openList[child].k1, openList[child].k2))
+            child++;
+        if (!keyLess(openList[child].k1, openList[child].k2, e.k1, e.k2))
+            break;
+        openSet(i, openList[child]);
+        i = child;
+    }
+    openSet(i, e);
+}
+
+static void openPut(int c, uint32_t k1, uint16_t k2)
+{
+    int i = openPos[c];
+
+    if (i == NAV_NOT_OPEN) {
+        if (openCount == NAV_OPEN_SIZE) {
+            openOverflow = true;
+            return;
+        }
+        i = openCount++;
+    }
+    openList[i].k1 = k1;
+    openList[i].k2 = k2;
+    openList[i].cell = c;
+    siftUp(i);
+    siftDown(openPos[c]);
+}
+
+static void openRemove(int c)
+{
+    int i = openPos[c];
+
+    if (i == NAV_NOT_OPEN)
+        return;
+    openPos[c] = NAV_NOT_OPEN;
+    if (i == --openCount)
+        return;
+    /* the last entry takes its place and moves whichever way it has to */
+    int moved = openList[openCount].cell;
+    openSet(i, openList[openCount]);
+    siftUp(i);
+    siftDown(openPos[moved]);
+}
+
+static void updateVertex(int c)
+{
+    uint32_t k1;
+    uint16_t k2;
+
+    if (g[c] != rhs[c]) {
+        calculateKey(c, &k1, &k2);
+        openPut(c, k1, k2);
+    } else {
+        openRemove(c);
+    }
+}
+
+/* the best rhs of c from its neighbors */
+static uint16_t bestRhs(int c)
+{
+    uint16_t best = NAV_INF;
+
+    for (int d = 0; d < 8; d++) {
+        uint16_t e = cost(c, d);
+        if (e == NAV_INF)
+            continue;
+        uint16_t v = addCost(e, g[c + dirY[d] * NAV_SIZE + dirX[d]]);
+        if (v < best)
+            best = v;
+    }
+    return best;
+}
+
+/**
+ * @brief      Expands cells until the robot's cell is consistent, or for at 
+ *             most budget cells.
+ *
+ * @return     true if the search is complete
+ */
+static bool computeShortestPath(int budget)
+{
+    uint32_t k1, kOld1, kStart1;
+    uint16_t k2, kOld2, kStart2;
+
+    expanded = 0;
+    while (openCount > 0) {
+        calculateKey(startCell, &kStart1, &kStart2);
+        if (!keyLess(openList[0].k1, openList[0].k2, kStart1, kStart2) && 
+            rhs[startCell] <= g[startCell])
+            break;
+        if (expanded == budget)
+            return false;
+        expanded++;
+
+        int u = openList[0].cell;
+        kOld1 = openList[0].k1;
+        kOld2 = openList[0].k2;
+        calculateKey(u, &k1, &k2);
+
+        if (keyLess(kOld1, kOld2, k1, k2)) {
+            /* the key went up since the robot moved, sort it in again */
+            openPut(u, k1, k2);
+        } else if (g[u] > rhs[u]) {
+            g[u] = rhs[u];
+            openRemove(u);
+            for (int d = 0; d < 8; d++) {
+                uint16_t e = cost(u, d);
+                int s = u + dirY[d] * NAV_SIZE + dirX[d];
+                if (e == NAV_INF || s == goalCell)
+                    continue;
+                uint16_t v = addCost(e, g[u]);
+                if (v < rhs[s]) {
+                    rhs[s] = v;
+                    updateVertex(s);
+                }
+            }
+        } else {
+            uint16_t gOld = g[u];
+            g[u] = NAV_INF;
+            for (int d = 0; d < 8; d++) {
+                uint16_t e = cost(u, d);
+                int s = u + dirY[d] * NAV_SIZE + dirX[d];
+                if (e == NAV_INF || s == goalCell)
+                    continue;
+                if (rhs[s] == addCost(e, gOld))
+                    rhs[s] = bestRhs(s);
+                updateVertex(s);
+            }
+            if (u != goalCell)
+                rhs[u] = bestRhs(u);
+            updateVertex(u);
+        }
+        if (openOverflow)
+            return false;
+    }
+    return true;
+}
+
+/* blocked cells of a row from two rows of the occupancy grid */
+static uint32_t readRow(int y)
+{
+    uint32_t row = 0;
+
+    for (int w = 0; w < GRID_SIZE / 16; w++) {
+        /* the high bit of a cell is set for both occupied states */
+        uint32_t m = (gridWord((2 * y) * GRID_SIZE / 16 + w) | 
+                      gridWord((2 * y + 1) * GRID_SIZE / 16 + w)) & 0xAAAAAAAA;
+        for (int k = 0; k < 8; k++) {
+            if (m & (0xAUL << (4 * k)))
+                row |= 1UL << (w * 8 + k);
+        }
+    }
+    return row;
+}
+
+/**
+ * @brief      Picks up cells that got blocked or cleared since the last 
+ *             poll, and repairs the search around them.
+ */
+static void applyChanges()
+{
+    uint32_t changed[NAV_SIZE];
+    bool any = false;
+
+    for (int y = 0; y < NAV_SIZE; y++) {
+        uint32_t row = readRow(y);
+        changed[y] = row ^ blocked[y];
+        blocked[y] = row;
+        any |= changed[y] != 0;
+    }
+    if (!any)
+        return;
+
+    /* keys already in the open list stay valid lower bounds this way */
+    km += heuristic(lastStart, startCell);
+    lastStart = startCell;
+    repairs++;
+
+    /* a cell changes the cost of every edge that touches it or cuts its 
+       corner, which are all edges of its neighbors */
+    for (int y = 0; y < NAV_SIZE; y++) {
+        for (uint32_t bits = changed[y]; bits; bits &= bits - 1) {
+            int x = __CLZ(__RBIT(bits));
+            for (int ny = y - 1; ny <= y + 1; ny++) {
+                for (int nx = x - 1; nx <= x + 1; nx++) {
+                    int s = ny * NAV_SIZE + nx;
+                    if (!inside(nx, ny) || s == goalCell)
+                        continue;
+                    rhs[s] = bestRhs(s);
+                    updateVertex(s);
+                }
+            }
+        }
+    }
+}
+
+/* binary angle of (x, y), within about a quarter of a degree */
+static uint16_t angleOf(int32_t x, int32_t y)
+{
+    int32_t ax = x < 0 ? -x : x;
+    int32_t ay = y < 0 ? -y : y;
+    int32_t z, t, a;
+
+    if (ax == 0 && ay == 0)
+        return 0;
+    /* atan(z) ~ pi/4 z + 0.273 z (1 - z) for z in [0, 1], in Q15 */
+    z = ay <= ax ? (ay << 15) / ax : (ax << 15) / ay;
+    t = (z * (32768 - z)) >> 15;
+    a = (8192 * z + 2847 * t) >> 15;
+    if (ay > ax)
+        a = 16384 - a;
+    if (x < 0)
+        a = 32768 - a;
+    if (y < 0)
+        a = -a;
+    return (uint16_t)a;
+}
+
+/* the neighbor to move to from c, -1 if there is none */
+static int nextCell(int c, int *dir)
+{
+    uint16_t best = NAV_INF;
+    int next = -1;
+
+    for (int d = 0; d < 8; d++) {
+        uint16_t e = cost(c, d);
+        if (e == NAV_INF)
+            continue;
+        int s = c + dirY[d] * NAV_SIZE + dirX[d];
+        uint16_t v = addCost(e, g[s]);
+        if (v < best) {
+            best = v;
+            next = s;
+            *dir = d;
+        }
+    }
+    return next;
+}
+
+/* Steers towards (x, y). motionCommand() holds the speeds a little longer
+   than a tick, so the robot stops on its own if polls stop. */
+static void steer(const MotionPose *pose, int32_t x, int32_t y)
+{
+    int16_t err = (int16_t)(angleOf(x - pose->x, y - pose->y) - 
+                            pose->heading);
+    int fwd = 0, turn;
+
+    if (err > NAV_TURN_IN_PLACE || err < -NAV_TURN_IN_PLACE) {
+        turn = err > 0 ? NAV_TURN_SPEED : -NAV_TURN_SPEED;
+    } else {
+        fwd = navSpeed;
+        turn = (int32_t)err * NAV_TURN_SPEED / NAV_TURN_IN_PLACE;
+    }
+    /* the heading grows as the right wheel gets ahead (see updatePose()) */
+    motionCommand(MOTION_FORWARD_SIGN * fwd - turn, 
+                  MOTION_FORWARD_SIGN * fwd + turn, 2 * NAV_TICK_MS);
+}
+
+static void setState(int s)
+{
+    if (s != state)
+        statusChanged = true;
+    state = s;
+}
+
+void navInit(const char *clientId)
+{
+    snprintf(topic, sizeof(topic), "%s%s", NAV_TOPIC_PREFIX, clientId);
+    pollTimer.start();
+    statusTimer.start();
+}
+
+const char *navTopic()
+{
+    return topic;
+}
+
+void navGoto(int32_t x, int32_t y, int speed)
+{
+    MotionPose pose;
+
+    /* the operator keeps the wheels, a new goal replaces a path */
+    if (teleopIsActive()) {
+        printf("nav: teleop is driving, goal ignored\n");
+        setState(NAV_IDLE);
+        return;
+    }
+    pathAbort();
+
+    motionGetPose(&pose);
+    goalX = x;
+    goalY = y;
+    navSpeed = speed;
+    goalCell = toCell(x, y);
+    startCell = toCell(pose.x, pose.y);
+    if (goalCell < 0 || startCell < 0) {
+        motionStop();
+        setState(NAV_FAILED);
+        return;
+    }
+
+    memset(g, 0xFF, sizeof(g));
+    memset(rhs, 0xFF, sizeof(rhs));
+    memset(openPos, NAV_NOT_OPEN, sizeof(openPos));
+    openCount = 0;
+    openOverflow = false;
+    for (int row = 0; row < NAV_SIZE; row++)
+        blocked[row] = readRow(row);
+    km = 0;
+    lastStart = startCell;
+    repairs = 0;
+
+    rhs[goalCell] = 0;
+    updateVertex(goalCell);
+    setState(NAV_PLANNING);
+}
+
+void navCancel()
+{
+    if (state == NAV_PLANNING || state == NAV_DRIVING)
+        motionStop();
+    setState(NAV_IDLE);
+}
+
+bool navIsActive()
+{
+    return state == NAV_PLANNING || state == NAV_DRIVING;
+}
+
+void navCommand(const char *content, int length)
+{
+    const uint8_t *b = (const uint8_t *)content;
+
+    switch (content[1]) {
+        case NAV_GOTO:
+            if (length < 6) {
+                printf("nav: invalid message\n");
+                break;
+            }
+            navGoto((int16_t)(b[2] | (b[3] << 8)), 
+                    (int16_t)(b[4] | (b[5] << 8)),
+                    length > 6 ? b[6] : NAV_DEFAULT_SPEED);
+            break;
+        case NAV_CANCEL:
+            navCancel();
+            break;
+        default:
+            printf("nav: invalid message\n");
+            break;
+    }
+}
+
+static void put16(char *buf, uint32_t value)
+{
+    if (value > 0xFFFF) {
+        value = 0xFFFF;
+    }
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+static int formatStatus(char *buf)
+{
+    uint16_t length = NAV_INF;
+
+    if (state == NAV_DRIVING && rhs[startCell] != NAV_INF)
+        length = rhs[startCell] * NAV_CELL_MM / NAV_STRAIGHT;
+    buf[0] = state;
+    put16(&buf[1], (uint16_t)(int16_t)goalX);
+    put16(&buf[3], (uint16_t)(int16_t)goalY);
+    put16(&buf[5], length);
+    put16(&buf[7], expanded);
+    put16(&buf[9], repairs);
+    put16(&buf[11], pollUs);
+    statusTimer.reset();
+    statusChanged = false;
+    return NAV_STATUS_SIZE;
+}
+
+static void step()
+{
+    MotionPose pose;
+    int32_t dx, dy, tx, ty;
+    int dir, firstDir, c, next;
+
+    /* teleop or a path took the wheels over, leave them alone */
+    if (teleopIsActive() || pathIsPlaying()) {
+        setState(NAV_IDLE);
+        return;
+    }
+
+    motionGetPose(&pose);
+    dx = goalX - pose.x;
+    dy = goalY - pose.y;
+    if (dx * dx + dy * dy <= NAV_GOAL_MM * NAV_GOAL_MM) {
+        motionStop();
+        setState(NAV_ARRIVED);
+        return;
+    }
+    if ((startCell = toCell(pose.x, pose.y)) < 0) {
+        motionStop();
+        setState(NAV_FAILED);
+        return;
+    }
+
+    applyChanges();
+    if (!computeShortestPath(NAV_MAX_EXPANSIONS)) {
+        motionStop();
+        setState(openOverflow ? NAV_FAILED : NAV_PLANNING);
+        return;
+    }
+    if (rhs[startCell] == NAV_INF) {
+        motionStop();
+        setState(NAV_NO_PATH);
+        return;
+    }
+
+    /* head for the end of the straight run the path starts with */
+    c = startCell;
+    firstDir = -1;
+    for (int n = 0; n < NAV_SEGMENT_CELLS && c != goalCell; n++) {
+        next = nextCell(c, &dir);
+        if (next < 0 || (firstDir >= 0 && dir != firstDir))
+            break;
+        firstDir = dir;
+        c = next;
+    }
+    if (c == goalCell) {
+        tx = goalX;
+        ty = goalY;
+    } else {
+        tx = centerMm(cellX(c));
+        ty = centerMm(cellY(c));
+    }
+    steer(&pose, tx, ty);
+    setState(NAV_DRIVING);
+}
+
+int navPoll(char *buf)
+{
+    if (pollTimer.read_ms() >= NAV_TICK_MS) {
+        pollTimer.reset();
+        if (navIsActive()) {
+            uint32_t t0 = us_ticker_read();
+            step();
+            pollUs = us_ticker_read() - t0;
+        }
+    }
+
+    if (statusChanged || 
+        (navIsActive() && statusTimer.read_ms() >= linkPeriod(NAV_STATUS_MS)))
+        return formatStatus(buf);
+    return 0;
+}
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Nav.h
+ * @brief      Drives to a goal on its own, planning around what the 
+ *             occupancy grid (Grid.h) knows.
+ *
+ *             The planner runs D* Lite on a NAV_SIZE x NAV_SIZE grid of 
+ *             NAV_CELL_MM cells, each 2 x 2 cells of the occupancy grid. A 
+ *             cell is blocked if any of those is occupied, and unknown cells
+ *             are taken as free. Moves go to the 8 neighbors, but not 
+ *             diagonally past a blocked cell.
+ *
+ *             D* Lite searches from the goal towards the robot. When the map
+ *             changes under the plan, it only repairs the part of the search 
+ *             the change affects, instead of planning again from scratch. 
+ *             Every NAV_TICK_MS, navPoll() picks up changed cells, expands at 
+ *             most NAV_MAX_EXPANSIONS cells, and once the plan is complete 
+ *             steers the robot towards the end of the next straight run of 
+ *             the path (at most NAV_SEGMENT_CELLS cells away). Until then the
+ *             robot holds still. The goal is reached within NAV_GOAL_MM.
+ *
+ *             All memory is allocated statically, about 7 KB, in the AHB 
+ *             SRAM bank that only the USB stack would use otherwise. The open
+ *             list holds at most NAV_OPEN_SIZE cells; a search that needs 
+ *             more gives up with NAV_FAILED.
+ *
+ *             Controlled with FWD_TO_NAV messages (see MQTTNetwork.h):
+ *
+ *                 NAV_GOTO    [2-3] x, [4-5] y of the goal in mm (int16, 
+ *                             little endian, same frame as MotionPose), 
+ *                             [6] speed (optional)
+ *                 NAV_CANCEL  stop where we are
+ *
+ *             Teleop, path playback and line calibration cancel navigation.
+ *             The status is published on NAV_TOPIC_PREFIX<client id> when it
+ *             changes, and every NAV_STATUS_MS while navigating (longer on a
+ *             bad link, see Link.h), as raw bytes, little endian:
+ *
+ *                 [0]      state (NAV_*)
+ *                 [1-2]    goal x in mm
+ *                 [3-4]    goal y in mm
+ *                 [5-6]    length of the planned path in mm, 0xFFFF if none
+ *                 [7-8]    cells expanded by the last poll
+ *                 [9-10]   times the plan was repaired for a changed map
+ *                 [11-12]  usec the last poll took
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _NAV_H_
+#define _NAV_H_
+
+#include "mbed.h"
+#include "Grid.h"
+
+#define NAV_TOPIC_PREFIX        "m3pi-mqtt-ee250/nav/"
+
+#define NAV_SIZE                (GRID_SIZE / 2)
+#define NAV_CELL_MM             (2 * GRID_CELL_MM)
+#define NAV_CELLS               (NAV_SIZE * NAV_SIZE)
+
+#define NAV_TICK_MS             100
+#define NAV_MAX_EXPANSIONS      150
+#define NAV_OPEN_SIZE           255
+#define NAV_SEGMENT_CELLS       4
+#define NAV_GOAL_MM             60
+
+#define NAV_DEFAULT_SPEED       20
+/* turn in place while the heading is off by more than this (binary angle, 
+   30 degrees) */
+#define NAV_TURN_IN_PLACE       5461
+#define NAV_TURN_SPEED          15
+
+#define NAV_STATUS_MS           1000
+#define NAV_STATUS_SIZE         13
+
+enum {
+    NAV_IDLE,           /* also after teleop or a path took over */
+    NAV_PLANNING,       /* robot holds still until the plan is complete */
+    NAV_DRIVING,
+    NAV_ARRIVED,
+    NAV_NO_PATH,
+    NAV_FAILED          /* goal off the grid, or the search got too big */
+};
+
+/**
+ * @brief      Sets up the status topic.
+ *
+ * @param[in]  clientId  Our MQTT client id, to make the topic unique
+ */
+void navInit(const char *clientId);
+
+/**
+ * @brief      Returns the topic to publish the status on.
+ */
+const char *navTopic();
+
+/**
+ * @brief      Plans from scratch to a new goal and starts driving there. 
+ *             Aborts a playing path. Ignored while teleop is driving, and 
+ *             navigation goes idle when teleop or a path takes over later.
+ *
+ * @param[in]  x      Goal x in mm
+ * @param[in]  y      Goal y in mm
+ * @param[in]  speed  Forward speed in m3pi speed units
+ */
+void navGoto(int32_t x, int32_t y, int speed);
+
+/**
+ * @brief      Stops navigating. The wheels ramp down to a stop.
+ */
+void navCancel();
+
+/**
+ * @brief      Returns true while the planner or the robot is on its way.
+ */
+bool navIsActive();
+
+/**
+ * @brief      Handles a FWD_TO_NAV message. Called by messageArrived().
+ *
+ * @param[in]  content  The whole message, starting with the forward byte
+ * @param[in]  length   Its length
+ */
+void navCommand(const char *content, int length);
+
+/**
+ * @brief      Plans and steers, at most once per NAV_TICK_MS. Call it from
+ *             the MQTT thread, the same one that calls navCommand().
+ *
+ * @param      buf   Buffer of at least NAV_STATUS_SIZE bytes for the status
+ *
+ * @return     Number of status bytes to publish, 0 if there is nothing new
+ */
+int navPoll(char *buf);
+
+#endif /* _NAV_H_ */
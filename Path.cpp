@@ -0,0 +1,292 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Path.cpp
+ * @brief      Implementation of path recording and playback.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Path.h"
+#include "Motion.h"
+#include "MQTTNetwork.h"
+
+/* the stored path */
+static PathSegment path[PATH_MAX_SEGMENTS];
+static volatile int pathLen = 0;
+
+/* recording state, only touched inside critical sections. The command that
+   is running is kept open until we know how long it ran. */
+static volatile bool recording = false;
+static bool segmentOpen = false;
+static int8_t openLeft, openRight;
+static uint32_t openStartUs;
+static uint32_t openDurationMs;
+
+/* playback state, owned by the Timeout once playback starts */
+static Timeout playTimeout;
+static const PathSegment *playing = NULL;
+static volatile int playCount = 0;
+static volatile int playNext = 0;
+
+/* what pathNextChunk() has left to publish */
+static volatile bool dumpPending = false;
+static int nextChunk = 0;
+
+/* Appends a segment, merging it into the last one if the speeds are the same.
+   Call inside a critical section. */
+static void pathAppend(int left, int right, uint32_t durationMs)
+{
+    PathSegment *last = pathLen ? &path[pathLen - 1] : NULL;
+
+    while (durationMs > 0) {
+        if (last && last->left == left && last->right == right &&
+            last->durationMs < 0xFFFF) {
+            uint32_t room = 0xFFFF - last->durationMs;
+            uint32_t add = durationMs < room ? durationMs : room;
+            last->durationMs += add;
+            durationMs -= add;
+            continue;
+        }
+
+        if (pathLen >= PATH_MAX_SEGMENTS)
+            return;
+
+        last = &path[pathLen++];
+        last->left = left;
+        last->right = right;
+        last->durationMs = 0;
+    }
+}
+
+/* Closes the open command. It ran until now, or for as long as it asked for
+   and the robot paused after it. */
+static void pathClose(uint32_t nowUs, bool full)
+{
+    uint32_t elapsedMs = (nowUs - openStartUs) / 1000;
+
+    if (!segmentOpen)
+        return;
+    segmentOpen = false;
+
+    if (!full && elapsedMs <= openDurationMs + MOTION_BLEND_MS) {
+        pathAppend(openLeft, openRight, elapsedMs);
+    } else {
+        pathAppend(openLeft, openRight, openDurationMs);
+        if (!full)
+            pathAppend(0, 0, elapsedMs - openDurationMs);
+    }
+}
+
+void pathRecordCommand(int left, int right, int duration_ms)
+{
+    uint32_t now = us_ticker_read();
+
+    core_util_critical_section_enter();
+    if (recording) {
+        pathClose(now, false);
+        segmentOpen = true;
+        openLeft = left;
+        openRight = right;
+        openStartUs = now;
+        openDurationMs = duration_ms;
+    }
+    core_util_critical_section_exit();
+}
+
+static void pathRecordStart()
+{
+    core_util_critical_section_enter();
+    pathLen = 0;
+    segmentOpen = false;
+    recording = true;
+    core_util_critical_section_exit();
+}
+
+static void pathRecordStop()
+{
+    core_util_critical_section_enter();
+    /* the last command runs its full duration */
+    pathClose(us_ticker_read(), true);
+    recording = false;
+    core_util_critical_section_exit();
+}
+
+/* runs from the Timeout at the start of every segment */
+static void pathStep()
+{
+    const PathSegment *seg;
+
+    if (playing == NULL)
+        return;
+
+    if (playNext >= playCount) {
+        playing = NULL;
+        return;
+    }
+
+    seg = &playing[playNext++];
+    motionCommand(seg->left, seg->right, seg->durationMs);
+    playTimeout.attach_us(callback(pathStep), seg->durationMs * 1000UL);
+}
+
+void pathPlay(const PathSegment *segments, int count)
+{
+    pathAbort();
+    if (count <= 0)
+        return;
+
+    core_util_critical_section_enter();
+    playing = segments;
+    playCount = count;
+    playNext = 0;
+    core_util_critical_section_exit();
+
+    pathStep();
+}
+
+void pathAbort()
+{
+    bool wasPlaying;
+
+    playTimeout.detach();
+    core_util_critical_section_enter();
+    wasPlaying = (playing != NULL);
+    playing = NULL;
+    core_util_critical_section_exit();
+
+    if (wasPlaying)
+        motionStop();
+}
+
+bool pathIsPlaying()
+{
+    return playing != NULL;
+}
+
+static void pathUpload(const uint8_t *p, int length)
+{
+    int first = p[2];
+    int count = p[3];
+
+    if (pathIsPlaying() || recording || count > PATH_UPLOAD_SEGMENTS ||
+        length < 4 + count * PATH_SEGMENT_SIZE || 
+        first + count > PATH_MAX_SEGMENTS || first > pathLen) {
+        printf("path: bad upload\n");
+        return;
+    }
+
+    p += 4;
+    for (int i = 0; i < count; i++, p += PATH_SEGMENT_SIZE) {
+        path[first + i].left = (int8_t)p[0];
+        path[first + i].right = (int8_t)p[1];
+        path[first + i].durationMs = p[2] | (p[3] << 8);
+    }
+    pathLen = first + count;
+}
+
+void pathCommand(const char *content, int length)
+{
+    switch (content[1]) {
+        case PATH_RECORD:
+            pathAbort();
+            pathRecordStart();
+            printf("path: recording\n");
+            break;
+        case PATH_STOP:
+            pathRecordStop();
+            printf("path: recorded %d segments\n", pathLen);
+            break;
+        case PATH_PLAY:
+            pathRecordStop();
+            pathPlay(path, pathLen);
+            break;
+        case PATH_ABORT:
+            pathAbort();
+            break;
+        case PATH_UPLOAD:
+            pathUpload((const uint8_t *)content, length);
+            break;
+        case PATH_DOWNLOAD:
+            nextChunk = 0;
+            dumpPending = true;
+            break;
+        default:
+            printf("path: invalid message\n");
+            break;
+    }
+}
+
+int pathNextChunk(char *buf)
+{
+    int chunks = (pathLen + PATH_CHUNK_SEGMENTS - 1) / PATH_CHUNK_SEGMENTS;
+    int first = nextChunk * PATH_CHUNK_SEGMENTS;
+    int n;
+
+    if (!dumpPending)
+        return 0;
+
+    /* an empty path is sent as a single chunk with no segments */
+    if (chunks == 0)
+        chunks = 1;
+    if (nextChunk >= chunks) {
+        dumpPending = false;
+        return 0;
+    }
+
+    n = pathLen - first;
+    if (n > PATH_CHUNK_SEGMENTS)
+        n = PATH_CHUNK_SEGMENTS;
+    if (n < 0)
+        n = 0;
+
+    buf[0] = nextChunk & 0xFF;
+    buf[1] = nextChunk >> 8;
+    buf[2] = chunks & 0xFF;
+    buf[3] = chunks >> 8;
+    for (int i = 0; i < n; i++) {
+        buf[4 + i * 4] = path[first + i].left;
+        buf[5 + i * 4] = path[first + i].right;
+        buf[6 + i * 4] = path[first + i].durationMs & 0xFF;
+        buf[7 + i * 4] = path[first + i].durationMs >> 8;
+    }
+    nextChunk++;
+
+    return 4 + n * PATH_SEGMENT_SIZE;
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Path.h
+ * @brief      Records driven paths and plays them back with hardware timing.
+ *
+ *             While recording, every motionCommand() becomes a segment of 
+ *             wheel speeds and how long they were held. Back-to-back commands
+ *             with the same speeds are run-length encoded into one segment, 
+ *             so a path of many short movement() calls stays small. Pauses 
+ *             between commands are kept as segments with both speeds at 0.
+ *
+ *             Playback is driven by a Timeout, so every segment starts on 
+ *             time no matter what the threads are doing, and a stored path 
+ *             needs no network traffic once it is on the robot.
+ *
+ *             Controlled with FWD_TO_PATH messages (see MQTTNetwork.h):
+ *
+ *                 PATH_RECORD, PATH_STOP, PATH_PLAY, PATH_ABORT
+ *                 PATH_UPLOAD    [2] index of the first segment, 
+ *                                [3] segment count n (at most 
+ *                                    PATH_UPLOAD_SEGMENTS), then n segments.
+ *                                An index of 0 starts a new path.
+ *                 PATH_DOWNLOAD  publish the stored path to PATH_TOPIC
+ *
+ *             A segment is 4 bytes: left speed (int8), right speed (int8) and
+ *             the duration in ms (uint16, little endian). Downloads are 
+ *             published in chunks:
+ *
+ *                 [0-1]  chunk index
+ *                 [2-3]  chunk count
+ *                 [4-]   up to PATH_CHUNK_SEGMENTS segments
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _PATH_H_
+#define _PATH_H_
+
+#include "mbed.h"
+
+#define PATH_TOPIC              "m3pi-mqtt-ee250/path"
+#define PATH_MAX_SEGMENTS       128
+#define PATH_SEGMENT_SIZE       4
+
+/* segments per PATH_UPLOAD message, to fit a MailMsg */
+#define PATH_UPLOAD_SEGMENTS    7
+#define PATH_CHUNK_SEGMENTS     12
+#define PATH_CHUNK_SIZE         (4 + PATH_SEGMENT_SIZE * PATH_CHUNK_SEGMENTS)
+
+typedef struct {
+    int8_t   left;
+    int8_t   right;
+    uint16_t durationMs;
+} PathSegment;
+
+/**
+ * @brief      Called by motionCommand() with every command while recording.
+ *             Safe to call from an ISR.
+ */
+void pathRecordCommand(int left, int right, int duration_ms);
+
+/**
+ * @brief      Starts playing segments. Anything playing is aborted first.
+ *
+ * @param[in]  segments  The path, which must stay valid while it plays
+ * @param[in]  count     Number of segments
+ */
+void pathPlay(const PathSegment *segments, int count);
+
+/**
+ * @brief      Stops playback. The wheels ramp down to a stop.
+ */
+void pathAbort();
+
+/**
+ * @brief      Returns true while a path is playing.
+ */
+bool pathIsPlaying();
+
+/**
+ * @brief      Handles a FWD_TO_PATH message. Called by messageArrived().
+ *
+ * @param[in]  content  The whole message, starting with the forward byte
+ * @param[in]  length   Its length
+ */
+void pathCommand(const char *content, int length);
+
+/**
+ * @brief      Formats the next chunk of a requested download. Call this from 
+ *             the MQTT thread until it returns 0.
+ *
+ * @param      buf   Buffer of at least PATH_CHUNK_SIZE bytes
+ *
+ * @return     Number of bytes written, 0 if there is nothing to publish
+ */
+int pathNextChunk(char *buf);
+
+#endif /* _PATH_H_ */
@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Power.cpp
+ * @brief      Implementation of idle power management.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Power.h"
+#include "Motion.h"
+#include "m3pi.h"
+#include "rtos.h"
+
+extern m3pi m3pi;
+
+/* PCONP bits of peripherals this application never uses: UART1, PWM1, I2C0-2,
+   SPI, SSP0-1, CAN1-2, RIT, MCPWM, QEI, I2S, Ethernet and USB. mbed drivers 
+   power their peripheral back on when constructed, so this is safe even if 
+   someone adds one of them later. */
+#define UNUSED_PERIPHERALS  ((1UL << 4)  | (1UL << 6)  | (1UL << 7)  | \
+                             (1UL << 8)  | (1UL << 10) | (1UL << 13) | \
+                             (1UL << 14) | (1UL << 16) | (1UL << 17) | \
+                             (1UL << 18) | (1UL << 19) | (1UL << 21) | \
+                             (1UL << 26) | (1UL << 27) | (1UL << 30) | \
+                             (1UL << 31))
+
+static volatile bool sleepEnabled = true;
+static volatile uint32_t sleptUs = 0;
+
+static uint16_t bootMillivolts;
+static volatile uint16_t lastMillivolts;
+static Timer uptime;
+static uint32_t lastReportUs;
+
+static uint16_t readBatteryMillivolts()
+{
+    uint16_t mv;
+
+    m3piMtx.lock();
+    mv = m3pi.battery_millivolts();
+    m3piMtx.unlock();
+
+    lastMillivolts = mv;
+    return mv;
+}
+
+/* runs in the idle thread whenever no other thread is ready */
+static void powerIdleHook()
+{
+    uint32_t start;
+
+    if (!sleepEnabled)
+        return;
+
+    /* Sleep with interrupts masked so the time accounting cannot be preempted.
+       A pending interrupt still wakes the core, and its handler runs as soon
+       as we leave the critical section. */
+    core_util_critical_section_enter();
+    start = us_ticker_read();
+    sleep();
+    sleptUs += us_ticker_read() - start;
+    core_util_critical_section_exit();
+}
+
+void powerInit()
+{
+    LPC_SC->PCONP &= ~UNUSED_PERIPHERALS;
+
+    uptime.start();
+    lastReportUs = us_ticker_read();
+    bootMillivolts = readBatteryMillivolts();
+    printf("power: battery at boot %u mV\n", bootMillivolts);
+
+    Thread::attach_idle_hook(powerIdleHook);
+}
+
+void powerSetSleepEnabled(bool enabled)
+{
+    sleepEnabled = enabled;
+}
+
+uint16_t powerBatteryMillivolts()
+{
+    return lastMillivolts;
+}
+
+int powerFormatReport(char *buf)
+{
+    uint16_t now = readBatteryMillivolts();
+    uint32_t nowUs, elapsedUs, slept, seconds;
+    uint16_t permille;
+
+    core_util_critical_section_enter();
+    slept = sleptUs;
+    sleptUs = 0;
+    core_util_critical_section_exit();
+
+    nowUs = us_ticker_read();
+    elapsedUs = nowUs - lastReportUs;
+    lastReportUs = nowUs;
+    seconds = uptime.read_ms() / 1000;
+    permille = elapsedUs ? (uint16_t)((uint64_t)slept * 1000 / elapsedUs) : 0;
+
+    buf[0] = bootMillivolts & 0xFF;
+    buf[1] = bootMillivolts >> 8;
+    buf[2] = now & 0xFF;
+    buf[3] = now >> 8;
+    buf[4] = seconds & 0xFF;
+    buf[5] = (seconds >> 8) & 0xFF;
+    buf[6] = (seconds >> 16) & 0xFF;
+    buf[7] = seconds >> 24;
+    buf[8] = permille & 0xFF;
+    buf[9] = permille >> 8;
+    buf[10] = sleepEnabled ? 1 : 0;
+
+    return POWER_REPORT_SIZE;
+}
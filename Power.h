@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Power.h
+ * @brief      Idle power management and battery reporting.
+ *
+ *             When every thread is blocked (all mailboxes empty, no timers 
+ *             due), mbed OS runs its idle thread. We hook that thread to put
+ *             the LPC1768 to sleep until the next interrupt, which includes
+ *             UART traffic from the ESP8266 and the 3pi. Time spent asleep is
+ *             accounted for so the gain can be measured against the battery
+ *             voltage reported by the 3pi.
+ *
+ *             Deep sleep is not used. On the LPC1768 it stops the peripheral 
+ *             clocks, so the ESP8266 UART could not wake us up and the MQTT 
+ *             keepalive would be missed.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _POWER_H_
+#define _POWER_H_
+
+#include "mbed.h"
+
+/* how often the main thread publishes a power report */
+#define POWER_REPORT_INTERVAL_MS    60000
+
+/* size of the payload written by powerFormatReport() */
+#define POWER_REPORT_SIZE           11
+
+/**
+ * @brief      Powers down unused peripherals, records the battery voltage at
+ *             boot and attaches the idle hook. Call this once at the start of 
+ *             main().
+ */
+void powerInit();
+
+/**
+ * @brief      Enables or disables sleeping in the idle thread. Disabling it
+ *             lets you measure battery drain without power management.
+ *
+ * @param[in]  enabled  true to sleep when idle
+ */
+void powerSetSleepEnabled(bool enabled);
+
+/**
+ * @brief      Returns the battery voltage in mV as of the last power report,
+ *             or boot. Does not talk to the 3pi.
+ */
+uint16_t powerBatteryMillivolts();
+
+/**
+ * @brief      Fills in a power report for publishing. The report is raw bytes,
+ *             little endian:
+ *
+ *                 [0-1]  battery at boot in mV
+ *                 [2-3]  battery now in mV
+ *                 [4-7]  seconds since boot
+ *                 [8-9]  permille of time asleep since the last report
+ *                 [10]   1 if sleeping when idle is enabled
+ *
+ * @param      buf   Buffer of at least POWER_REPORT_SIZE bytes
+ *
+ * @return     Number of bytes written
+ */
+int powerFormatReport(char *buf);
+
+#endif /* _POWER_H_ */
@@ -37,7 +37,7 @@
 
 /**
  * @file       PrintThread.cpp
- * @brief      Implementation of thread that handles print requests.
+ * @brief      Implementation of the worker that handles print requests.
  *
  * @author     Jason Tran <jasontra@usc.edu>
  * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
@@ -48,73 +48,96 @@
 #include "MQTTNetwork.h"
 #include "mbed.h"
 #include "m3pi.h"
+#include "Config.h"
+#include "Path.h"
+#include "Teleop.h"
+#include "Nav.h"
 
-Mail<MailMsg, PRINTTHREAD_MAILBOX_SIZE> PrintThreadMailbox;
-extern void movement(char command, char speed, int delta_t);
+/* the mailbox of the print worker is allocated here, it runs on the normal
+   executor (see Topology.h) */
+static PrintWorker printWorker;
+
+/* forward movement after each message, played by the path engine. A 
+   segment lasts at most 0xFFFF ms, so a long move takes up to one segment 
+   per step. */
+#define PRINT_FORWARD_STEPS 16
+#define PRINT_SEGMENT_MAX_MS 0xFFFF
+static PathSegment forwardPath[PRINT_FORWARD_STEPS];
 
 /* When you read any .c or .cpp files, you often want to open their 
    corresponding header file and read them simultaneously. */
-void printThread() 
+
+/* The worker (see Worker.h) gets anything put in the print worker's mailbox.
+   Once something is put inside the mailbox, the executor thread wakes up and
+   calls this function with the message. This structure is what makes the 
+   application event-based. In the current structure, the print worker 
+   receives mail from the MQTT callback messageArrived() defined in main.cpp.
+   Like every handler, this must not block: other workers wait for it to 
+   return. */
+static void handlePrintMessage(MailMsg *msg) 
 {
-    MailMsg *msg; // see MailMsg.h for this type
-    osEvent evt; 
+    char speed;
+    int duration;
+    uint32_t totalMs;
+    int count;
 
-    while(1) {
-        /* Get anything from the PrintThread's mailbox. If it's empty, this 
-           call will block. Once something is put inside the mailbox, mbed OS
-           will wake this thread up and resume. This structure is what makes 
-           this thread event-based. In the current structure, the PrintThread 
-           is waiting to receive mail from the MQTT callback messageArrived()
-           defined in main.cpp */
-        evt = PrintThreadMailbox.get();
+    /* the second byte in the the content of the message tells us what
+       action to "dispatch." The message types are defined in 
+       MQTTNetwork.h */
+    switch (msg->content[1]) {
+        case PRINT_MSG_TYPE_0:
+            printf("printThread: this is a print of message type 0!\n");
+            break;
+        case PRINT_MSG_TYPE_1:
+            printf("printThread: this is a print of message type 1!\n");
+            break;
+        default:
+            printf("printThread: invalid message\n");
+            break;
+    }
 
-        /* Double check if the event type is a new piece of mail */
-        if(evt.status == osEventMail) {
-            msg = (MailMsg *)evt.value.p;
+    /* The worker frees the message after this returns. If you handle mail 
+       yourself, you must always free the message after you're done. Not doing
+       so will eventually fill up your mailbox and freeze your entire 
+       program. */
 
-            /* the second byte in the the content of the message tells us what
-               action to "dispatch." The message types are defined in 
-               MQTTNetwork.h */
-            switch (msg->content[1]) {
-                case PRINT_MSG_TYPE_0:
-                    printf("printThread: this is a print of message type 0!\n");
-                    break;
-                case PRINT_MSG_TYPE_1:
-                    printf("printThread: this is a print of message type 1!\n");
-                    break;
-                default:
-                    printf("printThread: invalid message\n");
-                    break;
-            }
+    /* speed and duration can be retuned over MQTT (see Config.h) */
+    speed = configGetInt(CFG_MOVE_SPEED, CONFIG_DEFAULT_MOVE_SPEED);
+    duration = configGetInt(CFG_MOVE_DURATION, CONFIG_DEFAULT_MOVE_DURATION);
 
-            /* You must always free the message after you're done. Not doing so
-               will eventually fill up your mailbox and freeze your entire 
-               program. */
-            PrintThreadMailbox.free(msg);
+    /* This used to be movement('w', speed, duration) 16 times in a row. It
+       is one path segment now (more if it is longer than a segment holds),
+       played with exact timing (see Path.h) while the executor goes on to 
+       the next message. Nothing else may be driving the wheels. */
+    if (!pathIsPlaying() && !teleopIsActive() && !navIsActive()) {
+        if (duration < 0)
+            duration = 0;
+        if (duration > PRINT_SEGMENT_MAX_MS)
+            duration = PRINT_SEGMENT_MAX_MS;
+        totalMs = PRINT_FORWARD_STEPS * (uint32_t)duration;
+
+        for (count = 0; count == 0 || totalMs > 0; count++) {
+            forwardPath[count].left = -speed;
+            forwardPath[count].right = -speed;
+            forwardPath[count].durationMs = totalMs > PRINT_SEGMENT_MAX_MS ? 
+                                            PRINT_SEGMENT_MAX_MS : totalMs;
+            totalMs -= forwardPath[count].durationMs;
         }
+        pathPlay(forwardPath, count);
+    }
+}
 
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-        movement('w', 25, 100);
-    } /* while */
+void startPrintThread(EventQueue *queue)
+{
+    printWorker.start(queue, handlePrintMessage);
+}
 
-    /* this should never be reached */
+PrintWorker *getPrintThreadMailbox() 
+{
+    return &printWorker;
 }
 
-Mail<MailMsg, PRINTTHREAD_MAILBOX_SIZE> *getPrintThreadMailbox() 
+uint32_t getPrintThreadHandledCount()
 {
-    return &PrintThreadMailbox;
+    return printWorker.handled();
 }
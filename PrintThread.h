@@ -37,7 +37,7 @@
 
 /**
  * @file       PrintThread.h
- * @brief      Thread that handles print requests.
+ * @brief      Worker that handles print requests.
  *
  * @author     Jason Tran <jasontra@usc.edu>
  * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
@@ -48,18 +48,30 @@
 
 #include "rtos.h"
 #include "MailMsg.h"
+#include "Worker.h"
 
-#define PRINTTHREAD_MAILBOX_SIZE  32
+#define PRINTTHREAD_MAILBOX_SIZE  16
+
+/* see Worker.h and Topology.h */
+typedef EventWorker<MailMsg, PRINTTHREAD_MAILBOX_SIZE> PrintWorker;
+
+/**
+ * @brief      Starts handling print requests.
+ *
+ * @param      queue  Queue of the executor to run on
+ */
+void startPrintThread(EventQueue *queue);
 
 /**
- * @brief      Main LED thread function
+ * @brief      Returns a pointer to the print worker's mailbox
+ * @return     Pointer to print worker's mailbox
  */
-void printThread();
+PrintWorker *getPrintThreadMailbox();
 
 /**
- * @brief      Returns a pointer to the print thread's mailbox
- * @return     Pointer to print thread's mailbox
+ * @brief      Returns how many messages the print worker has handled so far.
+ *             Together with a count of put()s, this gives the mailbox depth.
  */
-Mail<MailMsg, PRINTTHREAD_MAILBOX_SIZE> *getPrintThreadMailbox();
+uint32_t getPrintThreadHandledCount();
 
 #endif /* _PRINT_THREAD_H_ */
@@ -0,0 +1,169 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Range.cpp
+ * @brief      Implementation of the ultrasonic range sensor readings.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Range.h"
+#include "rtos.h"
+#include "FixedPoint.h"
+
+/* sets up the pin and powers the ADC, even though sampling is done on the
+   registers once it runs */
+static AnalogIn rangeAin(RANGE_SENSOR_PIN);
+
+#define ADC_BURST       (1UL << 16)
+#define ADC_PDN         (1UL << 21)
+#define ADC_CLKDIV_MASK (0xFFUL << 8)
+#define ADC_DONE        (1UL << 31)
+
+/* A conversion takes 65 ADC clocks, 5.4 usec at the 12 MHz that AnalogIn
+   sets up. Give up on a sample after twice that. */
+#define ADC_SPIN_MAX    200
+
+static Ticker rangeTicker;
+static volatile bool running = false;
+static volatile uint32_t samples = 0;
+
+static uint16_t window[RANGE_MEDIAN_N];
+static int windowPos = 0;
+static int32_t ema;                 /* raw << 4, for the fraction */
+static volatile uint16_t filtered;  /* raw, 16 bit like read_u16() */
+
+/* The sensor outputs 9.8 mV per inch (Vcc = 5V). Scaled the same way as the
+   LEDThread's old "voltage / 0.0098" inches, that is 25.4 / 642.2 mm per ADC
+   count. Measure a few distances and replace these points to calibrate your
+   sensor. It cannot see closer than about 150 mm. */
+static const FixCalPoint rangeTable[] = {
+    {     0,    0 },
+    { 16384,  648 },
+    { 32768, 1296 },
+    { 49152, 1944 },
+    { 65535, 2592 }
+};
+
+int rangeRawToMm(uint16_t raw)
+{
+    return fixCalibrate(rangeTable, sizeof(rangeTable) / sizeof(rangeTable[0]),
+                        raw);
+}
+
+/* runs from the Ticker at RANGE_RATE_HZ */
+static void rangeSample()
+{
+    volatile uint32_t *addr = &LPC_ADC->ADDR0 + RANGE_ADC_CHANNEL;
+    uint16_t sorted[RANGE_MEDIAN_N];
+    uint32_t sum = 0;
+    uint32_t r;
+    int i, j, spin;
+
+    /* reading the result clears DONE, so each one is a new conversion */
+    for (i = 0; i < RANGE_OVERSAMPLE; i++) {
+        spin = 0;
+        while (!((r = *addr) & ADC_DONE)) {
+            if (++spin > ADC_SPIN_MAX) {
+                return;
+            }
+        }
+        sum += (r >> 4) & 0xFFF;
+    }
+
+    /* 12 bit conversions to 16 bit */
+    window[windowPos] = (sum << 4) / RANGE_OVERSAMPLE;
+    windowPos = (windowPos + 1) % RANGE_MEDIAN_N;
+
+    /* insertion sort, it is only RANGE_MEDIAN_N values */
+    for (i = 0; i < RANGE_MEDIAN_N; i++) {
+        uint16_t v = window[i];
+        for (j = i; j > 0 && sorted[j - 1] > v; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+
+    ema += (((int32_t)sorted[RANGE_MEDIAN_N / 2] << 4) - ema) >> RANGE_EMA_SHIFT;
+    filtered = ema >> 4;
+    samples++;
+}
+
+static void rangeStart()
+{
+    uint16_t first = rangeAin.read_u16();
+
+    /* start from a real reading instead of ramping up from 0 */
+    for (int i = 0; i < RANGE_MEDIAN_N; i++) {
+        window[i] = first;
+    }
+    ema = (int32_t)first << 4;
+    filtered = first;
+
+    /* keep the clock divider, convert only our channel, over and over */
+    LPC_ADC->ADCR = (LPC_ADC->ADCR & ADC_CLKDIV_MASK) | 
+                    (1UL << RANGE_ADC_CHANNEL) | ADC_BURST | ADC_PDN;
+
+    running = true;
+    rangeTicker.attach_us(callback(rangeSample), 1000000 / RANGE_RATE_HZ);
+}
+
+int rangeReadMm()
+{
+    /* AnalogIn would stop burst mode, so it is only used before */
+    if (!running) {
+        return rangeRawToMm(rangeAin.read_u16());
+    }
+    return rangeRawToMm(filtered);
+}
+
+uint32_t rangeSampleCount()
+{
+    return samples;
+}
+
+void rangeWarmUp()
+{
+    if (!running) {
+        rangeStart();
+    }
+
+    /* the filter follows along, so it is settled by the end */
+    Thread::wait(RANGE_WARMUP_MS);
+}
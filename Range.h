@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Range.h
+ * @brief      Ultrasonic range sensor on p15.
+ *
+ *             Once rangeWarmUp() ran, the ADC converts the sensor's channel
+ *             continuously in burst mode and a Ticker samples it at 
+ *             RANGE_RATE_HZ. Every sample is the average of RANGE_OVERSAMPLE
+ *             conversions. The samples go through a median of the last 
+ *             RANGE_MEDIAN_N, which throws out single spikes, and then an 
+ *             exponential filter with a weight of 1 / 2^RANGE_EMA_SHIFT. All
+ *             of it is integer math and costs about 25 usec per sample.
+ *
+ *             At 1 kHz, the median delays the distance by 2 msec and the 
+ *             exponential filter settles 63% of a step in 8 msec, so the 
+ *             filtered distance lags the sensor by about 10 msec. That is 
+ *             well within the sensor's own 50 msec update period.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _RANGE_H_
+#define _RANGE_H_
+
+#include "mbed.h"
+
+#define RANGE_SENSOR_PIN    p15
+#define RANGE_ADC_CHANNEL   0       /* p15 is AD0.0 */
+
+/* the sensor takes a new reading every ~50 msec */
+#define RANGE_SAMPLE_PERIOD_MS  50
+#define RANGE_WARMUP_MS         300
+
+#define RANGE_RATE_HZ           1000
+#define RANGE_OVERSAMPLE        4   /* conversions averaged per sample */
+#define RANGE_MEDIAN_N          5   /* odd */
+#define RANGE_EMA_SHIFT         3
+#define RANGE_FILTER_LAG_MS     10  /* median and exponential filter */
+
+/**
+ * @brief      Returns the filtered distance. Before rangeWarmUp(), it samples
+ *             the sensor once instead.
+ *
+ *             This never blocks on another thread, so it is safe to call from
+ *             the motion thread's control loop.
+ *
+ * @return     The distance to the nearest obstacle in millimeters
+ */
+int rangeReadMm();
+
+/**
+ * @brief      Returns the number of samples taken since rangeWarmUp().
+ */
+uint32_t rangeSampleCount();
+
+/**
+ * @brief      Converts a raw reading of the ADC (read_u16()) to millimeters 
+ *             with the sensor's calibration table. Integer math only.
+ */
+int rangeRawToMm(uint16_t raw);
+
+/**
+ * @brief      Starts sampling and blocks until the sensor gives valid 
+ *             readings after power up. The sensor calibrates itself for about
+ *             250 msec after power up, so the first readings are thrown away.
+ */
+void rangeWarmUp();
+
+#endif /* _RANGE_H_ */
@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Reflex.cpp
+ * @brief      Implementation of the collision avoidance reflex.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Reflex.h"
+#include "Range.h"
+#include "FlightRecorder.h"
+#include "m3pi.h"
+
+static int lastDistance = -1;
+static int32_t closingSpeed = 0;    /* mm/s, positive when approaching */
+static uint32_t trips = 0;
+static bool clamping = false;
+
+bool reflexLimit(int32_t *left, int32_t *right)
+{
+    int distance = rangeReadMm();
+    int32_t predicted, allowed, fwd;
+
+    /* closing speed from consecutive samples, smoothed with a 1/4 weight so 
+       one noisy sample cannot veto on its own */
+    if (lastDistance >= 0) {
+        int32_t sample = (lastDistance - distance) * 1000 / MOTION_TICK_MS;
+        closingSpeed += (sample - closingSpeed) / 4;
+    }
+    lastDistance = distance;
+
+    predicted = distance;
+    if (closingSpeed > 0)
+        predicted -= closingSpeed * REFLEX_LOOKAHEAD_MS / 1000;
+
+    if (predicted <= REFLEX_STOP_MM)
+        allowed = 0;
+    else if (predicted >= REFLEX_SLOW_MM) {
+        clamping = false;
+        return false;
+    }
+    else
+        allowed = ((int32_t)MAX_SPEED << 8) * (predicted - REFLEX_STOP_MM)
+                  / (REFLEX_SLOW_MM - REFLEX_STOP_MM);
+
+    fwd = MOTION_FORWARD_SIGN * (*left + *right) / 2;
+    if (fwd <= allowed) {
+        clamping = false;
+        return false;
+    }
+
+    /* record when the reflex kicks in, not every tick it stays engaged */
+    if (!clamping) {
+        clamping = true;
+        frRecord(FR_EVT_REFLEX, 0, distance);
+    }
+
+    /* scale both wheels so turning is kept but forward speed is capped */
+    *left = (int32_t)((int64_t)*left * allowed / fwd);
+    *right = (int32_t)((int64_t)*right * allowed / fwd);
+    trips++;
+    return true;
+}
+
+uint32_t reflexGetTrips()
+{
+    return trips;
+}
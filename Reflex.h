@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Reflex.h
+ * @brief      Collision avoidance reflex applied inside the motion thread.
+ *
+ *             The reflex sits between the motion profile and the motors. Every
+ *             motion tick it samples the range sensor itself, estimates how 
+ *             fast we are closing in on the obstacle, and clamps (or vetoes) 
+ *             forward wheel speed. It never waits on MQTT or on a mailbox.
+ *
+ *             It does wait for the 3pi UART: the motors are written under 
+ *             m3piMtx, which the LCD thread, battery reads, the serial log 
+ *             commands and robotInit() also take, and the motion thread's 
+ *             own line sensor reads hold it between ticks. Any of them can be
+ *             waiting for a reply. With the 3pi answering that costs a few 
+ *             msec, but when it stops answering only the driver's timeouts 
+ *             bound it, M3PI_CALL_MAX_MS per call. The motion thread has the
+ *             highest priority of them and waits for at most one call. From
+ *             a change of the filtered distance, the worst case reaction 
+ *             time is then one motion tick, the range filter's lag, that one
+ *             call and a pacing sync() before each of the two motor 
+ *             commands, which is REFLEX_REACTION_MS (well over a second). 
+ *             The sensor itself only updates every RANGE_SAMPLE_PERIOD_MS on
+ *             top of that.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _REFLEX_H_
+#define _REFLEX_H_
+
+#include "mbed.h"
+#include "Motion.h"
+#include "Range.h"
+#include "m3pi.h"
+
+/* forward motion is vetoed when the predicted distance drops below this */
+#define REFLEX_STOP_MM          150
+
+/* forward speed is scaled down linearly between STOP and SLOW */
+#define REFLEX_SLOW_MM          500
+
+/* how far ahead we predict the distance using the closing speed */
+#define REFLEX_LOOKAHEAD_MS     200
+
+/* worst case, see above */
+#define REFLEX_REACTION_MS      (MOTION_TICK_MS + RANGE_FILTER_LAG_MS + \
+                                 M3PI_CALL_MAX_MS + 2 * M3PI_SYNC_MAX_MS)
+
+/**
+ * @brief      Clamps the forward component of the given wheel speeds based on
+ *             a fresh range sample. Called by the motion thread every tick.
+ *
+ * @param      left   The left wheel speed in Q8 (speed units * 256)
+ * @param      right  The right wheel speed in Q8 (speed units * 256)
+ *
+ * @return     true if the speeds were clamped
+ */
+bool reflexLimit(int32_t *left, int32_t *right);
+
+/**
+ * @brief      Returns how many motion ticks the reflex has clamped since boot.
+ */
+uint32_t reflexGetTrips();
+
+#endif /* _REFLEX_H_ */
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       SerialLog.cpp
+ * @brief      Implementation of the m3pi serial record and replay control.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "SerialLog.h"
+#include "MQTTNetwork.h"
+#include "Motion.h"
+#include "m3pi.h"
+
+extern m3pi m3pi;
+
+static uint8_t logBuf[SERIAL_LOG_SIZE];
+static size_t logLen = 0;
+
+/* what serialLogNextChunk() has left to publish */
+static volatile bool dumpPending = false;
+static volatile bool resultPending = false;
+static int nextChunk = 0;
+static int mismatches = 0;
+
+void serialLogCommand(char type)
+{
+    m3piMtx.lock();
+    switch (type) {
+        case SERIAL_LOG_RECORD:
+            m3pi.start_recording(logBuf, sizeof(logBuf));
+            printf("serial log: recording\n");
+            break;
+        case SERIAL_LOG_STOP:
+            logLen = m3pi.stop_recording();
+            nextChunk = 0;
+            dumpPending = true;
+            printf("serial log: recorded %u bytes\n", (unsigned)logLen);
+            break;
+        case SERIAL_LOG_REPLAY:
+            m3pi.start_replay(logBuf, logLen);
+            printf("serial log: replaying %u bytes\n", (unsigned)logLen);
+            break;
+        case SERIAL_LOG_REPLAY_STOP:
+            mismatches = m3pi.stop_replay();
+            resultPending = true;
+            printf("serial log: replay done, %d mismatches\n", mismatches);
+            break;
+        default:
+            printf("serial log: invalid message\n");
+            break;
+    }
+    m3piMtx.unlock();
+}
+
+int serialLogNextChunk(char *buf)
+{
+    int chunks = (logLen + SERIAL_LOG_CHUNK_DATA - 1) / SERIAL_LOG_CHUNK_DATA;
+    int n;
+
+    if (resultPending) {
+        resultPending = false;
+        buf[0] = 0;
+        buf[1] = 0;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = mismatches & 0xFF;
+        buf[5] = (mismatches >> 8) & 0xFF;
+        buf[6] = (mismatches >> 16) & 0xFF;
+        buf[7] = (mismatches >> 24) & 0xFF;
+        return 8;
+    }
+
+    if (!dumpPending)
+        return 0;
+
+    if (nextChunk >= chunks) {
+        dumpPending = false;
+        return 0;
+    }
+
+    n = logLen - nextChunk * SERIAL_LOG_CHUNK_DATA;
+    if (n > SERIAL_LOG_CHUNK_DATA)
+        n = SERIAL_LOG_CHUNK_DATA;
+
+    buf[0] = nextChunk & 0xFF;
+    buf[1] = nextChunk >> 8;
+    buf[2] = chunks & 0xFF;
+    buf[3] = chunks >> 8;
+    memcpy(&buf[4], &logBuf[nextChunk * SERIAL_LOG_CHUNK_DATA], n);
+    nextChunk++;
+
+    return 4 + n;
+}
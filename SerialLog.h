@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       SerialLog.h
+ * @brief      Records and replays the m3pi serial traffic on request.
+ *
+ *             Controlled with FWD_TO_SERIAL_LOG messages (see MQTTNetwork.h).
+ *             A stopped recording is published to SERIAL_LOG_TOPIC in chunks:
+ *
+ *                 [0-1]  chunk index
+ *                 [2-3]  chunk count
+ *                 [4-]   up to SERIAL_LOG_CHUNK_DATA bytes of the log
+ *
+ *             A stopped replay publishes one chunk with a count of 0 and the
+ *             number of mismatched bytes as a little endian uint32 instead.
+ *             The log format is described at m3pi::start_recording(). Use 
+ *             m3pi_serial_log.py on your computer to collect and analyze it,
+ *             and host/m3pi_replay.cpp to run the driver against it.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _SERIAL_LOG_H_
+#define _SERIAL_LOG_H_
+
+#include "mbed.h"
+
+#define SERIAL_LOG_TOPIC        "m3pi-mqtt-ee250/serial-log"
+#define SERIAL_LOG_SIZE         2048
+#define SERIAL_LOG_CHUNK_DATA   48
+#define SERIAL_LOG_CHUNK_SIZE   (4 + SERIAL_LOG_CHUNK_DATA)
+
+/**
+ * @brief      Handles a FWD_TO_SERIAL_LOG message. Called by messageArrived().
+ *
+ * @param[in]  type  The SERIAL_LOG_* message type
+ */
+void serialLogCommand(char type);
+
+/**
+ * @brief      Formats the next chunk of a finished recording or replay to 
+ *             publish. Call this from the MQTT thread until it returns 0.
+ *
+ * @param      buf   Buffer of at least SERIAL_LOG_CHUNK_SIZE bytes
+ *
+ * @return     Number of bytes written, 0 if there is nothing to publish
+ */
+int serialLogNextChunk(char *buf);
+
+#endif /* _SERIAL_LOG_H_ */
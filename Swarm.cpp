@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Swarm.cpp
+ * @brief      Implementation of the swarm state broadcast and neighbor table.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Swarm.h"
+#include "rtos.h"
+#include "TimeSync.h"
+
+typedef struct {
+    bool          used;
+    uint32_t      lastSeenMs;
+    SwarmNeighbor n;
+} SwarmSlot;
+
+static SwarmSlot neighbors[SWARM_MAX_NEIGHBORS];
+static Mutex swarmMtx;
+static Timer swarmClock;
+
+static uint8_t myId = 0;
+static uint16_t mySeq = 0;
+static uint8_t myIntent = SWARM_INTENT_IDLE;
+static uint8_t myIntentArg = 0;
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static void put16(char *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+void swarmInit(uint8_t id)
+{
+    myId = id;
+    swarmClock.start();
+}
+
+void swarmSetIntent(uint8_t intent, uint8_t arg)
+{
+    myIntent = intent;
+    myIntentArg = arg;
+}
+
+int swarmFormatState(char *buf)
+{
+    MotionPose pose;
+    uint8_t intent = myIntent;
+    uint64_t stamp;
+
+    motionGetPose(&pose);
+    if (intent == SWARM_INTENT_IDLE && pose.speed != 0)
+        intent = SWARM_INTENT_MOVING;
+
+    buf[0] = SWARM_VERSION;
+    buf[1] = myId;
+    put16(&buf[2], mySeq++);
+    put16(&buf[4], (uint16_t)(int16_t)pose.x);
+    put16(&buf[6], (uint16_t)(int16_t)pose.y);
+    put16(&buf[8], pose.heading);
+    put16(&buf[10], (uint16_t)pose.speed);
+    buf[12] = intent;
+    buf[13] = myIntentArg;
+    stamp = timeIsSynced() ? timeNowUs() : 0;
+    for (int i = 0; i < 8; i++)
+        buf[14 + i] = (stamp >> (8 * i)) & 0xFF;
+
+    return SWARM_RECORD_SIZE;
+}
+
+void swarmMessageArrived(MQTT::MessageData& md)
+{
+    MQTT::Message &message = md.message;
+    const uint8_t *p = (const uint8_t *)message.payload;
+    uint32_t now, age, oldest = 0;
+    SwarmSlot *slot = NULL;
+    SwarmSlot *victim = NULL;
+    uint64_t stamp = 0;
+    int32_t latency = -1;
+
+    if (message.payloadlen < SWARM_RECORD_SIZE || p[0] != SWARM_VERSION 
+        || p[1] == myId)
+        return;
+
+    now = swarmClock.read_ms();
+
+    for (int i = 7; i >= 0; i--)
+        stamp = (stamp << 8) | p[14 + i];
+    if (stamp && timeIsSynced())
+        latency = (int32_t)(timeNowUs() - stamp);
+
+    swarmMtx.lock();
+    /* Find the robot's slot. Otherwise take a free slot, or the one we heard
+       from least recently (which is an expired one if there are any). */
+    for (int i = 0; i < SWARM_MAX_NEIGHBORS; i++) {
+        if (neighbors[i].used && neighbors[i].n.id == p[1]) {
+            slot = &neighbors[i];
+            break;
+        }
+        age = neighbors[i].used ? now - neighbors[i].lastSeenMs : 0xFFFFFFFF;
+        if (!victim || age > oldest) {
+            victim = &neighbors[i];
+            oldest = age;
+        }
+    }
+    if (!slot)
+        slot = victim;
+
+    slot->used = true;
+    slot->lastSeenMs = now;
+    slot->n.id = p[1];
+    slot->n.seq = get16(&p[2]);
+    slot->n.pose.x = (int16_t)get16(&p[4]);
+    slot->n.pose.y = (int16_t)get16(&p[6]);
+    slot->n.pose.heading = get16(&p[8]);
+    slot->n.pose.speed = (int16_t)get16(&p[10]);
+    slot->n.intent = p[12];
+    slot->n.intentArg = p[13];
+    slot->n.latencyUs = latency;
+    swarmMtx.unlock();
+}
+
+int swarmGetNeighbors(SwarmNeighbor *out, int max)
+{
+    uint32_t now = swarmClock.read_ms();
+    uint32_t age;
+    int count = 0;
+
+    swarmMtx.lock();
+    for (int i = 0; i < SWARM_MAX_NEIGHBORS && count < max; i++) {
+        if (!neighbors[i].used)
+            continue;
+        age = now - neighbors[i].lastSeenMs;
+        if (age > SWARM_EXPIRY_MS) {
+            neighbors[i].used = false;
+            continue;
+        }
+        out[count] = neighbors[i].n;
+        out[count].ageMs = age;
+        count++;
+    }
+    swarmMtx.unlock();
+
+    return count;
+}
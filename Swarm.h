@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Swarm.h
+ * @brief      Swarm state shared between robots on the same broker.
+ *
+ *             Every robot publishes a small fixed-size record with its pose 
+ *             and intent to SWARM_TOPIC every SWARM_PERIOD_MS, and keeps the 
+ *             records it hears from the others in a fixed table. Entries that
+ *             are not refreshed within SWARM_EXPIRY_MS are dropped. Local 
+ *             planners read the table with swarmGetNeighbors() instead of 
+ *             asking a central server. The record is raw bytes, little endian:
+ *
+ *                 [0]      SWARM_VERSION
+ *                 [1]      robot id
+ *                 [2-3]    sequence number
+ *                 [4-5]    x in mm (int16)
+ *                 [6-7]    y in mm (int16)
+ *                 [8-9]    heading (binary angle, see MotionPose)
+ *                 [10-11]  speed in mm/s (int16)
+ *                 [12]     intent (SWARM_INTENT_*)
+ *                 [13]     intent argument
+ *                 [14-21]  synchronized time it was sent in usec, 0 if the
+ *                          sender's clock is not synchronized (see TimeSync.h)
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _SWARM_H_
+#define _SWARM_H_
+
+#include "mbed.h"
+#include "MQTTClient.h"
+#include "Motion.h"
+
+#define SWARM_TOPIC             "m3pi-mqtt-ee250/swarm"
+#define SWARM_VERSION           2
+#define SWARM_RECORD_SIZE       22
+#define SWARM_PERIOD_MS         500
+#define SWARM_EXPIRY_MS         (4 * SWARM_PERIOD_MS)
+#define SWARM_MAX_NEIGHBORS     8
+
+/**
+ * What a robot is up to. SWARM_INTENT_IDLE and SWARM_INTENT_MOVING are
+ * filled in automatically unless something else has been set.
+ */
+enum {
+    SWARM_INTENT_IDLE,
+    SWARM_INTENT_MOVING,
+    SWARM_INTENT_TASK,      /* arg: task id */
+    SWARM_INTENT_YIELDING   /* arg: id of the robot we give way to */
+};
+
+typedef struct {
+    uint8_t    id;
+    uint8_t    intent;
+    uint8_t    intentArg;
+    uint16_t   seq;
+    uint32_t   ageMs;       /* time since the record was received */
+    int32_t    latencyUs;   /* from sender to us, -1 unless both are synced */
+    MotionPose pose;
+} SwarmNeighbor;
+
+/**
+ * @brief      Sets this robot's id. Call before the first broadcast.
+ */
+void swarmInit(uint8_t id);
+
+/**
+ * @brief      Sets the intent broadcast with our state. Set it back to 
+ *             SWARM_INTENT_IDLE to have it filled in automatically again.
+ */
+void swarmSetIntent(uint8_t intent, uint8_t arg);
+
+/**
+ * @brief      Fills in our state record for publishing.
+ *
+ * @param      buf   Buffer of at least SWARM_RECORD_SIZE bytes
+ *
+ * @return     Number of bytes written
+ */
+int swarmFormatState(char *buf);
+
+/**
+ * @brief      MQTT callback for SWARM_TOPIC.
+ */
+void swarmMessageArrived(MQTT::MessageData& md);
+
+/**
+ * @brief      Copies the neighbors that have not expired.
+ *
+ * @param      out   Array to copy into
+ * @param[in]  max   The size of out
+ *
+ * @return     Number of neighbors copied
+ */
+int swarmGetNeighbors(SwarmNeighbor *out, int max);
+
+#endif /* _SWARM_H_ */
@@ -0,0 +1,163 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Teleop.cpp
+ * @brief      Continuous direction control from a joystick or keyboard.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Teleop.h"
+#include "Latest.h"
+#include "Motion.h"
+#include "MQTTNetwork.h"
+#include "Path.h"
+#include "Nav.h"
+#include "TimeSync.h"
+
+typedef struct {
+    uint8_t  dir;
+    uint8_t  speed;
+    uint32_t timeUs;
+} TeleopInput;
+
+/* written only by teleopCommand() in the main thread, read by the ticker */
+static LatestValue<TeleopInput> latest;
+
+static Ticker teleopTicker;
+static volatile bool active = false;
+static volatile int32_t latencyUs = -1;
+
+/* last input the ticker read in one piece */
+static TeleopInput current;
+
+/* wheel speeds for each MOVE_* direction as fractions of the speed, in
+   halves. Forward is negative, like in movement(). */
+static const int8_t wheelHalves[][2] = {
+    {  0,  0 },     /* MOVE_STOP */
+    {  2, -2 },     /* MOVE_LEFT */
+    { -1, -2 },     /* MOVE_FORWARD_LEFT */
+    { -2, -2 },     /* MOVE_FORWARD */
+    { -2, -1 },     /* MOVE_FORWARD_RIGHT */
+    { -2,  2 },     /* MOVE_RIGHT */
+    {  2,  1 },     /* MOVE_BACK_RIGHT */
+    {  2,  2 },     /* MOVE_BACK */
+    {  1,  2 },     /* MOVE_BACK_LEFT */
+};
+
+#define TELEOP_DIR_COUNT (int)(sizeof(wheelHalves) / sizeof(wheelHalves[0]))
+
+static void teleopTick()
+{
+    uint32_t seq;
+    TeleopInput in;
+
+    /* messageArrived() was interrupted halfway through a write. Keep the 
+       previous input, the new one is picked up next tick. */
+    if (latest.tryRead(&in, &seq)) {
+        current = in;
+    }
+
+    if (us_ticker_read() - current.timeUs > TELEOP_TIMEOUT_MS * 1000UL ||
+        current.dir == MOVE_STOP) {
+        /* motionCommand() already holds the wheels for one more period, 
+           then they ramp down on their own */
+        teleopTicker.detach();
+        active = false;
+        return;
+    }
+
+    /* hold for two periods so a late tick does not ramp the wheels down */
+    motionCommand(wheelHalves[current.dir][0] * current.speed / 2,
+                  wheelHalves[current.dir][1] * current.speed / 2,
+                  2 * TELEOP_PERIOD_MS);
+}
+
+void teleopCommand(int dir, int speed, uint64_t sentUs)
+{
+    TeleopInput in;
+
+    if (sentUs && timeIsSynced())
+        latencyUs = (int32_t)(timeNowUs() - sentUs);
+
+    if (dir < 0 || dir >= TELEOP_DIR_COUNT) {
+        return;
+    }
+    if (speed > 127) {
+        speed = 127;
+    }
+
+    in.dir = dir;
+    in.speed = speed;
+    in.timeUs = us_ticker_read();
+    latest.write(in);
+
+    /* the operator's stop stops whatever drives the wheels */
+    if (dir == MOVE_STOP) {
+        pathAbort();
+        navCancel();
+        motionStop();
+        return;
+    }
+
+    core_util_critical_section_enter();
+    bool start = !active;
+    active = true;
+    core_util_critical_section_exit();
+
+    /* teleop takes the wheels over from a path or a nav goal */
+    if (start) {
+        pathAbort();
+        navCancel();
+        current = in;
+        teleopTick();
+        teleopTicker.attach_us(callback(teleopTick), 
+                               TELEOP_PERIOD_MS * 1000UL);
+    }
+}
+
+bool teleopIsActive()
+{
+    return active;
+}
+
+int32_t teleopLatencyUs()
+{
+    return latencyUs;
+}
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Teleop.h
+ * @brief      Continuous direction control from a joystick or keyboard.
+ *
+ *             A FWD_TO_TELEOP message (see MQTTNetwork.h) sets the current
+ *             direction:
+ *
+ *                 [1] MOVE_* direction
+ *                 [2] speed (optional, defaults to CFG_MOVE_SPEED)
+ *                 [3-10] synchronized time it was sent in usec (optional, 
+ *                        see TimeSync.h), to measure the command latency
+ *
+ *             messageArrived() stores it in a LatestValue register instead of
+ *             a mailbox, so a burst of updates overwrites itself and the
+ *             robot always acts on the newest one. A Ticker reads the 
+ *             register every TELEOP_PERIOD_MS and drives the wheels. If no 
+ *             update arrives for TELEOP_TIMEOUT_MS, the ticker stops and the
+ *             wheels ramp down, so a lost connection cannot leave the robot
+ *             driving. Controllers should resend the direction while a key 
+ *             is held.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _TELEOP_H_
+#define _TELEOP_H_
+
+#include "mbed.h"
+
+#define TELEOP_PERIOD_MS        50
+#define TELEOP_TIMEOUT_MS       500
+
+/**
+ * @brief      Sets the current direction. Call from messageArrived(). 
+ *             Starting teleop, and MOVE_STOP, also abort a playing path and
+ *             cancel navigation, so nothing else drives the wheels.
+ *
+ * @param[in]  dir     A MOVE_* direction
+ * @param[in]  speed   The wheel speed (0 to 127)
+ * @param[in]  sentUs  Synchronized time the command was sent, 0 if unknown
+ */
+void teleopCommand(int dir, int speed, uint64_t sentUs);
+
+/**
+ * @brief      Returns the one-way latency of the last timestamped command in
+ *             usec, -1 if there was none or our clock is not synchronized.
+ */
+int32_t teleopLatencyUs();
+
+/**
+ * @brief      Returns true while teleop is driving the wheels.
+ */
+bool teleopIsActive();
+
+#endif /* _TELEOP_H_ */
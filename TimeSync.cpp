@@ -0,0 +1,269 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       TimeSync.cpp
+ * @brief      Implementation of the clock synchronization.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "TimeSync.h"
+
+#define TIME_MAX_TOPIC_LEN  64
+
+typedef struct {
+    uint64_t localUs;   /* t4 */
+    int64_t  offsetUs;
+    uint32_t delayUs;
+} TimeSample;
+
+static char responseTopic[TIME_MAX_TOPIC_LEN];
+static const char *ourId = "";
+
+static TimeSample samples[TIME_WINDOW];
+static int sampleCount = 0;
+
+/* extends us_ticker_read() to 64 bits */
+static uint32_t lastTicker = 0;
+static uint32_t tickerWraps = 0;
+
+/* The clock: synced = local + offset + (local - refLocal) * drift. Changed
+   from the MQTT thread, read from anywhere, so only in critical sections. */
+static volatile bool synced = false;
+static uint64_t refLocalUs = 0;
+static int64_t refOffsetUs = 0;
+static int32_t driftPpb = 0;
+static uint32_t errorUs = 0xFFFFFFFF;
+static uint64_t lastNowUs = 0;
+
+/* best sample of an earlier window, for the drift */
+static uint64_t driftLocalUs = 0;
+static int64_t driftOffsetUs = 0;
+static bool haveDriftRef = false;
+
+static void put64(char *buf, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        buf[i] = (v >> (8 * i)) & 0xFF;
+}
+
+static uint64_t get64(const uint8_t *buf)
+{
+    uint64_t v = 0;
+
+    for (int i = 7; i >= 0; i--)
+        v = (v << 8) | buf[i];
+    return v;
+}
+
+void timeInit(const char *clientId)
+{
+    ourId = clientId;
+    snprintf(responseTopic, sizeof(responseTopic), "%s%s", 
+             TIME_RESPONSE_TOPIC_PREFIX, clientId);
+}
+
+const char *timeResponseTopic()
+{
+    return responseTopic;
+}
+
+int timeRequestInterval()
+{
+    return sampleCount < TIME_WINDOW ? TIME_FAST_INTERVAL_MS 
+                                     : TIME_SLOW_INTERVAL_MS;
+}
+
+uint64_t timeLocalUs()
+{
+    uint64_t t;
+
+    core_util_critical_section_enter();
+    uint32_t now = us_ticker_read();
+    if (now < lastTicker)
+        tickerWraps++;
+    lastTicker = now;
+    t = ((uint64_t)tickerWraps << 32) | now;
+    core_util_critical_section_exit();
+
+    return t;
+}
+
+/* appends our client id at offset, returns the total length */
+static int putId(char *buf, int offset)
+{
+    int len = strlen(ourId);
+
+    if (len > TIME_MSG_MAX_SIZE - offset)
+        len = TIME_MSG_MAX_SIZE - offset;
+    memcpy(buf + offset, ourId, len);
+    return offset + len;
+}
+
+int timeFormatRequest(char *buf)
+{
+    put64(buf, timeLocalUs());
+    return putId(buf, 8);
+}
+
+/* Call inside a critical section */
+static uint64_t toSynced(uint64_t localUs)
+{
+    int64_t since = (int64_t)(localUs - refLocalUs);
+
+    return localUs + refOffsetUs + since * driftPpb / 1000000000LL;
+}
+
+void timeMessageArrived(MQTT::MessageData& md)
+{
+    MQTT::Message &message = md.message;
+    const uint8_t *b = (const uint8_t *)message.payload;
+    uint64_t t4 = timeLocalUs();
+    uint64_t t1, t2, t3;
+    TimeSample *s, *best;
+
+    if (message.payloadlen < TIME_RESPONSE_SIZE)
+        return;
+
+    t1 = get64(b);
+    t2 = get64(b + 8);
+    t3 = get64(b + 16);
+    if (t1 > t4 || t3 < t2)
+        return;
+
+    /* the oldest sample makes room */
+    s = &samples[sampleCount % TIME_WINDOW];
+    s->localUs = t4;
+    s->offsetUs = ((int64_t)(t2 - t1) + (int64_t)(t3 - t4)) / 2;
+    s->delayUs = (uint32_t)((t4 - t1) - (t3 - t2));
+    sampleCount++;
+
+    best = &samples[0];
+    for (int i = 1; i < TIME_WINDOW && i < sampleCount; i++) {
+        if (samples[i].delayUs < best->delayUs)
+            best = &samples[i];
+    }
+
+    /* drift from best samples far enough apart, smoothed since each one is
+       still off by up to half its delay. The first reference is the best of
+       a full window, a single sample can be off by a whole round trip. */
+    if (!haveDriftRef) {
+        if (sampleCount >= TIME_WINDOW) {
+            driftLocalUs = best->localUs;
+            driftOffsetUs = best->offsetUs;
+            haveDriftRef = true;
+        }
+    } else if (best->localUs - driftLocalUs >= TIME_DRIFT_MIN_MS * 1000ULL) {
+        int32_t measured = (int32_t)((best->offsetUs - driftOffsetUs) * 
+                                     1000000000LL / 
+                                     (int64_t)(best->localUs - driftLocalUs));
+        core_util_critical_section_enter();
+        driftPpb += (measured - driftPpb) / 4;
+        core_util_critical_section_exit();
+        driftLocalUs = best->localUs;
+        driftOffsetUs = best->offsetUs;
+    }
+
+    core_util_critical_section_enter();
+    refLocalUs = best->localUs;
+    refOffsetUs = best->offsetUs;
+    errorUs = best->delayUs / 2;
+    synced = true;
+    core_util_critical_section_exit();
+}
+
+int timeFormatStatus(char *buf, int32_t commandLatency)
+{
+    uint64_t local = timeLocalUs();
+    uint32_t err;
+    int32_t drift;
+
+    core_util_critical_section_enter();
+    put64(buf + 8, synced ? toSynced(local) : local);
+    err = errorUs;
+    drift = driftPpb;
+    core_util_critical_section_exit();
+
+    put64(buf, local);
+    for (int i = 0; i < 4; i++) {
+        buf[16 + i] = (err >> (8 * i)) & 0xFF;
+        buf[20 + i] = ((uint32_t)drift >> (8 * i)) & 0xFF;
+        buf[25 + i] = ((uint32_t)commandLatency >> (8 * i)) & 0xFF;
+    }
+    buf[24] = synced;
+
+    return putId(buf, 29);
+}
+
+bool timeIsSynced()
+{
+    return synced;
+}
+
+uint64_t timeNowUs()
+{
+    uint64_t local = timeLocalUs();
+    uint64_t now;
+
+    core_util_critical_section_enter();
+    now = synced ? toSynced(local) : local;
+    /* a new estimate may be behind the last one, hold still until then */
+    if (now < lastNowUs)
+        now = lastNowUs;
+    lastNowUs = now;
+    core_util_critical_section_exit();
+
+    return now;
+}
+
+uint64_t timeToSyncedUs(uint64_t localUs)
+{
+    uint64_t t;
+
+    core_util_critical_section_enter();
+    t = synced ? toSynced(localUs) : localUs;
+    core_util_critical_section_exit();
+
+    return t;
+}
+
+uint32_t timeErrorUs()
+{
+    return errorUs;
+}
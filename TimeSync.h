@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       TimeSync.h
+ * @brief      NTP-style clock synchronization over MQTT.
+ *
+ *             The robot publishes a request with its local time t1 to 
+ *             TIME_REQUEST_TOPIC. A time server (timeserver.py) answers on
+ *             the robot's own response topic with the time it received the
+ *             request (t2) and sent the answer (t3). With the local time t4
+ *             at which the answer arrived:
+ *
+ *                 offset = ((t2 - t1) + (t3 - t4)) / 2
+ *                 delay  = (t4 - t1) - (t3 - t2)
+ *
+ *             Like NTP, only the sample with the lowest delay among the last
+ *             TIME_WINDOW counts, since queueing in the broker and the 
+ *             ESP8266 only ever adds delay, and the error of a sample is at 
+ *             most half its delay. The offsets of those best samples, taken 
+ *             at least TIME_DRIFT_MIN_MS apart, give the drift of our crystal.
+ *             On a quiet local network, the best round trip is a few ms, 
+ *             which puts the error well under a millisecond once the drift 
+ *             has settled.
+ *
+ *             timeNowUs() is monotonic: when a new estimate would move the
+ *             clock back, it holds still until it catches up.
+ *
+ *             All times are in usec, little endian. Synchronized times count
+ *             from the Unix epoch.
+ *
+ *                 request   [0-7]    t1
+ *                           [8-]     client id, the answer goes to
+ *                                    TIME_RESPONSE_TOPIC_PREFIX<client id>
+ *                 response  [0-7]    t1 (echoed)
+ *                           [8-15]   t2
+ *                           [16-23]  t3
+ *                 status    [0-7]    local time
+ *                           [8-15]   synchronized time at that local time
+ *                           [16-19]  error bound
+ *                           [20-23]  drift in parts per billion (int32)
+ *                           [24]     1 once synchronized
+ *                           [25-28]  one-way latency of the last timestamped
+ *                                    command (int32), -1 if none
+ *                           [29-]    client id
+ *
+ *             The status lets tools convert any local timestamp, like the 
+ *             flight recorder's, to synchronized time.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _TIMESYNC_H_
+#define _TIMESYNC_H_
+
+#include "mbed.h"
+#include "MQTTClient.h"
+
+#define TIME_REQUEST_TOPIC          "m3pi-mqtt-ee250/time/request"
+#define TIME_RESPONSE_TOPIC_PREFIX  "m3pi-mqtt-ee250/time/"
+#define TIME_STATUS_TOPIC           "m3pi-mqtt-ee250/time/status"
+
+#define TIME_MSG_MAX_SIZE           48
+#define TIME_RESPONSE_SIZE          24
+
+/* requests go out quickly until the window is full, then slowly */
+#define TIME_FAST_INTERVAL_MS       250
+#define TIME_SLOW_INTERVAL_MS       4000
+#define TIME_WINDOW                 8
+#define TIME_DRIFT_MIN_MS           30000
+
+/**
+ * @brief      Sets up the response topic. Call it before subscribing.
+ *
+ * @param[in]  clientId  Our MQTT client id, to make the topic unique
+ */
+void timeInit(const char *clientId);
+
+/**
+ * @brief      Returns the topic to subscribe timeMessageArrived() to.
+ */
+const char *timeResponseTopic();
+
+/**
+ * @brief      Returns how long to wait before the next request.
+ */
+int timeRequestInterval();
+
+/**
+ * @brief      Fills in the next request.
+ *
+ * @param      buf   Buffer of at least TIME_MSG_MAX_SIZE bytes
+ *
+ * @return     Number of bytes written
+ */
+int timeFormatRequest(char *buf);
+
+/**
+ * @brief      MQTT callback for timeResponseTopic().
+ */
+void timeMessageArrived(MQTT::MessageData& md);
+
+/**
+ * @brief      Fills in the status for publishing.
+ *
+ * @param      buf             Buffer of at least TIME_MSG_MAX_SIZE bytes
+ * @param[in]  commandLatency  One-way latency of the last timestamped 
+ *                             command in usec, -1 if none
+ *
+ * @return     Number of bytes written
+ */
+int timeFormatStatus(char *buf, int32_t commandLatency);
+
+/**
+ * @brief      Returns the local time in usec since boot. Unlike us_ticker_read()
+ *             it does not wrap, as long as it is called at least every 
+ *             71 minutes (the main loop does). Safe to call from ISRs.
+ */
+uint64_t timeLocalUs();
+
+/**
+ * @brief      Returns true once a time server answered.
+ */
+bool timeIsSynced();
+
+/**
+ * @brief      Returns the synchronized time in usec since the Unix epoch, or
+ *             timeLocalUs() before the first answer. Never goes backwards.
+ */
+uint64_t timeNowUs();
+
+/**
+ * @brief      Converts a local time to synchronized time, e.g. to stamp an 
+ *             event that was recorded earlier. Not monotonic.
+ */
+uint64_t timeToSyncedUs(uint64_t localUs);
+
+/**
+ * @brief      Returns the error bound of timeNowUs() in usec.
+ */
+uint32_t timeErrorUs();
+
+#endif /* _TIMESYNC_H_ */
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Topology.cpp
+ * @brief      Compile time RAM check and boot report of the thread topology.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "Topology.h"
+
+MBED_STATIC_ASSERT(TOPOLOGY_RAM_BYTES <= TOPOLOGY_RAM_BUDGET,
+                   "Threads and mailboxes commit more RAM than "
+                   "TOPOLOGY_RAM_BUDGET, see Topology.h");
+
+/* Kept in the image so the committed RAM shows up at build time, e.g. with
+   `arm-none-eabi-nm -S` or in the map file next to the .bss of every worker. */
+extern const uint32_t topologyRamBytes;
+const uint32_t topologyRamBytes = TOPOLOGY_RAM_BYTES;
+
+#define TOPOLOGY_PRINT(name, type)                                  \
+    printf("  %-12s %6u %6u %6u\n", name, (unsigned)type::STACK_SIZE, \
+           (unsigned)type::QUEUE_DEPTH, (unsigned)sizeof(type));
+
+void topologyPrint()
+{
+    printf("Threads:       stack  depth  bytes\n");
+    WORKER_TOPOLOGY(TOPOLOGY_PRINT)
+    printf("  %d threads, %u of %u bytes committed\n", TOPOLOGY_THREAD_COUNT,
+           (unsigned)TOPOLOGY_RAM_BYTES, (unsigned)TOPOLOGY_RAM_BUDGET);
+}
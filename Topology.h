@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Topology.h
+ * @brief      Every thread, executor and mailbox in the application, in one
+ *             list.
+ *
+ *             All of them are statically allocated (see Worker.h), so the RAM
+ *             they commit is known at compile time. The build fails if it 
+ *             goes over TOPOLOGY_RAM_BUDGET. To add a worker, declare its type
+ *             in its header and add a line to WORKER_TOPOLOGY below. Workers
+ *             of normal priority run on the normal executor and do not need 
+ *             a stack of their own.
+ *
+ *             The main thread and the MQTT client are not part of this list.
+ *             Their stacks are set in mbed_app.json and by mbed OS.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _TOPOLOGY_H_
+#define _TOPOLOGY_H_
+
+#include "mbed.h"
+#include "rtos.h"
+#include "Worker.h"
+#include "LEDThread.h"
+#include "PrintThread.h"
+#include "Motion.h"
+#include "Boot.h"
+#include "Lcd.h"
+
+/* threads that do not have a mailbox of their own */
+typedef StaticThread<MOTION_THREAD_STACK_SIZE, osPriorityAboveNormal> 
+        MotionThreadType;
+typedef StaticThread<ROBOT_INIT_STACK_SIZE, osPriorityNormal> 
+        RobotInitThreadType;
+typedef StaticThread<LCD_THREAD_STACK_SIZE, osPriorityBelowNormal> 
+        LcdThreadType;
+
+/* One executor per priority level that has workers. It needs room on its 
+   queue for one event per worker plus their timer events, and a stack big 
+   enough for the hungriest handler (printf() and an MQTT publish). */
+#define NORMAL_EXECUTOR_EVENTS      8
+#define NORMAL_EXECUTOR_STACK_SIZE  2048
+typedef Executor<NORMAL_EXECUTOR_EVENTS, NORMAL_EXECUTOR_STACK_SIZE, 
+                 osPriorityNormal> NormalExecutor;
+
+/**
+ * X(name, type) for each thread, executor and worker in the application
+ */
+#define WORKER_TOPOLOGY(X)                  \
+    X("motion",     MotionThreadType)       \
+    X("robot init", RobotInitThreadType)    \
+    X("lcd",        LcdThreadType)          \
+    X("normal",     NormalExecutor)         \
+    X("print",      PrintWorker)            \
+    X("led",        LEDWorker)
+
+/* RAM that everything above may commit, in bytes, including stacks */
+#define TOPOLOGY_RAM_BUDGET     (12 * 1024)
+
+#define TOPOLOGY_SIZE_OF(name, type)    + sizeof(type)
+#define TOPOLOGY_COUNT_OF(name, type)   + (type::STACK_SIZE > 0)
+
+enum {
+    TOPOLOGY_THREAD_COUNT = 0 WORKER_TOPOLOGY(TOPOLOGY_COUNT_OF),
+    TOPOLOGY_RAM_BYTES = 0 WORKER_TOPOLOGY(TOPOLOGY_SIZE_OF)
+};
+
+/**
+ * @brief      Prints the stack size, mailbox depth and RAM of every thread in
+ *             the topology.
+ */
+void topologyPrint();
+
+#endif /* _TOPOLOGY_H_ */
@@ -0,0 +1,246 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       Worker.h
+ * @brief      Statically allocated threads, executors and event workers.
+ *
+ *             An executor is a thread that runs events from an EventQueue, 
+ *             one at a time and each to completion. All workers of the same
+ *             priority share one executor, and with it one stack, instead of
+ *             each having a thread of its own.
+ *
+ *             A worker is a mailbox of messages and a handler function. A 
+ *             put() message is handled by the worker's executor, in order. 
+ *             Handlers must not block: instead of waiting, they schedule the
+ *             rest of their work as a timer event on the executor's queue 
+ *             with call_in(). The message type and the mailbox depth are 
+ *             template parameters, so nothing is taken from the heap. Declare
+ *             executors and workers as globals and list their types in 
+ *             Topology.h so the RAM they commit is checked at compile time.
+ *
+ *             Example:
+ *             @code
+ *             typedef EventWorker<MailMsg, 16> BeepWorker;
+ *             static BeepWorker beepWorker;
+ *
+ *             static void handleBeep(MailMsg *msg) { ... }
+ *
+ *             beepWorker.start(normalExecutor.queue(), handleBeep);
+ *             @endcode
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _WORKER_H_
+#define _WORKER_H_
+
+#include "mbed.h"
+#include "rtos.h"
+#include "mbed_events.h"
+
+/**
+ * @brief      A thread with a statically allocated stack.
+ */
+template <uint32_t StackSize, osPriority Priority>
+class StaticThread {
+public:
+    enum {
+        STACK_SIZE  = StackSize,
+        QUEUE_DEPTH = 0
+    };
+
+    StaticThread() : _thread(Priority, StackSize, _stack) {
+        MBED_STATIC_ASSERT(StackSize % 8 == 0, 
+                           "Thread stack size must be a multiple of 8");
+        MBED_STATIC_ASSERT(StackSize >= 512, 
+                           "Thread stack size must be at least 512 bytes");
+    }
+
+    osStatus start(Callback<void()> task) {
+        return _thread.start(task);
+    }
+
+    Thread *thread() {
+        return &_thread;
+    }
+
+private:
+    MBED_ALIGN(8) unsigned char _stack[StackSize];
+    Thread _thread;
+};
+
+/**
+ * @brief      A statically allocated thread that runs the events of its own 
+ *             queue, with room for Events events at a time.
+ */
+template <uint32_t Events, uint32_t StackSize, osPriority Priority>
+class Executor {
+public:
+    enum {
+        STACK_SIZE  = StackSize,
+        QUEUE_DEPTH = Events
+    };
+
+    Executor() : _queue(sizeof(_buffer), _buffer) {
+    }
+
+    osStatus start() {
+        return _thread.start(callback(&_queue, &EventQueue::dispatch_forever));
+    }
+
+    EventQueue *queue() {
+        return &_queue;
+    }
+
+private:
+    unsigned char _buffer[Events * EVENTS_EVENT_SIZE];
+    EventQueue _queue;
+    StaticThread<StackSize, Priority> _thread;
+};
+
+/**
+ * @brief      A statically allocated mailbox whose messages are handled one 
+ *             at a time by an executor.
+ *
+ *             Only one event per worker is on the executor's queue at any 
+ *             time. It handles one message and posts itself again while there
+ *             are more, so workers sharing an executor take turns and a full
+ *             mailbox cannot fill up the executor's queue.
+ */
+template <typename Msg, uint32_t Depth>
+class EventWorker {
+public:
+    typedef Msg MessageType;
+    typedef void (*Handler)(Msg *msg);
+
+    enum {
+        STACK_SIZE  = 0,
+        QUEUE_DEPTH = Depth
+    };
+
+    EventWorker() : _queue(NULL), _handler(NULL), _head(0), _tail(0), 
+                    _posted(false), _handled(0) {
+        MBED_STATIC_ASSERT(Depth > 0, "Worker mailbox depth must be at least 1");
+    }
+
+    /**
+     * @brief      Starts handling messages, including the ones put before.
+     *
+     * @param      queue    The executor's queue (Executor::queue())
+     * @param[in]  handler  Called for every message on the executor. The 
+     *                      message is freed after it returns.
+     */
+    void start(EventQueue *queue, Handler handler) {
+        _handler = handler;
+        _queue = queue;
+        post();
+    }
+
+    /**
+     * @brief      Returns a message to fill in and put(), or NULL if the 
+     *             mailbox is full. Safe to call from an ISR.
+     */
+    Msg *alloc() {
+        return _pool.alloc();
+    }
+
+    /**
+     * @brief      Queues a message from alloc() for the handler. Safe to call
+     *             from an ISR.
+     */
+    osStatus put(Msg *msg) {
+        core_util_critical_section_enter();
+        /* cannot overrun, there are only Depth messages to put */
+        _ring[_tail % Depth] = msg;
+        _tail++;
+        core_util_critical_section_exit();
+        post();
+        return osOK;
+    }
+
+    /**
+     * @brief      Returns how many messages have been handled so far. Together
+     *             with a count of put()s, this gives the mailbox depth.
+     */
+    uint32_t handled() const {
+        return _handled;
+    }
+
+private:
+    /* posts the handling event, unless it is already on the queue */
+    void post() {
+        bool needed;
+
+        core_util_critical_section_enter();
+        needed = _queue && !_posted && _head != _tail;
+        _posted |= needed;
+        core_util_critical_section_exit();
+
+        /* A full executor queue would leave messages stranded. The next 
+           put() tries again. */
+        if (needed && _queue->call(this, &EventWorker::run) == 0)
+            _posted = false;
+    }
+
+    void run() {
+        Msg *msg;
+
+        core_util_critical_section_enter();
+        msg = _ring[_head % Depth];
+        _head++;
+        _posted = false;
+        core_util_critical_section_exit();
+
+        _handler(msg);
+        _pool.free(msg);
+        _handled++;
+        post();
+    }
+
+    EventQueue *_queue;
+    Handler _handler;
+    MemoryPool<Msg, Depth> _pool;
+    Msg *_ring[Depth];
+    uint32_t _head;
+    uint32_t _tail;
+    bool _posted;
+    volatile uint32_t _handled;
+};
+
+#endif /* _WORKER_H_ */
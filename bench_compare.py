@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Collect m3pi benchmark results and compare them across commits.
+
+Build and flash a benchmark build (see Bench.h):
+
+    mbed compile -DM3PI_BENCH -DMBED_HEAP_STATS_ENABLED=1
+
+then collect the results it prints at boot, either straight from the serial
+port or from a saved terminal log:
+
+    python3 bench_compare.py run --port /dev/ttyACM0
+    python3 bench_compare.py run --log term.log
+
+`run` compares the results against the last recorded commit and fails if a
+benchmark got slower by more than --threshold percent or allocates more.
+Add --record to append them to the history file under the current commit:
+
+    python3 bench_compare.py run --port /dev/ttyACM0 --record
+
+`show` prints the history of every benchmark.
+
+The benchmarks also build on the computer (see host/bench_host.cpp). They
+have no cycle counter, so compare them in ns and keep their own history:
+
+    ./host/bench_host > host.log
+    python3 bench_compare.py --history bench_history_host.json \
+        run --log host.log --metric ns --record
+"""
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+HISTORY = "bench_history.json"
+
+
+def parse(lines):
+    """Returns {name: {"cycles", "ns", "allocs"}} from 'bench:' lines."""
+    results = {}
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("bench:"):
+            continue
+        fields = line.split()[1:]
+        if fields == ["done"]:
+            break
+        if len(fields) != 4:
+            continue
+        name, cycles, ns, allocs = fields
+        try:
+            results[name] = {"cycles": int(cycles), "ns": int(ns),
+                             "allocs": float(allocs)}
+        except ValueError:
+            continue
+    return results
+
+
+def read_serial(port, baud):
+    import serial
+
+    lines = []
+    with serial.Serial(port, baud, timeout=30) as ser:
+        print("waiting for the benchmarks, reset the LPC1768...")
+        while True:
+            line = ser.readline().decode("ascii", "replace")
+            if not line:
+                break
+            lines.append(line)
+            if line.strip() == "bench: done":
+                break
+    return lines
+
+
+def load_history(path):
+    if not os.path.exists(path):
+        return []
+    with open(path) as f:
+        return json.load(f)
+
+
+def current_commit():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "--short", "HEAD"],
+                                       stderr=subprocess.DEVNULL,
+                                       universal_newlines=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def compare(results, baseline, threshold, metric):
+    """Prints a table against the baseline. Returns the number of
+    regressions."""
+    regressions = 0
+    print("%-20s %10s %10s %8s %8s" % ("benchmark", metric + "/op",
+                                       "baseline", "change", "allocs"))
+    for name in sorted(results):
+        r = results[name]
+        b = baseline["results"].get(name) if baseline else None
+        if b is None:
+            print("%-20s %10d %10s %8s %8.2f" % (name, r[metric], "-", "new",
+                                                 r["allocs"]))
+            continue
+        change = 100.0 * (r[metric] - b[metric]) / max(b[metric], 1)
+        flag = ""
+        if change > threshold or r["allocs"] > b["allocs"]:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-20s %10d %10d %+7.1f%% %8.2f%s" % (name, r[metric],
+                                                    b[metric], change,
+                                                    r["allocs"], flag))
+    return regressions
+
+
+def cmd_run(args):
+    if args.port:
+        lines = read_serial(args.port, args.baud)
+    else:
+        with open(args.log) as f:
+            lines = f.readlines()
+
+    results = parse(lines)
+    if not results:
+        print("no benchmark results found")
+        return 1
+
+    history = load_history(args.history)
+    baseline = None
+    for entry in reversed(history):
+        if args.baseline is None or entry["commit"] == args.baseline:
+            baseline = entry
+            break
+    if baseline:
+        print("baseline: %s" % baseline["commit"])
+
+    regressions = compare(results, baseline, args.threshold, args.metric)
+
+    if args.record:
+        history.append({"commit": current_commit(), "results": results})
+        with open(args.history, "w") as f:
+            json.dump(history, f, indent=2, sort_keys=True)
+        print("recorded as %s in %s" % (history[-1]["commit"], args.history))
+
+    if regressions:
+        print("%d benchmark(s) regressed by more than %.1f%%" %
+              (regressions, args.threshold))
+        return 1
+    return 0
+
+
+def cmd_show(args):
+    history = load_history(args.history)
+    names = sorted(set(n for e in history for n in e["results"]))
+    print("%-10s" % "commit" + "".join(" %18s" % n[:18] for n in names))
+    for e in history:
+        row = "%-10s" % e["commit"]
+        for n in names:
+            r = e["results"].get(n)
+            row += " %18s" % (r[args.metric] if r else "-")
+        print(row)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--history", default=HISTORY)
+    sub = parser.add_subparsers(dest="cmd")
+
+    p = sub.add_parser("run", help="collect results and compare them")
+    src = p.add_mutually_exclusive_group(required=True)
+    src.add_argument("--port", help="serial port of the LPC1768")
+    src.add_argument("--log", help="terminal log with the bench: lines")
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--baseline", help="commit to compare against "
+                   "(default: the last one recorded)")
+    p.add_argument("--threshold", type=float, default=5.0,
+                   help="allowed slowdown in percent (default: 5)")
+    p.add_argument("--metric", choices=("cycles", "ns"), default="cycles",
+                   help="what to compare (default: cycles, ns for host runs)")
+    p.add_argument("--record", action="store_true",
+                   help="append the results to the history file")
+
+    p = sub.add_parser("show", help="print the recorded history")
+    p.add_argument("--metric", choices=("cycles", "ns"), default="cycles")
+
+    args = parser.parse_args()
+    if args.cmd == "run":
+        return cmd_run(args)
+    elif args.cmd == "show":
+        return cmd_show(args)
+    parser.print_help()
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,600 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy 
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the 
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or 
+ * sell copies of the Software, and to permit persons to whom the Software is 
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice, 
+ *     this list of conditions and the following disclaimers in the 
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of 
+ *     Southern California, nor the names of its contributors may be used to 
+ *     endorse or promote products derived from this Software without specific 
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in 
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR 
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, 
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE 
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER 
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH 
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       m3pi_gateway.cpp
+ * @brief      Host-side teleop gateway for driving many robots at once.
+ *
+ * Keeps one connection to the broker and reads commands for any number of
+ * robots from stdin and/or UDP, one per line:
+ *
+ *     <robot> <direction> [speed]     direction: stop, left, fl, forward, fr,
+ *                                     right, br, back, bl or a MOVE_* number
+ *     <robot> raw <hex bytes>         any other message, e.g. "r1 raw 0101"
+ *
+ * <robot> is a name given on the command line (name=clientid), a client id
+ * or * for all robots. Every tick, each robot gets at most one teleop
+ * message with its newest direction (older ones are dropped, the robot only
+ * keeps the newest anyway) and one queued raw message. A held direction is
+ * resent every tick so the robot's deadman (TELEOP_TIMEOUT_MS) does not stop
+ * it. Teleop messages carry the wall clock time in bytes [3-10], so robots
+ * synchronized with timeserver.py report their command latency.
+ *
+ * Once a second it prints the messages and bytes published, the time from
+ * input to publish and the command latency the robots report.
+ *
+ * Build (needs libmosquitto, e.g. apt install libmosquitto-dev):
+ *
+ *     g++ -std=c++11 -O2 -o m3pi_gateway m3pi_gateway.cpp -lmosquitto -lpthread
+ *
+ * and drive two robots from the keyboard, or from anything that sends UDP:
+ *
+ *     ./m3pi_gateway --udp 9250 r1=192.168.1.23 r2=192.168.1.24
+ *     echo "r1 forward 30" | nc -u -q0 localhost 9250
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <csignal>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <mosquitto.h>
+
+/* must match MQTTNetwork.h, Teleop.h and TimeSync.h */
+#define FWD_TO_TELEOP           5
+#define MOVE_STOP               0
+#define MOVE_COUNT              9
+#define TELEOP_TIMEOUT_MS       500
+#define ROBOT_TOPIC_PREFIX      "m3pi-mqtt-ee250/robot/"
+#define TIME_STATUS_TOPIC       "m3pi-mqtt-ee250/time/status"
+#define TIME_STATUS_ID_OFFSET   29
+
+/* the robot drops anything longer (MAX_MAIL_MSG_DATA_SIZE) */
+#define MAX_MSG_SIZE            32
+/* raw messages queued per robot before new ones are dropped */
+#define MAX_RAW_QUEUED          16
+/* latency samples kept per stats period */
+#define MAX_SAMPLES             4096
+
+static const char *dirNames[MOVE_COUNT] = {
+    "stop", "left", "fl", "forward", "fr", "right", "br", "back", "bl"
+};
+
+static uint64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct Robot {
+    std::string name;
+    std::string topic;
+
+    /* newest teleop input, under mtx */
+    int dir;
+    int speed;
+    bool changed;
+    uint64_t inputUs;       /* oldest input not yet published */
+    std::deque<std::pair<std::vector<uint8_t>, uint64_t> > raw;
+
+    /* reported by the robot in its time status, under statsMtx */
+    int32_t latencyUs;
+
+    Robot() : dir(MOVE_STOP), speed(0), changed(false), inputUs(0),
+              latencyUs(-1) {}
+};
+
+static std::vector<Robot> robots;
+static std::map<std::string, size_t> robotIndex;   /* name and client id */
+static std::mutex mtx;
+
+static struct mosquitto *mosq;
+static int defaultSpeed = 25;
+static std::atomic<bool> running(true);
+
+/* statistics for the current period, under statsMtx */
+static std::mutex statsMtx;
+static uint64_t published, publishedBytes, dropped, badInput;
+static std::map<int, uint64_t> pendingMids;        /* mid -> input time */
+static std::map<int, uint64_t> earlyMids;          /* mid -> publish time */
+static std::vector<uint32_t> inputToPublishUs;
+
+static void addSample(uint64_t inputUs, uint64_t doneUs)
+{
+    if (inputToPublishUs.size() < MAX_SAMPLES)
+        inputToPublishUs.push_back((uint32_t)(doneUs - inputUs));
+}
+
+/* mosquitto calls this from its network thread once a QoS 0 message has
+   been written to the socket, which can be before publish() returns */
+static void onPublish(struct mosquitto *, void *, int mid)
+{
+    uint64_t now = nowUs();
+    std::lock_guard<std::mutex> lock(statsMtx);
+    std::map<int, uint64_t>::iterator it = pendingMids.find(mid);
+
+    if (it == pendingMids.end()) {
+        earlyMids[mid] = now;
+        return;
+    }
+    if (it->second)
+        addSample(it->second, now);
+    pendingMids.erase(it);
+}
+
+static void onMessage(struct mosquitto *, void *,
+                      const struct mosquitto_message *msg)
+{
+    const uint8_t *p = (const uint8_t *)msg->payload;
+    int32_t latency = 0;
+
+    if (msg->payloadlen <= TIME_STATUS_ID_OFFSET)
+        return;
+    for (int i = 3; i >= 0; i--)
+        latency = (int32_t)(((uint32_t)latency << 8) | p[25 + i]);
+    std::string id((const char *)p + TIME_STATUS_ID_OFFSET,
+                   msg->payloadlen - TIME_STATUS_ID_OFFSET);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    std::map<std::string, size_t>::iterator it = robotIndex.find(id);
+    if (it != robotIndex.end()) {
+        std::lock_guard<std::mutex> slock(statsMtx);
+        robots[it->second].latencyUs = latency;
+    }
+}
+
+static void onConnect(struct mosquitto *m, void *, int rc)
+{
+    if (rc != 0) {
+        fprintf(stderr, "connect failed: %s\n", mosquitto_connack_string(rc));
+        return;
+    }
+    fprintf(stderr, "connected\n");
+    mosquitto_subscribe(m, NULL, TIME_STATUS_TOPIC, 0);
+}
+
+static int parseDir(const std::string &s)
+{
+    for (int i = 0; i < MOVE_COUNT; i++) {
+        if (s == dirNames[i])
+            return i;
+    }
+    char *end;
+    long n = strtol(s.c_str(), &end, 0);
+    if (*end != '\0' || s.empty() || n < 0 || n >= MOVE_COUNT)
+        return -1;
+    return (int)n;
+}
+
+static bool parseHex(const std::string &s, std::vector<uint8_t> *out)
+{
+    if (s.size() % 2 || s.size() / 2 > MAX_MSG_SIZE)
+        return false;
+    for (size_t i = 0; i < s.size(); i += 2) {
+        char *end;
+        std::string byte = s.substr(i, 2);
+        long b = strtol(byte.c_str(), &end, 16);
+        if (*end != '\0')
+            return false;
+        out->push_back((uint8_t)b);
+    }
+    return !out->empty();
+}
+
+/* Applies one input line. Called from the input threads. */
+static bool handleLine(const std::string &line, uint64_t inputUs)
+{
+    std::istringstream in(line);
+    std::string who, what, arg;
+    std::vector<uint8_t> raw;
+    int dir = -1;
+    int speed = defaultSpeed;
+
+    if (!(in >> who >> what))
+        return line.find_first_not_of(" \t\r") == std::string::npos;
+    if (what == "raw") {
+        if (!(in >> arg) || !parseHex(arg, &raw))
+            return false;
+    } else {
+        if ((dir = parseDir(what)) < 0)
+            return false;
+        if (in >> speed && (speed < 0 || speed > 127))
+            return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t first = 0, last = robots.size();
+    if (who != "*") {
+        std::map<std::string, size_t>::iterator it = robotIndex.find(who);
+        if (it == robotIndex.end())
+            return false;
+        first = it->second;
+        last = first + 1;
+    }
+    for (size_t i = first; i < last; i++) {
+        Robot &r = robots[i];
+        if (!raw.empty()) {
+            if (r.raw.size() < MAX_RAW_QUEUED) {
+                r.raw.push_back(std::make_pair(raw, inputUs));
+            } else {
+                std::lock_guard<std::mutex> slock(statsMtx);
+                dropped++;
+            }
+            continue;
+        }
+        /* the input latency counts from the first input of a tick */
+        if (!r.changed)
+            r.inputUs = inputUs;
+        r.dir = dir;
+        r.speed = speed;
+        r.changed = true;
+    }
+    return true;
+}
+
+static void inputError(const std::string &line)
+{
+    std::lock_guard<std::mutex> lock(statsMtx);
+    badInput++;
+    fprintf(stderr, "bad input: %s\n", line.c_str());
+}
+
+static void tick();
+
+static void stdinReader(bool exitAtEof)
+{
+    std::string line;
+
+    while (running && std::getline(std::cin, line)) {
+        if (!handleLine(line, nowUs()))
+            inputError(line);
+    }
+    if (exitAtEof)
+        running = false;
+}
+
+static void onSignal(int)
+{
+    running = false;
+}
+
+/* Stops every robot right away instead of waiting for its deadman */
+static void stopAll()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < robots.size(); i++) {
+            robots[i].dir = MOVE_STOP;
+            robots[i].changed = true;
+            robots[i].inputUs = nowUs();
+            robots[i].raw.clear();
+        }
+    }
+    tick();
+}
+
+static void udpReader(int port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    char buf[1500];
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("udp");
+        running = false;
+        return;
+    }
+
+    while (running) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+            continue;
+        uint64_t t = nowUs();
+        std::istringstream in(std::string(buf, n));
+        std::string line;
+        /* a datagram can carry lines for several robots */
+        while (std::getline(in, line)) {
+            if (!handleLine(line, t))
+                inputError(line);
+        }
+    }
+    close(fd);
+}
+
+static void publish(const std::string &topic, const uint8_t *payload,
+                    int len, uint64_t inputUs)
+{
+    int mid;
+    int rc = mosquitto_publish(mosq, &mid, topic.c_str(), len, payload, 0,
+                               false);
+
+    std::lock_guard<std::mutex> lock(statsMtx);
+    if (rc != MOSQ_ERR_SUCCESS) {
+        dropped++;
+        return;
+    }
+    published++;
+    /* what the broker receives: fixed header, topic and payload */
+    publishedBytes += 2 + 2 + topic.size() + len;
+
+    /* inputUs is 0 for resent commands, which are not measured */
+    std::map<int, uint64_t>::iterator it = earlyMids.find(mid);
+    if (it == earlyMids.end()) {
+        pendingMids[mid] = inputUs;
+        return;
+    }
+    if (inputUs)
+        addSample(inputUs, it->second);
+    earlyMids.erase(it);
+}
+
+/* One tick: the newest teleop command and one raw message per robot */
+static void tick()
+{
+    struct Out {
+        size_t robot;
+        uint8_t payload[MAX_MSG_SIZE];
+        int len;
+        uint64_t inputUs;
+    };
+    std::vector<Out> out;
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < robots.size(); i++) {
+            Robot &r = robots[i];
+            /* a stop is sent once, the robot does not need it repeated */
+            if (r.changed || r.dir != MOVE_STOP) {
+                Out o;
+                o.robot = i;
+                o.payload[0] = FWD_TO_TELEOP;
+                o.payload[1] = r.dir;
+                o.payload[2] = r.speed;
+                o.len = 11;
+                o.inputUs = r.changed ? r.inputUs : 0;
+                out.push_back(o);
+                r.changed = false;
+            }
+            if (!r.raw.empty()) {
+                Out o;
+                o.robot = i;
+                o.len = r.raw.front().first.size();
+                memcpy(o.payload, &r.raw.front().first[0], o.len);
+                o.inputUs = r.raw.front().second;
+                out.push_back(o);
+                r.raw.pop_front();
+            }
+        }
+    }
+
+    /* stamped as late as possible, the robot measures from here */
+    for (size_t i = 0; i < out.size(); i++) {
+        Out &o = out[i];
+        if (o.payload[0] == FWD_TO_TELEOP && o.len == 11) {
+            uint64_t t = nowUs();
+            for (int b = 0; b < 8; b++)
+                o.payload[3 + b] = (t >> (8 * b)) & 0xFF;
+        }
+        publish(robots[o.robot].topic, o.payload, o.len, o.inputUs);
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t> &v, int p)
+{
+    if (v.empty())
+        return 0;
+    size_t k = (v.size() - 1) * p / 100;
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static void printStats(double seconds)
+{
+    std::vector<uint32_t> samples, robotLatency;
+    uint64_t msgs, bytes, drops, bad;
+
+    {
+        std::lock_guard<std::mutex> lock(statsMtx);
+        samples.swap(inputToPublishUs);
+        msgs = published;
+        bytes = publishedBytes;
+        drops = dropped;
+        bad = badInput;
+        published = publishedBytes = dropped = badInput = 0;
+        for (size_t i = 0; i < robots.size(); i++) {
+            if (robots[i].latencyUs >= 0)
+                robotLatency.push_back(robots[i].latencyUs);
+        }
+    }
+
+    uint32_t maxUs = samples.empty() ? 0 :
+                     *std::max_element(samples.begin(), samples.end());
+    uint32_t p50 = percentile(samples, 50);
+    uint32_t p99 = percentile(samples, 99);
+    printf("%6.0f msg/s %8.0f B/s  input->publish p50 %5.2f p99 %5.2f "
+           "max %5.2f ms", msgs / seconds, bytes / seconds, p50 / 1000.0,
+           p99 / 1000.0, maxUs / 1000.0);
+    if (!robotLatency.empty()) {
+        uint32_t rmax = *std::max_element(robotLatency.begin(),
+                                          robotLatency.end());
+        printf("  robot p50 %6.2f max %6.2f ms (%u)",
+               percentile(robotLatency, 50) / 1000.0, rmax / 1000.0,
+               (unsigned)robotLatency.size());
+    }
+    if (drops || bad)
+        printf("  dropped %llu bad %llu", (unsigned long long)drops,
+               (unsigned long long)bad);
+    printf("\n");
+    fflush(stdout);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [--host HOST] [--port PORT] [--rate HZ] [--speed N]\n"
+        "          [--udp PORT] [--no-stdin] [--quiet] robot...\n"
+        "\n"
+        "robot is name=clientid or just the client id (the robot's IP\n"
+        "address). See the top of m3pi_gateway.cpp for the input format.\n",
+        prog);
+}
+
+int main(int argc, char **argv)
+{
+    std::string host = "eclipse.usc.edu";
+    int port = 11000;
+    int rate = 20;
+    int udpPort = 0;
+    bool useStdin = true;
+    bool quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "--host" && hasValue) {
+            host = argv[++i];
+        } else if (a == "--port" && hasValue) {
+            port = atoi(argv[++i]);
+        } else if (a == "--rate" && hasValue) {
+            rate = atoi(argv[++i]);
+        } else if (a == "--speed" && hasValue) {
+            defaultSpeed = atoi(argv[++i]);
+        } else if (a == "--udp" && hasValue) {
+            udpPort = atoi(argv[++i]);
+        } else if (a == "--no-stdin") {
+            useStdin = false;
+        } else if (a == "--quiet") {
+            quiet = true;
+        } else if (a[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            Robot r;
+            size_t eq = a.find('=');
+            std::string id = eq == std::string::npos ? a : a.substr(eq + 1);
+            r.name = eq == std::string::npos ? a : a.substr(0, eq);
+            r.topic = ROBOT_TOPIC_PREFIX + id;
+            robotIndex[r.name] = robots.size();
+            robotIndex[id] = robots.size();
+            robots.push_back(r);
+        }
+    }
+    /* the robot stops if it does not hear from us for TELEOP_TIMEOUT_MS */
+    if (robots.empty() || rate < 1000 / TELEOP_TIMEOUT_MS || rate > 1000 ||
+        defaultSpeed < 0 || defaultSpeed > 127) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    mosquitto_lib_init();
+    mosq = mosquitto_new(NULL, true, NULL);
+    if (!mosq) {
+        fprintf(stderr, "mosquitto_new failed\n");
+        return 1;
+    }
+    mosquitto_connect_callback_set(mosq, onConnect);
+    mosquitto_publish_callback_set(mosq, onPublish);
+    mosquitto_message_callback_set(mosq, onMessage);
+    mosquitto_reconnect_delay_set(mosq, 1, 10, true);
+    int rc = mosquitto_connect(mosq, host.c_str(), port, 30);
+    if (rc != MOSQ_ERR_SUCCESS) {
+        fprintf(stderr, "%s:%d: %s\n", host.c_str(), port,
+                mosquitto_strerror(rc));
+        return 1;
+    }
+    mosquitto_loop_start(mosq);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    /* with only stdin, the end of the input ends the session */
+    if (useStdin)
+        std::thread(stdinReader, udpPort == 0).detach();
+    if (udpPort)
+        std::thread(udpReader, udpPort).detach();
+
+    /* ticks are scheduled from the start, so a slow tick does not shift the
+       ones after it */
+    std::chrono::microseconds period(1000000 / rate);
+    std::chrono::steady_clock::time_point next = 
+        std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastStats = next;
+    while (running) {
+        next += period;
+        std::this_thread::sleep_until(next);
+        tick();
+
+        std::chrono::steady_clock::time_point now = 
+            std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - lastStats).count();
+        if (elapsed >= 1.0) {
+            if (!quiet)
+                printStats(elapsed);
+            lastStats = now;
+        }
+    }
+
+    stopAll();
+    mosquitto_disconnect(mosq);
+    mosquitto_loop_stop(mosq, false);
+    mosquitto_destroy(mosq);
+    mosquitto_lib_cleanup();
+    return 0;
+}
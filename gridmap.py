@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Assemble the robots' occupancy grids from their diffs (see Grid.h).
+
+Show a robot's map in the terminal as it fills in:
+
+    python3 gridmap.py watch 192.168.1.23
+
+Save it as a PGM image (unknown gray, free white, occupied black) once the
+whole grid was refreshed at least once:
+
+    python3 gridmap.py save 192.168.1.23 map.pgm
+"""
+import argparse
+import struct
+import sys
+import time
+
+TOPIC_PREFIX = "m3pi-mqtt-ee250/grid/"
+SIZE = 64
+WORDS_PER_ROW = SIZE // 16
+WORDS = SIZE * WORDS_PER_ROW
+
+CHARS = " .o#"
+GRAYS = [128, 255, 64, 0]
+
+
+class Grid(object):
+    def __init__(self):
+        self.words = [0] * WORDS
+        self.seen = set()
+        self.sequence = None
+        self.lost = 0
+
+    def apply(self, payload):
+        sequence, n = struct.unpack("<HB", payload[:3])
+        if self.sequence is not None:
+            self.lost += (sequence - self.sequence - 1) & 0xFFFF
+        self.sequence = sequence
+        for i in range(n):
+            index, word = struct.unpack("<BI", payload[3 + 5 * i:8 + 5 * i])
+            self.words[index] = word
+            self.seen.add(index)
+
+    def cell(self, x, y):
+        word = self.words[y * WORDS_PER_ROW + x // 16]
+        return (word >> (2 * (x % 16))) & 3
+
+    def complete(self):
+        return len(self.seen) == WORDS
+
+
+def subscribe(args, on_grid):
+    import paho.mqtt.client as mqtt
+
+    grid = Grid()
+
+    def on_message(client, userdata, msg):
+        grid.apply(bytes(msg.payload))
+        on_grid(client, grid)
+
+    client = mqtt.Client()
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    client.subscribe(TOPIC_PREFIX + args.robot)
+    client.loop_forever()
+    return grid
+
+
+def cmd_watch(args):
+    last = [0]
+
+    def on_grid(client, grid):
+        if time.time() - last[0] < args.interval:
+            return
+        last[0] = time.time()
+        # y grows upwards, as in MotionPose
+        rows = ["".join(CHARS[grid.cell(x, y)] for x in range(SIZE))
+                for y in reversed(range(SIZE))]
+        print("\n".join(rows))
+        print("%d/%d words received, %d diffs lost" % (len(grid.seen), WORDS,
+                                                      grid.lost))
+
+    subscribe(args, on_grid)
+    return 0
+
+
+def cmd_save(args):
+    def on_grid(client, grid):
+        if grid.complete():
+            client.disconnect()
+
+    print("waiting for the whole grid of %s..." % args.robot)
+    grid = subscribe(args, on_grid)
+    with open(args.out, "wb") as f:
+        f.write(b"P5\n%d %d\n255\n" % (SIZE, SIZE))
+        f.write(bytes(GRAYS[grid.cell(x, y)] for y in reversed(range(SIZE))
+                      for x in range(SIZE)))
+    print("wrote %s" % args.out)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="eclipse.usc.edu")
+    parser.add_argument("--port", type=int, default=11000)
+    sub = parser.add_subparsers(dest="cmd")
+
+    p = sub.add_parser("watch", help="show a robot's map as it fills in")
+    p.add_argument("robot", help="client id of the robot (its IP address)")
+    p.add_argument("--interval", type=float, default=2.0,
+                   help="seconds between redraws (default: 2)")
+
+    p = sub.add_parser("save", help="save a robot's map as a PGM image")
+    p.add_argument("robot", help="client id of the robot (its IP address)")
+    p.add_argument("out")
+
+    args = parser.parse_args()
+    if args.cmd == "watch":
+        return cmd_watch(args)
+    elif args.cmd == "save":
+        return cmd_save(args)
+    parser.print_help()
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       HostDmaSerial.cpp
+ * @brief      DmaSerial for the host builds, without the DMA.
+ *
+ *             Same interface and receive ring as DmaSerial.cpp. write() hands
+ *             every byte to RawSerial::putc() (and so to hostSerialTxHook) 
+ *             right away, and getc() returns -1 instead of waiting when the
+ *             ring is empty.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "DmaSerial.h"
+
+DmaSerial *DmaSerial::_dma_owner = NULL;
+
+DmaSerial::DmaSerial(PinName tx, PinName rx, int baud) : _ser(tx, rx, baud),
+    _dma(false), _tx_buf(NULL), _tx_fill(0), _tx_fill_len(0), _tx_busy(false),
+    _tx_waiting(false), _tx_space(0), _rx_head(0), _rx_tail(0), _overruns(0),
+    _rx_ready(0)
+{
+    _ser.attach(callback(this, &DmaSerial::on_rx), SerialBase::RxIrq);
+}
+
+void DmaSerial::baud(int baud)
+{
+    _ser.baud(baud);
+}
+
+void DmaSerial::start_dma()
+{
+}
+
+void DmaSerial::dma_irq()
+{
+}
+
+void DmaSerial::write(const uint8_t *data, size_t len)
+{
+    while (len--)
+        _ser.putc(*data++);
+}
+
+void DmaSerial::flush()
+{
+}
+
+void DmaSerial::on_rx()
+{
+    while (_ser.readable()) {
+        uint8_t c = _ser.getc();
+        if (_rx_head - _rx_tail < DMA_SERIAL_RX_BUFFER_SIZE) {
+            _rx_buf[_rx_head & (DMA_SERIAL_RX_BUFFER_SIZE - 1)] = c;
+            _rx_head++;
+        } else {
+            _overruns++;
+        }
+    }
+}
+
+int DmaSerial::getc(uint32_t timeout_ms)
+{
+    int c;
+
+    (void)timeout_ms;
+    if (_rx_head == _rx_tail)
+        return -1;
+
+    c = _rx_buf[_rx_tail & (DMA_SERIAL_RX_BUFFER_SIZE - 1)];
+    _rx_tail++;
+    return c;
+}
+
+void DmaSerial::drain()
+{
+    _rx_tail = _rx_head;
+}
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       NetworkInterface.h
+ * @brief      Stand-in for the mbed network interface and TCP socket in the
+ *             host builds, so MQTTNetwork.h compiles. There is no network: 
+ *             connecting fails and nothing is sent or received.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _HOST_NETWORK_INTERFACE_H_
+#define _HOST_NETWORK_INTERFACE_H_
+
+#include "mbed.h"
+#include "rtos.h"
+
+#define NSAPI_ERROR_WOULD_BLOCK     -3001
+#define NSAPI_ERROR_NO_CONNECTION   -3004
+
+class NetworkInterface {
+};
+
+class TCPSocket {
+public:
+    void set_timeout(int timeout) { (void)timeout; }
+    int open(NetworkInterface *network) { 
+        (void)network; 
+        return NSAPI_ERROR_NO_CONNECTION; 
+    }
+    int connect(const char *host, uint16_t port) {
+        (void)host; (void)port;
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    int send(const void *data, unsigned size) {
+        (void)data; (void)size;
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    int recv(void *data, unsigned size) {
+        (void)data; (void)size;
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+    int close() { return 0; }
+};
+
+#endif /* _HOST_NETWORK_INTERFACE_H_ */
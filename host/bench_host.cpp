@@ -0,0 +1,282 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       bench_host.cpp
+ * @brief      The benchmarks of Bench.cpp that need no hardware, built for
+ *             the computer against the stand-in mbed OS in this directory.
+ *
+ *             Quicker to run than a bench build on the robot, and good for 
+ *             comparing two versions of the pure code: the m3pi motor 
+ *             encoding, the fixed-point conversions, the grid ray and the
+ *             worker and mailbox round trips (the last two measure the 
+ *             stand-ins as much as the firmware). messageArrived() pulls in 
+ *             the network stack and only runs on the robot.
+ *
+ *                 make -C host bench
+ *
+ *             prints the same lines as the robot, with 0 for the cycles 
+ *             since there is no DWT counter here:
+ *
+ *                 bench: <name> 0 <ns/op> <allocs/op>
+ *
+ *             Track them with bench_compare.py --metric ns and a history 
+ *             file of their own, e.g.
+ *
+ *                 ./host/bench_host > host.log
+ *                 python3 bench_compare.py --history bench_history_host.json \
+ *                     run --log host.log --metric ns --record
+ *
+ *             Allocations are counted by wrapping malloc() and operator new.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include <new>
+#include "mbed.h"
+#include "rtos.h"
+#include "mbed_events.h"
+#include "m3pi.h"
+#include "MailMsg.h"
+#include "Worker.h"
+#include "Range.h"
+#include "FixedPoint.h"
+#include "Grid.h"
+
+#define HOST_BENCH_ITERATIONS   100000
+#define HOST_BENCH_REPEATS      5
+
+typedef struct {
+    const char *name;
+    void (*run)();
+} BenchCase;
+
+static m3pi m3pi(p23, p9, p10, false);
+
+/* keeps the compiler from optimizing the benchmarked work away */
+static volatile uint32_t sink;
+static volatile float voltage = 0.5f;
+static volatile uint16_t rawRange = 32768;
+static volatile uint16_t angle = 12345;
+
+static uint32_t allocCount = 0;
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    allocCount++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    allocCount++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size)
+{
+    allocCount++;
+    return __real_realloc(p, size);
+}
+}
+
+void *operator new(size_t size)
+{
+    void *p = malloc(size);
+
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+static void benchEmpty()
+{
+}
+
+static unsigned char benchQueueBuffer[4 * EVENTS_EVENT_SIZE];
+static EventQueue benchQueue(sizeof(benchQueueBuffer), benchQueueBuffer);
+static EventWorker<MailMsg, 4> benchWorker;
+
+static void benchHandler(MailMsg *msg)
+{
+    (void)msg;
+}
+
+/* alloc/put/get/free of a mailbox in the same thread */
+static void benchMailbox()
+{
+    static Mail<MailMsg, 4> mailbox;
+    MailMsg *msg;
+    osEvent evt;
+
+    msg = mailbox.alloc();
+    msg->content[0] = 0;
+    msg->length = 1;
+    mailbox.put(msg);
+    evt = mailbox.get(0);
+    mailbox.free((MailMsg *)evt.value.p);
+}
+
+/* alloc/put of a worker's mailbox and the event that handles it */
+static void benchWorkerRoundtrip()
+{
+    MailMsg *msg = benchWorker.alloc();
+
+    msg->content[0] = 0;
+    msg->length = 1;
+    benchWorker.put(msg);
+    benchQueue.dispatch(0);
+}
+
+/* opcode and speed encoding of both motors, replayed instead of sent */
+static void benchMotor()
+{
+    m3pi.left_motor(-25);
+    m3pi.right_motor(25);
+}
+
+/* the distance conversion LEDThread used to do in double */
+static void benchDistanceDouble()
+{
+    double distance = voltage / 0.0098;
+    sink = (uint32_t)distance;
+}
+
+/* the same conversion with the range sensor's calibration table */
+static void benchDistance()
+{
+    sink = rangeRawToMm(rawRange);
+}
+
+static void benchSinCos()
+{
+    sink = sinQ15(angle) + cosQ15(angle);
+}
+
+/* the longest ray the grid takes, diagonal so both axes step */
+static void benchGridRay()
+{
+    static GridMap scratch;
+    MotionPose pose = { 0, 0, 8192, 0 };
+
+    gridRay(&scratch, &pose, GRID_MAX_RANGE_MM);
+}
+
+static const BenchCase benchCases[] = {
+    { "mailbox_roundtrip", benchMailbox },
+    { "worker_roundtrip", benchWorkerRoundtrip },
+    { "m3pi_motor", benchMotor },
+    { "distance_double", benchDistanceDouble },
+    { "distance_fixed", benchDistance },
+    { "sin_cos_q15", benchSinCos },
+    { "grid_ray", benchGridRay }
+};
+
+static uint64_t nowNs()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/**
+ * @brief      Returns the fewest ns per HOST_BENCH_ITERATIONS calls of run()
+ *             over HOST_BENCH_REPEATS repeats.
+ */
+static uint64_t benchNs(void (*run)(), uint32_t *allocs)
+{
+    uint64_t best = UINT64_MAX;
+    uint64_t start;
+    uint64_t ns;
+    uint32_t allocStart;
+
+    for (int r = 0; r < HOST_BENCH_REPEATS; r++) {
+        allocStart = allocCount;
+        start = nowNs();
+        for (int i = 0; i < HOST_BENCH_ITERATIONS; i++)
+            run();
+        ns = nowNs() - start;
+        *allocs = allocCount - allocStart;
+
+        if (ns < best)
+            best = ns;
+    }
+
+    return best;
+}
+
+int main()
+{
+    uint64_t overhead;
+    uint64_t ns;
+    uint32_t allocs;
+
+    m3pi.start_replay(NULL, 0);
+    benchWorker.start(&benchQueue, benchHandler);
+
+    overhead = benchNs(benchEmpty, &allocs);
+
+    printf("bench: %d iterations, %d repeats, host\n", HOST_BENCH_ITERATIONS,
+           HOST_BENCH_REPEATS);
+
+    for (size_t i = 0; i < sizeof(benchCases) / sizeof(benchCases[0]); i++) {
+        ns = benchNs(benchCases[i].run, &allocs);
+        ns = ns > overhead ? ns - overhead : 0;
+
+        /* allocs/op with two decimals */
+        allocs = (uint64_t)allocs * 100 / HOST_BENCH_ITERATIONS;
+        printf("bench: %s 0 %lu %lu.%02lu\n", benchCases[i].name,
+               (unsigned long)(ns / HOST_BENCH_ITERATIONS),
+               (unsigned long)(allocs / 100), (unsigned long)(allocs % 100));
+    }
+
+    m3pi.stop_replay();
+    printf("bench: done\n");
+    return 0;
+}
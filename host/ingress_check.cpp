@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       ingress_check.cpp
+ * @brief      Checks the ingress limits that must let whole bursts through,
+ *             built for the computer against the stand-in mbed OS.
+ *
+ *             A path upload is only usable if every one of its messages 
+ *             arrives, so a full upload sent back to back, followed by a 
+ *             PATH_PLAY, must be admitted. Messages past that are still 
+ *             limited.
+ *
+ *                 make -C host check
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include "mbed.h"
+#include "MQTTNetwork.h"
+#include "Ingress.h"
+#include "Path.h"
+
+/* the most PATH_UPLOAD messages a path takes */
+#define UPLOAD_MESSAGES ((PATH_MAX_SEGMENTS + PATH_UPLOAD_SEGMENTS - 1) / \
+                         PATH_UPLOAD_SEGMENTS)
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+    if (!ok)
+        failures++;
+}
+
+int main()
+{
+    int admitted = 0;
+
+    for (int i = 0; i < UPLOAD_MESSAGES; i++)
+        admitted += ingressAdmit(FWD_TO_PATH, PATH_UPLOAD);
+    expect(admitted == UPLOAD_MESSAGES, "a full path upload is admitted");
+    expect(ingressAdmit(FWD_TO_PATH, PATH_PLAY), 
+           "a PATH_PLAY right after the upload is admitted");
+    expect(!ingressAdmit(FWD_TO_PATH, PATH_UPLOAD),
+           "an upload message past the burst is dropped");
+
+    admitted = 0;
+    for (int i = 0; i < 2 * UPLOAD_MESSAGES; i++)
+        admitted += ingressAdmit(FWD_TO_LED_THR, 0);
+    expect(admitted < UPLOAD_MESSAGES, "other types keep their limits");
+
+    return failures ? 1 : 0;
+}
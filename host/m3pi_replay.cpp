@@ -0,0 +1,381 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       m3pi_replay.cpp
+ * @brief      Runs the m3pi driver on the computer against a recorded serial
+ *             log, and checks the commands it sends against a golden file.
+ *
+ *             The log is one recorded on the robot (see SerialLog.h and
+ *             m3pi_serial_log.py capture). For every command in it, the
+ *             harness calls the driver method that sends that command, e.g.
+ *             left_motor() for M2_FORWARD. The driver talks to a stand-in 
+ *             3pi on the host serial port, which answers each command with 
+ *             the bytes the real 3pi answered in the log, and answers the
+ *             driver's flow control signature requests itself.
+ *
+ *             The commands the driver sends are compared with the recording
+ *             and, if given, with a golden file, one command per line in 
+ *             hex, the same format as m3pi_serial_log.py check:
+ *
+ *                 make -C host replay
+ *                 ./host/m3pi_replay drive.log drive.golden --update
+ *                 ./host/m3pi_replay drive.log drive.golden
+ *
+ *             It exits with 1 if a command differs from the golden file, or
+ *             from the recording when there is no golden file. Use 
+ *             m3pi_serial_log.py stats for bytes per command and UART 
+ *             utilization of the log.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#include <string>
+#include <vector>
+#include "mbed.h"
+#include "m3pi.h"
+
+#define LOG_RX              0x80
+#define LOG_DELTA_EXTENDED  0x7F
+
+/* what the stand-in 3pi answers to the driver's sync() */
+#define REPLAY_SIGNATURE    "3pi1.1"
+
+typedef struct {
+    uint8_t op;
+    const char *name;
+    int args;       /* -1: the first argument byte is a length */
+    int response;
+} Opcode;
+
+static const Opcode opcodes[] = {
+    { SEND_SIGNATURE, "SEND_SIGNATURE", 0, 6 },
+    { SEND_RAW_SENSOR_VALUES, "SEND_RAW_SENSOR_VALUES", 0, 10 },
+    { SEND_TRIMPOT, "SEND_TRIMPOT", 0, 2 },
+    { SEND_BATTERY_MILLIVOLTS, "SEND_BATTERY_MILLIVOLTS", 0, 2 },
+    { PI_CALIBRATE, "PI_CALIBRATE", 0, 0 },
+    { LINE_SENSORS_RESET_CALIBRATION, "LINE_SENSORS_RESET_CALIBRATION", 0, 0 },
+    { SEND_LINE_POSITION, "SEND_LINE_POSITION", 0, 2 },
+    { DO_CLEAR, "DO_CLEAR", 0, 0 },
+    { DO_PRINT, "DO_PRINT", -1, 0 },
+    { DO_LCD_GOTO_XY, "DO_LCD_GOTO_XY", 2, 0 },
+    { AUTO_CALIBRATE, "AUTO_CALIBRATE", 0, 1 },
+    { SET_PID, "SET_PID", 5, 0 },
+    { STOP_PID, "STOP_PID", 0, 0 },
+    { SET_BAUD, "SET_BAUD", 1, 0 },
+    { M1_FORWARD, "M1_FORWARD", 1, 0 },
+    { M1_BACKWARD, "M1_BACKWARD", 1, 0 },
+    { M2_FORWARD, "M2_FORWARD", 1, 0 },
+    { M2_BACKWARD, "M2_BACKWARD", 1, 0 },
+    { SEND_M1_ENCODER_COUNT, "SEND_M1_ENCODER_COUNT", 0, 2 },
+    { SEND_M2_ENCODER_COUNT, "SEND_M2_ENCODER_COUNT", 0, 2 },
+    { SEND_M1_ENCODER_ERROR, "SEND_M1_ENCODER_ERROR", 0, 1 },
+    { SEND_M2_ENCODER_ERROR, "SEND_M2_ENCODER_ERROR", 0, 1 },
+    { DRIVE_STRAIGHT_DISTANCE, "DRIVE_STRAIGHT_DISTANCE", 3, 0 },
+    { ROTATE_DEGREES, "ROTATE_DEGREES", 3, 0 },
+    { DRIVE_STRAIGHT_DISTANCE_BLOCKING, "DRIVE_STRAIGHT_DISTANCE_BLOCKING", 3,
+      0 },
+    { ROTATE_DEGREES_BLOCKING, "ROTATE_DEGREES_BLOCKING", 3, 0 },
+};
+
+static const Opcode unknownOpcode = { 0, "UNKNOWN", 0, 0 };
+
+typedef struct {
+    std::vector<uint8_t> bytes;     /* opcode and arguments */
+    std::vector<uint8_t> response;
+} Command;
+
+static m3pi m3pi(p23, p9, p10, false);
+
+static std::vector<Command> recorded;
+
+/* the command the driver is sending, and the ones it sent */
+static std::vector<uint8_t> sending;
+static std::vector<Command> sent;
+
+static const Opcode *findOpcode(uint8_t op)
+{
+    for (size_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); i++) {
+        if (opcodes[i].op == op)
+            return &opcodes[i];
+    }
+    return &unknownOpcode;
+}
+
+/* bytes still missing from a command, 0 when it is complete */
+static int missing(const std::vector<uint8_t> &cmd)
+{
+    const Opcode *o = findOpcode(cmd[0]);
+    int args = o->args;
+
+    if (args < 0)
+        args = cmd.size() < 2 ? 1 : 1 + cmd[1];
+    return 1 + args - (int)cmd.size();
+}
+
+static std::string format(const std::vector<uint8_t> &cmd)
+{
+    std::string s;
+    char hex[4];
+
+    for (size_t i = 0; i < cmd.size(); i++) {
+        snprintf(hex, sizeof(hex), i ? " %02X" : "%02X", cmd[i]);
+        s += hex;
+    }
+    return s;
+}
+
+/**
+ * @brief      Splits a recorded log into commands with their responses, like
+ *             m3pi_serial_log.py does.
+ */
+static void parseLog(const std::vector<uint8_t> &log)
+{
+    std::vector<uint8_t> tx, rx;
+    size_t i = 0, r = 0;
+
+    while (i < log.size()) {
+        uint8_t tag = log[i++];
+        if ((tag & ~LOG_RX & 0xFF) == LOG_DELTA_EXTENDED)
+            i += 2;
+        if (i >= log.size())
+            break;
+        if (tag & LOG_RX)
+            rx.push_back(log[i++]);
+        else
+            tx.push_back(log[i++]);
+    }
+
+    i = 0;
+    while (i < tx.size()) {
+        Command c;
+        c.bytes.push_back(tx[i++]);
+        while (missing(c.bytes) > 0 && i < tx.size())
+            c.bytes.push_back(tx[i++]);
+        for (int n = findOpcode(c.bytes[0])->response; n > 0 && r < rx.size(); 
+             n--)
+            c.response.push_back(rx[r++]);
+        recorded.push_back(c);
+    }
+}
+
+/* the stand-in 3pi, gets every byte the driver writes */
+static void onDriverByte(uint8_t c)
+{
+    Command cmd;
+
+    sending.push_back(c);
+    if (missing(sending) > 0)
+        return;
+
+    cmd.bytes = sending;
+    sending.clear();
+
+    /* flow control from sync(), not a command, and never recorded */
+    if (cmd.bytes[0] == SEND_SIGNATURE && (sent.size() >= recorded.size() ||
+            recorded[sent.size()].bytes[0] != SEND_SIGNATURE)) {
+        hostSerialReceive((const uint8_t *)REPLAY_SIGNATURE, 
+                          strlen(REPLAY_SIGNATURE));
+        return;
+    }
+
+    /* answer as the 3pi did to the command recorded at this point */
+    if (sent.size() < recorded.size()) {
+        const std::vector<uint8_t> &resp = recorded[sent.size()].response;
+        if (!resp.empty())
+            hostSerialReceive(&resp[0], resp.size());
+    }
+    sent.push_back(cmd);
+}
+
+/**
+ * @brief      Calls the driver method that sends a recorded command.
+ *
+ * @return     false if no driver method sends it
+ */
+static bool drive(const Command &c)
+{
+    const std::vector<uint8_t> &b = c.bytes;
+    uint16_t values[5];
+    int arg[5] = { 0, 0, 0, 0, 0 };
+
+    for (size_t i = 1; i < b.size() && i <= 5; i++)
+        arg[i - 1] = b[i];
+
+    switch (b[0]) {
+        case M1_FORWARD:        m3pi.right_motor(arg[0]); break;
+        case M1_BACKWARD:       m3pi.right_motor(-arg[0]); break;
+        case M2_FORWARD:        m3pi.left_motor(arg[0]); break;
+        case M2_BACKWARD:       m3pi.left_motor(-arg[0]); break;
+        case SEND_BATTERY_MILLIVOLTS: m3pi.battery_millivolts(); break;
+        case SEND_LINE_POSITION: m3pi.line_position_q15(); break;
+        case SEND_RAW_SENSOR_VALUES: m3pi.raw_sensor_values(values); break;
+        case SEND_TRIMPOT:      m3pi.pot_voltage(); break;
+        case AUTO_CALIBRATE:    m3pi.sensor_auto_calibrate(); break;
+        case PI_CALIBRATE:      m3pi.calibrate(); break;
+        case LINE_SENSORS_RESET_CALIBRATION: m3pi.reset_calibration(); break;
+        case DO_CLEAR:          m3pi.cls(); break;
+        case DO_LCD_GOTO_XY:    m3pi.locate(arg[0], arg[1]); break;
+        case DO_PRINT:
+            m3pi.print((char *)&b[2], b.size() - 2);
+            break;
+        case SET_PID:
+            m3pi.PID_start(arg[0], arg[1], arg[2], arg[3], arg[4]);
+            break;
+        case STOP_PID:          m3pi.PID_stop(); break;
+        case SEND_M1_ENCODER_COUNT: m3pi.m1_encoder_count(); break;
+        case SEND_M2_ENCODER_COUNT: m3pi.m2_encoder_count(); break;
+        case SEND_M1_ENCODER_ERROR: m3pi.m1_encoder_error(); break;
+        case SEND_M2_ENCODER_ERROR: m3pi.m2_encoder_error(); break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> *out)
+{
+    FILE *f = fopen(path, "rb");
+    int c;
+
+    if (!f)
+        return false;
+    while ((c = fgetc(f)) != EOF)
+        out->push_back(c);
+    fclose(f);
+    return true;
+}
+
+/* one command per line, blank lines skipped */
+static std::vector<std::string> readGolden(const char *path)
+{
+    std::vector<std::string> lines;
+    char line[1024];
+    FILE *f = fopen(path, "r");
+
+    if (!f)
+        return lines;
+    while (fgets(line, sizeof(line), f)) {
+        std::string s(line);
+        while (!s.empty() && (s[s.size() - 1] == '\n' || 
+                              s[s.size() - 1] == '\r' ||
+                              s[s.size() - 1] == ' '))
+            s.erase(s.size() - 1);
+        if (!s.empty())
+            lines.push_back(s);
+    }
+    fclose(f);
+    return lines;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint8_t> log;
+    size_t diffs = 0;
+    int skipped = 0;
+    bool update = argc > 3 && strcmp(argv[3], "--update") == 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <log> [<golden> [--update]]\n", argv[0]);
+        return 2;
+    }
+    if (!readFile(argv[1], &log)) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 2;
+    }
+    parseLog(log);
+
+    hostSerialTxHook = onDriverByte;
+    for (size_t i = 0; i < recorded.size(); i++) {
+        if (!drive(recorded[i])) {
+            printf("command %u: no driver method sends %s\n", (unsigned)i,
+                   format(recorded[i].bytes).c_str());
+            skipped++;
+        }
+    }
+    hostSerialTxHook = NULL;
+    if (!sending.empty())
+        sent.push_back(Command());
+
+    /* against the recording */
+    for (size_t i = 0; i < recorded.size() || i < sent.size(); i++) {
+        std::string got = i < sent.size() ? format(sent[i].bytes) : "nothing";
+        std::string want = i < recorded.size() ? format(recorded[i].bytes) 
+                                               : "nothing";
+        if (got != want) {
+            if (diffs++ < 10)
+                printf("command %u: sent %s, recorded %s\n", (unsigned)i,
+                       got.c_str(), want.c_str());
+        }
+    }
+    printf("%u commands recorded, %u sent, %u differ, %u rx timeouts\n",
+           (unsigned)recorded.size(), (unsigned)sent.size(), (unsigned)diffs,
+           (unsigned)m3pi.rx_timeouts());
+
+    if (argc < 3)
+        return diffs || skipped ? 1 : 0;
+
+    if (update) {
+        FILE *f = fopen(argv[2], "w");
+        if (!f) {
+            fprintf(stderr, "cannot write %s\n", argv[2]);
+            return 2;
+        }
+        for (size_t i = 0; i < sent.size(); i++)
+            fprintf(f, "%s\n", format(sent[i].bytes).c_str());
+        fclose(f);
+        printf("wrote %u commands to %s\n", (unsigned)sent.size(), argv[2]);
+        return 0;
+    }
+
+    std::vector<std::string> golden = readGolden(argv[2]);
+    for (size_t i = 0; i < golden.size() && i < sent.size(); i++) {
+        if (format(sent[i].bytes) != golden[i]) {
+            printf("command %u differs: got %s, expected %s\n", (unsigned)i,
+                   format(sent[i].bytes).c_str(), golden[i].c_str());
+            return 1;
+        }
+    }
+    if (golden.size() != sent.size()) {
+        printf("got %u commands, expected %u\n", (unsigned)sent.size(),
+               (unsigned)golden.size());
+        return 1;
+    }
+    printf("%u commands match %s\n", (unsigned)sent.size(), argv[2]);
+    return 0;
+}
@@ -0,0 +1,276 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       mbed.h
+ * @brief      Stand-in for the parts of mbed OS that the host builds use.
+ *
+ *             Lets the firmware's pure code (the m3pi driver, FixedPoint,
+ *             Range, Grid, Ingress, the workers) compile and run on a
+ *             computer, single threaded. Peripherals do nothing, except the
+ *             serial port: bytes written to a RawSerial go to
+ *             hostSerialTxHook, and hostSerialReceive() plays the UART
+ *             receive interrupt. The ADC registers exist so Range.cpp
+ *             compiles, and read as zero.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _HOST_MBED_H_
+#define _HOST_MBED_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
+
+#define MBED_STATIC_ASSERT(expr, msg)   static_assert(expr, msg)
+#define MBED_ALIGN(n)                   alignas(n)
+
+typedef enum {
+    p5 = 5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17, p18,
+    p19, p20, p21, p22, p23, p24, p25, p26, p27, p28, p29, p30,
+    LED1, LED2, LED3, LED4, USBTX, USBRX,
+    NC = -1
+} PinName;
+
+/* microseconds since the first call */
+static inline uint32_t us_ticker_read()
+{
+    static struct timespec start;
+    struct timespec now;
+
+    if (start.tv_sec == 0 && start.tv_nsec == 0)
+        clock_gettime(CLOCK_MONOTONIC, &start);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((now.tv_sec - start.tv_sec) * 1000000 +
+                      (now.tv_nsec - start.tv_nsec) / 1000);
+}
+
+/* the host builds are single threaded */
+static inline void core_util_critical_section_enter() {}
+static inline void core_util_critical_section_exit() {}
+
+static inline void wait(float s) { (void)s; }
+static inline void wait_ms(int ms) { (void)ms; }
+static inline void wait_us(int us) { (void)us; }
+
+static inline uint32_t __CLZ(uint32_t x) { return x ? __builtin_clz(x) : 32; }
+
+static inline uint32_t __RBIT(uint32_t x)
+{
+    uint32_t r = 0;
+
+    for (int i = 0; i < 32; i++, x >>= 1)
+        r = (r << 1) | (x & 1);
+    return r;
+}
+
+template <typename F> class Callback;
+
+/* a function or an object and method, without allocating */
+template <typename R>
+class Callback<R()> {
+public:
+    Callback() : _obj(NULL), _thunk(NULL) {}
+
+    Callback(R (*fn)()) : _obj(NULL), _thunk(&Callback::fnThunk) {
+        memcpy(_method, &fn, sizeof(fn));
+    }
+
+    template <typename T, typename U>
+    Callback(U *obj, R (T::*method)()) 
+        : _obj(static_cast<T *>(obj)), _thunk(&Callback::methodThunk<T>) {
+        static_assert(sizeof(method) <= sizeof(_method), "method too big");
+        memcpy(_method, &method, sizeof(method));
+    }
+
+    R operator()() const { return _thunk(this); }
+    operator bool() const { return _thunk != NULL; }
+
+private:
+    static R fnThunk(const Callback *cb) {
+        R (*fn)();
+        memcpy(&fn, cb->_method, sizeof(fn));
+        return fn();
+    }
+
+    template <typename T>
+    static R methodThunk(const Callback *cb) {
+        R (T::*method)();
+        memcpy(&method, cb->_method, sizeof(method));
+        return (static_cast<T *>(cb->_obj)->*method)();
+    }
+
+    void *_obj;
+    R (*_thunk)(const Callback *);
+    unsigned char _method[2 * sizeof(void *)];
+};
+
+static inline Callback<void()> callback(void (*fn)())
+{
+    return Callback<void()>(fn);
+}
+
+template <typename T, typename U, typename R>
+Callback<R()> callback(U *obj, R (T::*method)())
+{
+    return Callback<R()>(obj, method);
+}
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin, int value = 0) : _value(value) { (void)pin; }
+    DigitalOut &operator=(int value) { _value = value; return *this; }
+    operator int() const { return _value; }
+private:
+    int _value;
+};
+
+class BusOut {
+public:
+    BusOut(PinName p0, PinName p1 = NC, PinName p2 = NC, PinName p3 = NC,
+           PinName p4 = NC, PinName p5 = NC, PinName p6 = NC,
+           PinName p7 = NC) : _value(0) {}
+    BusOut &operator=(int value) { _value = value; return *this; }
+private:
+    int _value;
+};
+
+class AnalogIn {
+public:
+    AnalogIn(PinName pin) { (void)pin; }
+    float read() { return 0.0f; }
+    uint16_t read_u16() { return 0; }
+};
+
+class Timer {
+public:
+    Timer() : _start(0), _running(false) {}
+    void start() { _start = us_ticker_read(); _running = true; }
+    void stop() { _running = false; }
+    void reset() { _start = us_ticker_read(); }
+    int read_us() { return _running ? us_ticker_read() - _start : 0; }
+    int read_ms() { return read_us() / 1000; }
+private:
+    uint32_t _start;
+    bool _running;
+};
+
+/* never fires, the host builds call the periodic work themselves */
+class Ticker {
+public:
+    void attach_us(Callback<void()> cb, uint32_t us) { (void)cb; (void)us; }
+    void detach() {}
+};
+
+class SerialBase {
+public:
+    enum IrqType { RxIrq, TxIrq };
+};
+
+/* set by a host build to see every byte written to a serial port */
+extern void (*hostSerialTxHook)(uint8_t c);
+
+class RawSerial : public SerialBase {
+public:
+    RawSerial(PinName tx, PinName rx, int baud = 9600) {
+        (void)tx; (void)rx; (void)baud;
+        _instance = this;
+    }
+    void baud(int baud) { (void)baud; }
+    int putc(int c) {
+        if (hostSerialTxHook)
+            hostSerialTxHook(c);
+        return c;
+    }
+    int getc() {
+        int c = _rx.front();
+        _rx.pop_front();
+        return c;
+    }
+    bool readable() { return !_rx.empty(); }
+    void attach(Callback<void()> cb, IrqType type = RxIrq) {
+        if (type == RxIrq)
+            _rxIrq = cb;
+    }
+
+    /* bytes arriving on the last port created, like its receive interrupt.
+       Use hostSerialReceive(). */
+    static void receive(const uint8_t *data, size_t len) {
+        if (!_instance)
+            return;
+        _instance->_rx.insert(_instance->_rx.end(), data, data + len);
+        if (_instance->_rxIrq)
+            _instance->_rxIrq();
+    }
+
+private:
+    std::deque<uint8_t> _rx;
+    Callback<void()> _rxIrq;
+    static RawSerial *_instance;
+};
+
+static inline void hostSerialReceive(const uint8_t *data, size_t len)
+{
+    RawSerial::receive(data, len);
+}
+
+class Stream {
+public:
+    Stream(const char *name = NULL) { (void)name; }
+    virtual ~Stream() {}
+protected:
+    virtual int _putc(int c) = 0;
+    virtual int _getc() = 0;
+};
+
+/* the ADC registers Range.cpp touches, as plain memory */
+typedef struct {
+    uint32_t ADCR, ADGDR, ADDR0, ADDR1, ADDR2, ADDR3, ADDR4, ADDR5, ADDR6,
+             ADDR7;
+} HostADC;
+
+extern HostADC hostADC;
+
+#define LPC_ADC         (&hostADC)
+
+#endif /* _HOST_MBED_H_ */
@@ -0,0 +1,152 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       mbed_events.h
+ * @brief      Stand-in for the mbed EventQueue in the host builds.
+ *
+ *             Holds as many events as the buffer it is given would on the
+ *             robot, so a full queue fails the same way. The slots are 
+ *             allocated up front, posting an event does not allocate. Nothing
+ *             runs until the host build calls dispatch().
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _HOST_MBED_EVENTS_H_
+#define _HOST_MBED_EVENTS_H_
+
+#include "mbed.h"
+#include <vector>
+
+/* about what an event with two pointers takes on the robot */
+#define EVENTS_EVENT_SIZE   32
+
+class EventQueue {
+public:
+    EventQueue(unsigned size = 32 * EVENTS_EVENT_SIZE, 
+               unsigned char *buffer = NULL) 
+        : _capacity(size / EVENTS_EVENT_SIZE), _nextId(1) {
+        (void)buffer;
+        _events.reserve(_capacity);
+    }
+
+    int call(void (*fn)()) {
+        return post(0, Callback<void()>(fn));
+    }
+
+    template <typename T, typename U>
+    int call(U *obj, void (T::*method)()) {
+        return post(0, Callback<void()>(obj, method));
+    }
+
+    int call_in(int ms, void (*fn)()) {
+        return post(ms, Callback<void()>(fn));
+    }
+
+    template <typename T, typename U>
+    int call_in(int ms, U *obj, void (T::*method)()) {
+        return post(ms, Callback<void()>(obj, method));
+    }
+
+    bool cancel(int id) {
+        for (size_t i = 0; i < _events.size(); i++) {
+            if (_events[i].id == id) {
+                _events.erase(_events.begin() + i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* runs every event that is due, including ones they post, for up to ms
+       (0 runs what is due now and returns) */
+    void dispatch(int ms = -1) {
+        uint32_t end = us_ticker_read() + (ms < 0 ? 0 : ms) * 1000;
+
+        do {
+            while (runDue())
+                ;
+        } while ((int32_t)(end - us_ticker_read()) > 0);
+    }
+
+    void dispatch_forever() {
+        while (!_events.empty())
+            runDue();
+    }
+
+private:
+    struct Event {
+        int id;
+        uint32_t dueUs;
+        Callback<void()> cb;
+    };
+
+    int post(int ms, const Callback<void()> &cb) {
+        Event e;
+
+        if (_events.size() >= _capacity)
+            return 0;
+        e.id = _nextId++;
+        e.dueUs = us_ticker_read() + ms * 1000;
+        e.cb = cb;
+        _events.push_back(e);
+        return e.id;
+    }
+
+    /* runs the first due event, in the order they were posted */
+    bool runDue() {
+        uint32_t now = us_ticker_read();
+
+        for (size_t i = 0; i < _events.size(); i++) {
+            if ((int32_t)(now - _events[i].dueUs) >= 0) {
+                Callback<void()> cb = _events[i].cb;
+                _events.erase(_events.begin() + i);
+                cb();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t _capacity;
+    int _nextId;
+    std::vector<Event> _events;
+};
+
+#endif /* _HOST_MBED_EVENTS_H_ */
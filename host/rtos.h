@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2017, Autonomous Networks Research Group. All rights reserved.
+ * Developed by:
+ * Autonomous Networks Research Group (ANRG)
+ * University of Southern California
+ * http://anrg.usc.edu/
+ *
+ * Contributors:
+ * Jason A. Tran <jasontra@usc.edu>
+ * Bhaskar Krishnamachari <bkrishna@usc.edu>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * with the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * - Redistributions of source code must retain the above copyright notice, this
+ *     list of conditions and the following disclaimers.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimers in the
+ *     documentation and/or other materials provided with the distribution.
+ * - Neither the names of Autonomous Networks Research Group, nor University of
+ *     Southern California, nor the names of its contributors may be used to
+ *     endorse or promote products derived from this Software without specific
+ *     prior written permission.
+ * - A citation to the Autonomous Networks Research Group must be included in
+ *     any publications benefiting from the use of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+ * THE SOFTWARE.
+ */
+
+/**
+ * @file       rtos.h
+ * @brief      Stand-in for the mbed RTOS in the host builds.
+ *
+ *             There is only one thread, so nothing ever waits: a Semaphore
+ *             without tokens and an empty Mail return right away, like a 
+ *             timeout. The pools and mailboxes are fixed size, so running 
+ *             out of them behaves as on the robot.
+ *
+ * @author     Jason Tran <jasontra@usc.edu>
+ * @author     Bhaskar Krishnachari <bkrishna@usc.edu>
+ */
+
+#ifndef _HOST_RTOS_H_
+#define _HOST_RTOS_H_
+
+#include "mbed.h"
+
+typedef int32_t osStatus;
+#define osOK                0
+#define osEventMail         0x20
+#define osEventTimeout      0x40
+#define osWaitForever       0xFFFFFFFFU
+
+typedef enum {
+    osPriorityIdle = -3,
+    osPriorityLow = -2,
+    osPriorityBelowNormal = -1,
+    osPriorityNormal = 0,
+    osPriorityAboveNormal = 1,
+    osPriorityHigh = 2,
+    osPriorityRealtime = 3
+} osPriority;
+
+typedef struct {
+    osStatus status;
+    union {
+        uint32_t v;
+        void *p;
+    } value;
+} osEvent;
+
+class Mutex {
+public:
+    osStatus lock(uint32_t ms = osWaitForever) { (void)ms; return osOK; }
+    bool trylock() { return true; }
+    osStatus unlock() { return osOK; }
+};
+
+class Semaphore {
+public:
+    Semaphore(int32_t count = 0) : _count(count) {}
+    int32_t wait(uint32_t ms = osWaitForever) {
+        (void)ms;
+        return _count > 0 ? _count-- : 0;
+    }
+    osStatus release() { _count++; return osOK; }
+private:
+    int32_t _count;
+};
+
+/* a thread that never runs, the host builds call the work themselves */
+class Thread {
+public:
+    Thread(osPriority priority = osPriorityNormal, uint32_t stack_size = 0,
+           unsigned char *stack_mem = NULL) {
+        (void)priority; (void)stack_size; (void)stack_mem;
+    }
+    osStatus start(Callback<void()> task) { (void)task; return osOK; }
+    static osStatus wait(uint32_t ms) { (void)ms; return osOK; }
+    static osStatus yield() { return osOK; }
+};
+
+template <typename T, uint32_t N>
+class MemoryPool {
+public:
+    MemoryPool() { memset(_used, 0, sizeof(_used)); }
+    T *alloc() {
+        for (uint32_t i = 0; i < N; i++) {
+            if (!_used[i]) {
+                _used[i] = true;
+                return &_items[i];
+            }
+        }
+        return NULL;
+    }
+    T *calloc() {
+        T *item = alloc();
+        if (item)
+            memset(item, 0, sizeof(T));
+        return item;
+    }
+    osStatus free(T *item) {
+        _used[item - _items] = false;
+        return osOK;
+    }
+private:
+    T _items[N];
+    bool _used[N];
+};
+
+template <typename T, uint32_t N>
+class Mail {
+public:
+    Mail() : _head(0), _tail(0) {}
+    T *alloc(uint32_t ms = 0) { (void)ms; return _pool.alloc(); }
+    T *calloc(uint32_t ms = 0) { (void)ms; return _pool.calloc(); }
+    osStatus put(T *mptr) {
+        _queue[_tail++ % N] = mptr;
+        return osOK;
+    }
+    osEvent get(uint32_t ms = osWaitForever) {
+        osEvent evt;
+
+        (void)ms;
+        if (_head == _tail) {
+            evt.status = osEventTimeout;
+            evt.value.p = NULL;
+        } else {
+            evt.status = osEventMail;
+            evt.value.p = _queue[_head++ % N];
+        }
+        return evt;
+    }
+    osStatus free(T *mptr) { return _pool.free(mptr); }
+private:
+    MemoryPool<T, N> _pool;
+    T *_queue[N];
+    uint32_t _head;
+    uint32_t _tail;
+};
+
+#endif /* _HOST_RTOS_H_ */
@@ -23,16 +23,16 @@
 
 #include "mbed.h"
 #include "m3pi.h"
+#include "FixedPoint.h"
 #include <stdio.h>
 #include <stdint.h>
 
-m3pi::m3pi(PinName nrst, PinName tx, PinName rx) :  Stream("m3pi"), _nrst(nrst), _ser(tx, rx)  {
-    _ser.baud(115200);
-    reset();
+m3pi::m3pi(PinName nrst, PinName tx, PinName rx, bool do_reset) :  Stream("m3pi"), _nrst(nrst), _ser(tx, rx, M3PI_BAUD), _mode(MODE_LIVE), _unacked(0), _rx_timeouts(0)  {
+    if (do_reset)
+        reset();
 }
 
-m3pi::m3pi() :  Stream("m3pi"), _nrst(p23), _ser(p13, p14)  {
-    _ser.baud(115200);
+m3pi::m3pi() :  Stream("m3pi"), _nrst(p23), _ser(p13, p14, M3PI_BAUD), _mode(MODE_LIVE), _unacked(0), _rx_timeouts(0)  {
     reset();
 }
 
@@ -41,6 +41,8 @@ void m3pi::reset () {
     wait (0.01);
     _nrst = 1;
     wait (0.1);
+    _ser.drain();
+    _unacked = 0;
 }
 
 void m3pi::left_motor (char speed) {
@@ -54,7 +56,6 @@ void m3pi::right_motor (char speed) {
 void m3pi::forward (char speed) {
     motor(1,speed);
     motor(0,speed);
-    printf("hello!");
 }
 
 void m3pi::forward (char speed, char scaling) {
@@ -95,60 +96,75 @@ void m3pi::motor (int motor, signed char speed) {
         else
             opcode = M2_BACKWARD;
     }
-    unsigned char arg = abs(speed);
-    _ser.putc(opcode);
-    _ser.putc(arg);
+    uint8_t cmd[2] = { (uint8_t)opcode, (uint8_t)abs(speed) };
+    _tx_buf(cmd, 2);
 }
 
 float m3pi::battery() {
-    _ser.putc(SEND_BATTERY_MILLIVOLTS);
-    char lowbyte = _ser.getc();
-    char hibyte  = _ser.getc();
-    float v = ((lowbyte + (hibyte << 8))/1000.0);
-    return(v);
+    return(battery_millivolts()/1000.0f);
+}
+
+uint16_t m3pi::battery_millivolts() {
+    _tx(SEND_BATTERY_MILLIVOLTS);
+    char lowbyte = _rx();
+    char hibyte  = _rx();
+    return((uint8_t)lowbyte | ((uint8_t)hibyte << 8));
 }
 
 float m3pi::line_position() {
+    return(line_position_q15()/32768.0f);
+}
+
+int16_t m3pi::line_position_q15() {
     int pos = 0;
-    _ser.putc(SEND_LINE_POSITION);
-    pos = _ser.getc();
-    pos += _ser.getc() << 8;
-    
-    float fpos = ((float)pos - 2048.0)/2048.0;
-    return(fpos);
+    _tx(SEND_LINE_POSITION);
+    pos = _rx();
+    pos += _rx() << 8;
+
+    /* 0 to 4000 from the 3pi, 2048 in the middle */
+    return(fix15Sat((pos - 2048) << 4));
+}
+
+void m3pi::raw_sensor_values(uint16_t values[5]) {
+    _tx(SEND_RAW_SENSOR_VALUES);
+    for (int i = 0; i < 5; i++) {
+        char lowbyte = _rx();
+        char hibyte  = _rx();
+        values[i] = (uint8_t)lowbyte | ((uint8_t)hibyte << 8);
+    }
 }
 
 char m3pi::sensor_auto_calibrate() {
-    _ser.putc(AUTO_CALIBRATE);
-    return(_ser.getc());
+    _tx(AUTO_CALIBRATE);
+    return(_rx());
 }
 
 
 void m3pi::calibrate(void) {
-    _ser.putc(PI_CALIBRATE);
+    _tx(PI_CALIBRATE);
 }
 
 void m3pi::reset_calibration() {
-    _ser.putc(LINE_SENSORS_RESET_CALIBRATION);
+    _tx(LINE_SENSORS_RESET_CALIBRATION);
 }
 
 void m3pi::PID_start(int max_speed, int a, int b, int c, int d) {
-    _ser.putc(max_speed);
-    _ser.putc(a);
-    _ser.putc(b);
-    _ser.putc(c);
-    _ser.putc(d);
+    _tx(max_speed);
+    _tx(a);
+    _tx(b);
+    _tx(c);
+    _tx(d);
 }
 
 void m3pi::PID_stop() {
-    _ser.putc(STOP_PID);
+    _tx(STOP_PID);
 }
 
 float m3pi::pot_voltage(void) {
     int volt = 0;
-    _ser.putc(SEND_TRIMPOT);
-    volt = _ser.getc();
-    volt += _ser.getc() << 8;
+    _tx(SEND_TRIMPOT);
+    volt = _rx();
+    volt += _rx() << 8;
     return(volt);
 }
 
@@ -161,94 +177,273 @@ void m3pi::leds(int val) {
 
 
 int m3pi::print (char* text, int length) {
-    _ser.putc(length);       
-    for (int i = 0 ; i < length ; i++) {
-        _ser.putc(text[i]); 
-    }
+    uint8_t cmd[2] = { DO_PRINT, (uint8_t)length };
+    _tx_buf(cmd, 2);
+    _tx_buf((const uint8_t *)text, length);
     return(0);
 }
 
+void m3pi::cls (void) {
+    _tx(DO_CLEAR);
+}
+
+void m3pi::locate (int x, int y) {
+    uint8_t cmd[3] = { DO_LCD_GOTO_XY, (uint8_t)x, (uint8_t)y };
+    _tx_buf(cmd, 3);
+}
+
 int m3pi::_putc (int c) {
-    _ser.putc(0x1);       
-    _ser.putc(c);         
-    wait (0.001);
+    uint8_t cmd[3] = { DO_PRINT, 1, (uint8_t)c };
+    _tx_buf(cmd, 3);
     return(c);
 }
 
+bool m3pi::sync(char *signature) {
+    char sig[M3PI_SIGNATURE_LEN + 1];
+    uint8_t cmd = SEND_SIGNATURE;
+    int c;
+
+    if (_mode == MODE_REPLAY)
+        return true;
+
+    /* this is flow control and not a command, so it is not recorded */
+    _ser.drain();
+    _ser.write(&cmd, 1);
+    for (int i = 0; i < M3PI_SIGNATURE_LEN; i++) {
+        if ((c = _ser.getc(M3PI_RX_TIMEOUT_MS)) < 0) {
+            _rx_timeouts++;
+            return false;
+        }
+        sig[i] = c;
+    }
+    sig[M3PI_SIGNATURE_LEN] = '\0';
+
+    _unacked = 0;
+    if (signature)
+        strcpy(signature, sig);
+    return true;
+}
+
+bool m3pi::set_baud(int baud) {
+    char sig[M3PI_SIGNATURE_LEN + 1];
+    uint8_t cmd[2] = { SET_BAUD, (uint8_t)(baud / 9600) };
+
+    if (_mode == MODE_REPLAY || baud == M3PI_BAUD)
+        return false;
+    if (!sync(sig) || strcmp(sig, M3PI_BAUD_SIGNATURE) != 0)
+        return false;
+
+    _ser.write(cmd, 2);
+    _ser.baud(baud);
+    if (sync())
+        return true;
+
+    /* the 3pi did not follow, go back to where it still is */
+    _ser.baud(M3PI_BAUD);
+    sync();
+    return false;
+}
+
 int m3pi::_getc (void) {
     char r = 0;
     return(r);
 }
 
 int m3pi::putc (int c) {
-    return(_ser.putc(c));
+    return(_tx(c));
 }
 
 int m3pi::getc (void) {
-    return(_ser.getc());
+    return(_rx());
+}
+
+void m3pi::start_recording(uint8_t *buf, size_t len) {
+    _log = buf;
+    _log_len = len;
+    _log_pos = 0;
+    _log_last = us_ticker_read();
+    _mode = MODE_RECORD;
+}
+
+size_t m3pi::stop_recording() {
+    _mode = MODE_LIVE;
+    return _log_pos;
+}
+
+void m3pi::start_replay(const uint8_t *log, size_t len) {
+    _replay = log;
+    _log_len = len;
+    _replay_tx = 0;
+    _replay_rx = 0;
+    _mismatches = 0;
+    _mode = MODE_REPLAY;
+}
+
+int m3pi::stop_replay() {
+    _mode = MODE_LIVE;
+    return _mismatches;
+}
+
+void m3pi::log_byte(int c, bool rx) {
+    uint32_t now = us_ticker_read();
+    uint32_t delta = (now - _log_last) / 10;
+    _log_last = now;
+
+    /* a full log just stops growing, the start of a session matters most */
+    if (_log_pos + 4 > _log_len)
+        return;
+
+    if (delta < LOG_DELTA_EXTENDED) {
+        _log[_log_pos++] = (rx ? LOG_RX : 0) | delta;
+    } else {
+        if (delta > 0xFFFF)
+            delta = 0xFFFF;
+        _log[_log_pos++] = (rx ? LOG_RX : 0) | LOG_DELTA_EXTENDED;
+        _log[_log_pos++] = delta & 0xFF;
+        _log[_log_pos++] = delta >> 8;
+    }
+    _log[_log_pos++] = c;
+}
+
+int m3pi::replay_next(size_t *pos, bool rx) {
+    uint8_t tag;
+    int c;
+
+    while (*pos < _log_len) {
+        tag = _replay[*pos];
+        if ((tag & ~LOG_RX) == LOG_DELTA_EXTENDED)
+            *pos += 3;
+        else
+            *pos += 1;
+        if (*pos >= _log_len)
+            break;
+        c = _replay[(*pos)++];
+        if (((tag & LOG_RX) != 0) == rx)
+            return c;
+    }
+
+    return -1;
+}
+
+int m3pi::_tx (int c) {
+    uint8_t b = c;
+    _tx_buf(&b, 1);
+    return c;
+}
+
+void m3pi::_tx_buf (const uint8_t *buf, int len) {
+    int i;
+
+    switch (_mode) {
+        case MODE_REPLAY:
+            /* nothing goes out on the wire, check it against the log instead */
+            for (i = 0; i < len; i++) {
+                if (replay_next(&_replay_tx, false) != buf[i])
+                    _mismatches++;
+            }
+            return;
+        case MODE_RECORD:
+            for (i = 0; i < len; i++)
+                log_byte(buf[i], false);
+            break;
+        default:
+            break;
+    }
+
+    /* let the 3pi catch up instead of overrunning its receive buffer */
+    if (_unacked + len > M3PI_PACE_BYTES)
+        sync();
+
+    _ser.write(buf, len);
+    _unacked += len;
+}
+
+int m3pi::_rx () {
+    int c;
+
+    if (_mode == MODE_REPLAY) {
+        c = replay_next(&_replay_rx, true);
+        if (c < 0) {
+            _mismatches++;
+            c = 0;
+        }
+        return c;
+    }
+
+    c = _ser.getc(M3PI_RX_TIMEOUT_MS);
+    if (c < 0) {
+        _rx_timeouts++;
+        c = 0;
+    } else {
+        /* a reply means the 3pi got through everything before it */
+        _unacked = 0;
+    }
+    if (_mode == MODE_RECORD)
+        log_byte(c, true);
+    return c;
 }
 
 int16_t m3pi::m1_encoder_count() {
     return 0; //cannot be used without encoders
-    _ser.putc(SEND_M1_ENCODER_COUNT);
-    char lowbyte = _ser.getc();
-    char hibyte  = _ser.getc();
+    _tx(SEND_M1_ENCODER_COUNT);
+    char lowbyte = _rx();
+    char hibyte  = _rx();
     int16_t left_cnt = lowbyte + (hibyte << 8);
     return(left_cnt);
 }
 
 int16_t m3pi::m2_encoder_count() {
     return 0; //cannot be used without encoders
-    _ser.putc(SEND_M2_ENCODER_COUNT);
-    char lowbyte = _ser.getc();
-    char hibyte  = _ser.getc();
+    _tx(SEND_M2_ENCODER_COUNT);
+    char lowbyte = _rx();
+    char hibyte  = _rx();
     int16_t right_cnt = lowbyte + (hibyte << 8);
     return(right_cnt);
 }
 
 char m3pi::m1_encoder_error() {
     return 0; //cannot be used without encoders
-    _ser.putc(SEND_M1_ENCODER_ERROR);
-    return(_ser.getc());
+    _tx(SEND_M1_ENCODER_ERROR);
+    return(_rx());
 }
 
 char m3pi::m2_encoder_error() {
     return 0; //cannot be used without encoders
-    _ser.putc(SEND_M2_ENCODER_ERROR);
-    return(_ser.getc());
+    _tx(SEND_M2_ENCODER_ERROR);
+    return(_rx());
 }
 
 void m3pi::rotate_degrees(unsigned char degrees, char direction, char speed) {
     return; //cannot be used without encoders
-    _ser.putc(ROTATE_DEGREES);
-    _ser.putc(degrees);
-    _ser.putc(direction); 
-    _ser.putc(speed);
+    _tx(ROTATE_DEGREES);
+    _tx(degrees);
+    _tx(direction); 
+    _tx(speed);
 }
 
 void m3pi::rotate_degrees_blocking(unsigned char degrees, char direction, char speed) {
     return; //cannot be used without encoders
-    _ser.putc(ROTATE_DEGREES);
-    _ser.putc(degrees);
-    _ser.putc(direction); 
-    _ser.putc(speed);
+    _tx(ROTATE_DEGREES);
+    _tx(degrees);
+    _tx(direction); 
+    _tx(speed);
 }
 
 
 void m3pi::move_straight_distance(char speed, uint16_t distance) {
     return; //cannot be used without encoders
-    _ser.putc(DRIVE_STRAIGHT_DISTANCE);
-    _ser.putc(speed);
-    _ser.putc((char)(distance & 0xFF));
-    _ser.putc((char)(distance >> 8));
+    _tx(DRIVE_STRAIGHT_DISTANCE);
+    _tx(speed);
+    _tx((char)(distance & 0xFF));
+    _tx((char)(distance >> 8));
 }
 
 void m3pi::move_straight_distance_blocking(char speed, uint16_t distance) {
     return; //cannot be used without encoders
-    _ser.putc(DRIVE_STRAIGHT_DISTANCE_BLOCKING);
-    _ser.putc(speed);
-    _ser.putc((char)(distance & 0xFF));
-    _ser.putc((char)(distance >> 8));
+    _tx(DRIVE_STRAIGHT_DISTANCE_BLOCKING);
+    _tx(speed);
+    _tx((char)(distance & 0xFF));
+    _tx((char)(distance >> 8));
 }
 
 
@@ -25,6 +25,7 @@
 
 #include "mbed.h"
 #include "platform.h"
+#include "DmaSerial.h"
 
 #ifdef MBED_RPC
 #include "rpc.h"
@@ -37,6 +38,9 @@
 #define PI_CALIBRATE 0xB4
 #define LINE_SENSORS_RESET_CALIBRATION 0xB5
 #define SEND_LINE_POSITION 0xB6
+#define DO_CLEAR 0xB7
+#define DO_PRINT 0xB8
+#define DO_LCD_GOTO_XY 0xB9
 #define AUTO_CALIBRATE 0xBA
 #define SET_PID 0xBB
 #define STOP_PID 0xBC
@@ -57,6 +61,34 @@
 #define DRIVE_STRAIGHT_DISTANCE_BLOCKING 0xE4
 #define ROTATE_DEGREES_BLOCKING 0xE5
 
+/* Not in the stock serial slave program. Takes one byte, the new baud rate
+   divided by 9600. Only sent to firmware that reports M3PI_BAUD_SIGNATURE. */
+#define SET_BAUD 0xBF
+
+#define M3PI_BAUD 115200
+#define M3PI_SIGNATURE_LEN 6
+#define M3PI_BAUD_SIGNATURE "3pi1.2"
+
+/* How long to wait for each byte of a reply from the 3pi */
+#define M3PI_RX_TIMEOUT_MS 100
+
+/* The serial slave program on the 3pi buffers about 100 received bytes and
+   drains them as fast as it can act on them, which is slow for LCD text. After
+   this many bytes without a reply, wait for the 3pi to answer a signature 
+   request before sending more. */
+#define M3PI_PACE_BYTES 48
+
+/* The longest reply the driver reads (raw_sensor_values()) */
+#define M3PI_MAX_REPLY 10
+
+/* How long a sync(), or one call, can keep the UART busy when the 3pi stops
+   answering: every byte of the reply waits up to M3PI_RX_TIMEOUT_MS, and a
+   call may have to sync() first. Anyone waiting for the m3pi waits this 
+   long. With the 3pi answering it is a few msec. */
+#define M3PI_SYNC_MAX_MS (M3PI_SIGNATURE_LEN * M3PI_RX_TIMEOUT_MS)
+#define M3PI_CALL_MAX_MS (M3PI_SYNC_MAX_MS + \
+                          M3PI_MAX_REPLY * M3PI_RX_TIMEOUT_MS)
+
 #define MIN_SPEED 0
 #define MAX_SPEED 127
 #define MAX_REVERSE -127
@@ -107,8 +139,10 @@ public:
 
     /** Create the m3pi object connected to specific pins
      *
+     * @param do_reset Reset the 3pi right away. Pass false to call reset() 
+     *                 later, e.g. from a thread, so construction does not block.
      */
-    m3pi(PinName nrst, PinName tx, PinName rx);
+    m3pi(PinName nrst, PinName tx, PinName rx, bool do_reset = true);
 
 
 
@@ -169,6 +203,11 @@ public:
      */
     float battery(void);
 
+    /** Read the battery voltage on the 3pi without floating point math
+     * @returns battery voltage in millivolts
+     */
+    uint16_t battery_millivolts(void);
+
     /** Read the position of the detected line
      * @returns position as A normalised number -1.0 - 1.0 represents the full range.
      *  -1.0 means line is on the left, or the line has been lost
@@ -177,6 +216,17 @@ public:
      */
     float line_position (void);
 
+    /** Read the position of the detected line without floating point math
+     * @returns position in Q15 (see FixedPoint.h), -32768 to 32767 with the 
+     *  same meaning as line_position()
+     */
+    int16_t line_position_q15 (void);
+
+    /** Read the five reflectance sensors without the 3pi's calibration
+     * @param values Receives the readings, 0 (bright) to 2000 (dark)
+     */
+    void raw_sensor_values (uint16_t values[5]);
+
 
     /** Calibrate the sensors. This turns the robot left then right, looking for a line
      *
@@ -213,12 +263,40 @@ public:
      */
     int getc();
 
-    /** Send a string buffer to the 3pi serial interface
+    /** Wait until the 3pi has acted on everything sent so far. It answers
+     * the signature request only once it got through the bytes before it.
+     *
+     * @param signature If not NULL, receives the signature, e.g. "3pi1.1",
+     *                  M3PI_SIGNATURE_LEN characters and a '\0'
+     * @returns true if the 3pi answered
+     */
+    bool sync(char *signature = NULL);
+
+    /** Switch the link to a faster baud rate, if the 3pi firmware supports 
+     * it (see SET_BAUD). The stock serial slave program does not, and the
+     * link then stays at M3PI_BAUD.
+     *
+     * @param baud The new baud rate, a multiple of 9600
+     * @returns true if the link now runs at baud
+     */
+    bool set_baud(int baud);
+
+    /** Print a string on the LCD at the cursor
      * @param text A pointer to a char array
-     * @param int The character to send to the 3pi
+     * @param length The number of characters to print
      */
     int print(char* text, int length);
 
+    /** Clear the LCD and move the cursor to the top left
+     */
+    void cls(void);
+
+    /** Move the LCD cursor
+     * @param x Column, 0 - 7
+     * @param y Row, 0 or 1
+     */
+    void locate(int x, int y);
+
     /** EE250L: YOU CANNOT USE THE FUCNCTIONS BELOW WITHOUT THE SPECIAL ENCODER
      *  INSTALLED. PLEASE SEE US IF YOU ARE INTERESTED.
      */
@@ -251,19 +329,79 @@ public:
 
     void move_straight_distance_blocking(char speed, uint16_t distance);
 
+    /** Start recording every byte sent to and received from the 3pi
+     *
+     * Each byte is logged as a tag byte followed by the data byte. Bit 7 of 
+     * the tag is set for received bytes, bits 0-6 are the time since the 
+     * previous byte in 10 usec units. A value of 0x7F means the time follows
+     * as a little endian uint16 instead. Recording stops growing when buf 
+     * is full.
+     *
+     * @param buf A buffer to record into
+     * @param len The size of buf
+     */
+    void start_recording(uint8_t *buf, size_t len);
+
+    /** Stop recording
+     * @returns The number of bytes recorded
+     */
+    size_t stop_recording();
+
+    /** Replay a recording instead of talking to the 3pi
+     *
+     * Received bytes are taken from the log in order. Sent bytes are not 
+     * transmitted, but checked against the bytes sent in the log. This lets 
+     * you run the driver without a robot attached.
+     *
+     * @param log A log made by start_recording()
+     * @param len The length of the log
+     */
+    void start_replay(const uint8_t *log, size_t len);
+
+    /** Stop replaying and go back to the real 3pi
+     * @returns The number of bytes that did not match the log
+     */
+    int stop_replay();
+
+    /** How many bytes the 3pi did not send in time. Each one was read as 0.
+     */
+    uint32_t rx_timeouts() const { return _rx_timeouts; }
+
 #ifdef MBED_RPC
     virtual const struct rpc_method *get_rpc_methods();
 #endif
 
 private :
 
+    enum { MODE_LIVE, MODE_RECORD, MODE_REPLAY };
+    enum { LOG_RX = 0x80, LOG_DELTA_EXTENDED = 0x7F };
+
     DigitalOut _nrst;
-    Serial _ser;
+    DmaSerial _ser;
+
+    int _mode;
+    uint8_t *_log;
+    const uint8_t *_replay;
+    size_t _log_len;
+    size_t _log_pos;
+    size_t _replay_tx;
+    size_t _replay_rx;
+    uint32_t _log_last;
+    int _mismatches;
+    int _unacked;
+    uint32_t _rx_timeouts;
     
     void motor (int motor, signed char speed);
     virtual int _putc(int c);
     virtual int _getc();
 
+    /* every byte to or from the 3pi goes through these two */
+    int _tx(int c);
+    void _tx_buf(const uint8_t *buf, int len);
+    int _rx();
+    void log_byte(int c, bool rx);
+    int replay_next(size_t *pos, bool rx);
+
 };
 
 #endif
\ No newline at end of file
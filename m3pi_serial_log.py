@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""Collect and analyze m3pi serial logs (see SerialLog.h and m3pi.h).
+
+    # record on the robot, then collect the log it publishes
+    python3 m3pi_serial_log.py capture -o drive.log
+    echo -ne "\\x03\\x00" | mosquitto_pub -h eclipse.usc.edu -p 11000 -t "m3pi-mqtt-ee250" -s
+    ... drive the robot ...
+    echo -ne "\\x03\\x01" | mosquitto_pub -h eclipse.usc.edu -p 11000 -t "m3pi-mqtt-ee250" -s
+
+    # bytes per command and UART utilization
+    python3 m3pi_serial_log.py stats drive.log
+
+    # compare the command stream against a golden file (--update to create it)
+    python3 m3pi_serial_log.py check drive.log drive.golden
+
+To check a driver change without a robot, send SERIAL_LOG_REPLAY (\\x03\\x02),
+run the same actions, then SERIAL_LOG_REPLAY_STOP (\\x03\\x03). The driver
+answers from the recorded log and `capture` prints how many bytes it sent
+that did not match.
+
+To check the driver itself against a log, on the computer and without a
+robot, build host/m3pi_replay.cpp: it calls the driver for every recorded
+command, answers with the recorded responses and compares what the driver
+sends with the log or with a golden file written by `check --update`.
+
+    make -C host replay
+    ./host/m3pi_replay drive.log drive.golden
+"""
+import argparse
+import struct
+import sys
+
+LOG_RX = 0x80
+LOG_DELTA_EXTENDED = 0x7F
+
+# opcode: (name, argument bytes, response bytes). None means the first
+# argument byte is a length and that many bytes follow it.
+OPCODES = {
+    0x81: ("SEND_SIGNATURE", 0, 6),
+    0x86: ("SEND_RAW_SENSOR_VALUES", 0, 10),
+    0x87: ("SEND_CALIBRATED_SENSOR_VALUES", 0, 10),
+    0xB0: ("SEND_TRIMPOT", 0, 2),
+    0xB1: ("SEND_BATTERY_MILLIVOLTS", 0, 2),
+    0xB4: ("PI_CALIBRATE", 0, 0),
+    0xB5: ("LINE_SENSORS_RESET_CALIBRATION", 0, 0),
+    0xB6: ("SEND_LINE_POSITION", 0, 2),
+    0xB7: ("DO_CLEAR", 0, 0),
+    0xB8: ("DO_PRINT", None, 0),
+    0xB9: ("DO_LCD_GOTO_XY", 2, 0),
+    0xBA: ("AUTO_CALIBRATE", 0, 1),
+    0xBB: ("SET_PID", 5, 0),
+    0xBC: ("STOP_PID", 0, 0),
+    0xBF: ("SET_BAUD", 1, 0),
+    0xC1: ("M1_FORWARD", 1, 0),
+    0xC2: ("M1_BACKWARD", 1, 0),
+    0xC5: ("M2_FORWARD", 1, 0),
+    0xC6: ("M2_BACKWARD", 1, 0),
+    0xD1: ("SEND_M1_ENCODER_COUNT", 0, 2),
+    0xD2: ("SEND_M2_ENCODER_COUNT", 0, 2),
+    0xD3: ("SEND_M1_ENCODER_ERROR", 0, 1),
+    0xD4: ("SEND_M2_ENCODER_ERROR", 0, 1),
+    0xE2: ("DRIVE_STRAIGHT_DISTANCE", 3, 0),
+    0xE3: ("ROTATE_DEGREES", 3, 0),
+    0xE4: ("DRIVE_STRAIGHT_DISTANCE_BLOCKING", 3, 0),
+    0xE5: ("ROTATE_DEGREES_BLOCKING", 3, 0),
+}
+
+
+def decode(log):
+    """Returns a list of (time_us, is_rx, byte) from a raw log."""
+    out = []
+    t = 0
+    i = 0
+    while i < len(log):
+        tag = log[i]
+        i += 1
+        delta = tag & ~LOG_RX & 0xFF
+        if delta == LOG_DELTA_EXTENDED:
+            if i + 2 > len(log):
+                break
+            delta = log[i] | (log[i + 1] << 8)
+            i += 2
+        if i >= len(log):
+            break
+        t += delta * 10
+        out.append((t, bool(tag & LOG_RX), log[i]))
+        i += 1
+    return out
+
+
+def commands(entries):
+    """Groups the sent bytes into commands. Returns a list of dicts."""
+    tx = [(t, b) for (t, rx, b) in entries if not rx]
+    rx = [(t, b) for (t, is_rx, b) in entries if is_rx]
+    cmds = []
+    i = 0
+    r = 0
+    while i < len(tx):
+        t, op = tx[i]
+        name, nargs, nresp = OPCODES.get(op, ("UNKNOWN", 0, 0))
+        i += 1
+        if nargs is None:
+            nargs = 1 + (tx[i][1] if i < len(tx) else 0)
+        args = [b for (_, b) in tx[i:i + nargs]]
+        i += nargs
+        resp = [b for (_, b) in rx[r:r + nresp]]
+        r += nresp
+        cmds.append({"time": t, "op": op, "name": name, "args": args,
+                     "resp": resp})
+    return cmds
+
+
+def read_log(path):
+    with open(path, "rb") as f:
+        return bytearray(f.read())
+
+
+def cmd_stats(args):
+    entries = decode(read_log(args.log))
+    if not entries:
+        print("empty log")
+        return 1
+    cmds = commands(entries)
+    duration = max(entries[-1][0], 1)
+    tx_bytes = sum(1 for e in entries if not e[1])
+    rx_bytes = len(entries) - tx_bytes
+
+    per_op = {}
+    for c in cmds:
+        s = per_op.setdefault(c["name"], [0, 0, 0])
+        s[0] += 1
+        s[1] += 1 + len(c["args"])
+        s[2] += len(c["resp"])
+
+    print("%-34s %7s %9s %9s %9s" % ("command", "count", "tx bytes",
+                                     "rx bytes", "bytes/cmd"))
+    for name in sorted(per_op, key=lambda n: -per_op[n][0]):
+        n, tx, rx = per_op[name]
+        print("%-34s %7d %9d %9d %9.1f" % (name, n, tx, rx,
+                                           float(tx + rx) / n))
+
+    # 10 bits on the wire per byte (start + 8 data + stop)
+    capacity = args.baud / 10.0 * duration / 1e6
+    print("")
+    print("duration        %.3f s" % (duration / 1e6))
+    print("commands        %d (%.1f/s)" % (len(cmds),
+                                          len(cmds) * 1e6 / duration))
+    print("tx utilization  %.1f%%" % (100.0 * tx_bytes / capacity))
+    print("rx utilization  %.1f%%" % (100.0 * rx_bytes / capacity))
+    return 0
+
+
+def format_cmd(c):
+    return " ".join(["%02X" % c["op"]] + ["%02X" % b for b in c["args"]])
+
+
+def cmd_check(args):
+    cmds = [format_cmd(c) for c in commands(decode(read_log(args.log)))]
+    if args.update:
+        with open(args.golden, "w") as f:
+            f.write("\n".join(cmds) + "\n")
+        print("wrote %d commands to %s" % (len(cmds), args.golden))
+        return 0
+
+    with open(args.golden) as f:
+        golden = [l.strip() for l in f if l.strip()]
+
+    for i, (got, want) in enumerate(zip(cmds, golden)):
+        if got != want:
+            print("command %d differs: got %s, expected %s" % (i, got, want))
+            return 1
+    if len(cmds) != len(golden):
+        print("got %d commands, expected %d" % (len(cmds), len(golden)))
+        return 1
+    print("%d commands match %s" % (len(cmds), args.golden))
+    return 0
+
+
+def cmd_capture(args):
+    import paho.mqtt.client as mqtt
+
+    chunks = {}
+
+    def on_message(client, userdata, msg):
+        p = bytearray(msg.payload)
+        index, count = struct.unpack("<HH", bytes(p[:4]))
+        if count == 0:
+            print("replay done, %d mismatched bytes" %
+                  struct.unpack("<I", bytes(p[4:8]))[0])
+            return
+        chunks[index] = p[4:]
+        if len(chunks) == count:
+            with open(args.out, "wb") as f:
+                for i in range(count):
+                    f.write(chunks[i])
+            print("wrote %d bytes to %s" %
+                  (sum(len(c) for c in chunks.values()), args.out))
+            chunks.clear()
+
+    client = mqtt.Client()
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    client.subscribe("m3pi-mqtt-ee250/serial-log")
+    client.loop_forever()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd")
+
+    p = sub.add_parser("capture", help="collect a log published by the robot")
+    p.add_argument("-o", "--out", default="m3pi-serial.log")
+    p.add_argument("--host", default="eclipse.usc.edu")
+    p.add_argument("--port", type=int, default=11000)
+
+    p = sub.add_parser("stats", help="bytes per command and UART utilization")
+    p.add_argument("log")
+    p.add_argument("--baud", type=int, default=115200)
+
+    p = sub.add_parser("check", help="compare commands against a golden file")
+    p.add_argument("log")
+    p.add_argument("golden")
+    p.add_argument("--update", action="store_true")
+
+    args = parser.parse_args()
+    if args.cmd == "capture":
+        return cmd_capture(args)
+    elif args.cmd == "stats":
+        return cmd_stats(args)
+    elif args.cmd == "check":
+        return cmd_check(args)
+    parser.print_help()
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -52,19 +52,48 @@
 #include "MQTTmbed.h"
 #include "MQTTNetwork.h"
 #include "MQTTClient.h"
+#include "Mqtt5Client.h"
 #include "MailMsg.h"
 #include "LEDThread.h"
 #include "PrintThread.h"
+#include "Motion.h"
+#include "Power.h"
+#include "Config.h"
+#include "Boot.h"
+#include "Range.h"
+#include "FlightRecorder.h"
+#include "SerialLog.h"
+#include "Swarm.h"
+#include "Topology.h"
+#include "Bench.h"
+#include "Lcd.h"
+#include "Link.h"
+#include "Path.h"
+#include "Teleop.h"
+#include "Ingress.h"
+#include "LineSensors.h"
+#include "TimeSync.h"
+#include "Grid.h"
+#include "Nav.h"
 
 extern "C" void mbed_reset();
 
 /* connect this pin to both the CH_PD (aka EN) & RST pins on the ESP8266 just in case */
 #define WIFI_HW_RESET_PIN       p26
 
-/* Using a hostname instead of IP address has been unverified by us */
+/* Using a hostname instead of IP address has been unverified by us. These are
+ * only defaults. They can be changed without a reflash with the CFG_BROKER_* 
+ * keys of the config store (see Config.h). */
 #define MQTT_BROKER_IPADDR      "128.125.124.160"  // eclipse.usc.edu == 128.125.124.160
 #define MQTT_BROKER_PORT        11000
 
+/* baud rate to switch the 3pi link to, if its firmware supports it */
+#define M3PI_FAST_BAUD          230400
+
+/* How long the main loop waits for MQTT traffic each time around. Periodic
+   publishing (swarm state, reports) is checked once per loop. */
+#define MAIN_LOOP_YIELD_MS      100
+
 /* turn on easy-connect debug prints */
 #define EASY_CONNECT_LOGGING    true
 
@@ -74,19 +103,37 @@ DigitalOut wifiHwResetPin(WIFI_HW_RESET_PIN);
  *  3pi robot base. It's UART lines are connected to the LPC1768's p9 and p10.
  *  If you send the right sequence of UART characters to the atmega328p, it will
  *  move the robot for you. We provide a movement() function below for you to use
+ *
+ *  The 3pi is not reset here. robotInit() does that in parallel with the wifi
+ *  bring-up so construction does not block the boot.
  */
-m3pi m3pi(p23, p9, p10);
+m3pi m3pi(p23, p9, p10, false);
+
+/* The m3pi's serial link is not thread safe either. Lock this global mutex 
+ * before any calls to m3pi. 
+ */
+Mutex m3piMtx;
 
 /* MQTTClient and TCPSocket (underneath MQTTNetwork) may not be thread safe. 
  * Lock this global mutex before any calls to publish(). 
  */
 Mutex mqttMtx;
 
-//Mutex dir_mut;
-//char dir;
 static char *topic = "m3pi-mqtt-ee250";
+/* commands for this robot only, like the ones from m3pi_gateway */
+#define ROBOT_TOPIC_PREFIX "m3pi-mqtt-ee250/robot/"
+static char robotTopic[64];
+static const char *powerTopic = "m3pi-mqtt-ee250/power";
+
+/* Local control thread. It does not depend on the network, so robotInit()
+   starts it as soon as the 3pi is ready. Its stack is allocated statically,
+   like every other thread (see Topology.h). */
+static MotionThreadType motionThr;
+static RobotInitThreadType robotInitThr;
+static LcdThreadType lcdThr;
 
-// AnalogIn ultraSonic(p19); //ultrasonic sensor analog in
+/* runs the LED and print workers, one message at a time (see Worker.h) */
+static NormalExecutor normalExecutor;
 
 /**
  * @brief      controls movement of the 3pi
@@ -98,6 +145,11 @@ static char *topic = "m3pi-mqtt-ee250";
  *
  * in the .cpp file in which you want to use it.
  *
+ * The motors are not switched directly. The command is handed to the motion 
+ * thread (see Motion.h), which ramps the wheels up to speed. If you call 
+ * movement() again right after this one returns, the robot blends into the 
+ * next command instead of stopping in between.
+ *
  * @param[in]  command  The movement command
  * @param[in]  speed    The speed of the movement (start by trying 25)
  * @param[in]  delta_t  The time for each movement in msec (start by trying 100)
@@ -108,53 +160,71 @@ void movement(char command, char speed, int delta_t)
 {
     if (command == 's')
     {
-        m3pi.forward(speed);
+        motionCommand(speed, speed, delta_t);
         Thread::wait(delta_t);
-        m3pi.stop();
     }    
     else if (command == 'a')
     {
-        m3pi.left(speed);
+        motionCommand(speed, -speed, delta_t);
         Thread::wait(delta_t);
-        m3pi.stop();
     }   
     else if (command == 'w')
     {
-        m3pi.backward(speed);
+        motionCommand(-speed, -speed, delta_t);
         Thread::wait(delta_t);
-        m3pi.stop();
     }
     else if (command == 'd')
     {
-        m3pi.right(speed);
+        motionCommand(-speed, speed, delta_t);
         Thread::wait(delta_t);
-        m3pi.stop();
     }
 }
 
+/* number of messages put() into each thread's mailbox, for the mailbox depth
+   recorded by the flight recorder */
+static uint32_t printPutCount = 0;
+static uint32_t ledPutCount = 0;
+
 /* Callback for any received MQTT messages */
 void messageArrived(MQTT::MessageData& md)
 {
     MQTT::Message &message = md.message;
     MailMsg *msg;
 
+    bootMark(BOOT_FIRST_COMMAND);
+
+    /* every message needs the two header bytes and has to fit in a MailMsg */
+    if (message.payloadlen < 2 || message.payloadlen > MAX_MAIL_MSG_DATA_SIZE) {
+        frRecord(FR_EVT_FAULT, FR_FAULT_BAD_MESSAGE, message.payloadlen);
+        ingressDrop(0, INGRESS_DROP_INVALID);
+        return;
+    }
+
     /* our messaging standard says the first byte denotes which thread to 
        forward the packet payload to */
     char fwdTarget = ((char *)message.payload)[0];
+    char msgType = ((char *)message.payload)[1];
+
+    /* Police before anything is allocated or printed. Drops are only 
+       counted, since printing each one would slow this thread down even more
+       during a flood (see Ingress.h). */
+    if (!ingressAdmit(fwdTarget, msgType)) {
+        return;
+    }
 
     /* Ship (or "dispatch") the entire message via Mail to threads since the 
        reference to messages will be destroyed by the MQTT thread when this 
-       callback returns */
+       callback returns. Nothing is printed per message, that would hold up 
+       this thread on the stdio UART; the flight recorder has the dispatch. */
     switch(fwdTarget)
     {
         case FWD_TO_PRINT_THR:
-            printf("fwding to print thread\n");
-
             /* allocate the memory for a piece of mail */
             msg = getPrintThreadMailbox()->alloc();
 
             if (!msg) {
-                printf("print thread mailbox full!\n");
+                ingressDrop(fwdTarget, INGRESS_DROP_FULL);
+                frRecord(FR_EVT_MAILBOX_FULL, fwdTarget, 0);
                 break;
             }
 
@@ -164,41 +234,110 @@ void messageArrived(MQTT::MessageData& md)
 
             /* put the piece of mail into the target thread's mailbox */
             getPrintThreadMailbox()->put(msg);
+            printPutCount++;
+            frRecord(FR_EVT_DISPATCH, fwdTarget, (msgType << 8) | 
+                     ((printPutCount - getPrintThreadHandledCount()) & 0xFF));
             break;
         case FWD_TO_LED_THR:
-            printf("fwding to led thread\n");
             msg = getLEDThreadMailbox()->alloc();
             if (!msg) {
-                printf("led thread mailbox full!\n");
+                ingressDrop(fwdTarget, INGRESS_DROP_FULL);
+                frRecord(FR_EVT_MAILBOX_FULL, fwdTarget, 0);
                 break;
             }
             memcpy(msg->content, message.payload, message.payloadlen);
             msg->length = message.payloadlen;
             getLEDThreadMailbox()->put(msg);
+            ledPutCount++;
+            frRecord(FR_EVT_DISPATCH, fwdTarget, (msgType << 8) | 
+                     ((ledPutCount - getLEDThreadHandledCount()) & 0xFF));
+            break;
+        case FWD_TO_POWER:
+            frRecord(FR_EVT_DISPATCH, fwdTarget, msgType << 8);
+            powerSetSleepEnabled(msgType == POWER_SLEEP_ON);
+            break;
+        case FWD_TO_SERIAL_LOG:
+            frRecord(FR_EVT_DISPATCH, fwdTarget, msgType << 8);
+            serialLogCommand(msgType);
+            break;
+        case FWD_TO_PATH:
+            frRecord(FR_EVT_DISPATCH, fwdTarget, msgType << 8);
+            if (msgType == PATH_PLAY)
+                navCancel();
+            pathCommand((const char *)message.payload, message.payloadlen);
+            break;
+        case FWD_TO_TELEOP: {
+            const uint8_t *b = (const uint8_t *)message.payload;
+            uint64_t sentUs = 0;
+
+            frRecord(FR_EVT_DISPATCH, fwdTarget, msgType << 8);
+            navCancel();
+            for (int i = 10; i >= 3 && message.payloadlen >= 11; i--)
+                sentUs = (sentUs << 8) | b[i];
+            teleopCommand(msgType, message.payloadlen > 2 ? b[2] : 
+                          configGetInt(CFG_MOVE_SPEED, CONFIG_DEFAULT_MOVE_SPEED),
+                          sentUs);
+            break;
+        }
+        case FWD_TO_LINE:
+            frRecord(FR_EVT_DISPATCH, fwdTarget, msgType << 8);
+            if (msgType == LINE_CALIBRATE) {
+                navCancel();
+                lineCalibrate();
+            }
+            else if (msgType == LINE_FORGET)
+                lineForget();
+            break;
+        case FWD_TO_NAV:
+            frRecord(FR_EVT_DISPATCH, fwdTarget, msgType << 8);
+            navCommand((const char *)message.payload, message.payloadlen);
             break;
-            //added 
-            /*
-         case FWD_TO_MOVE_THR:
-			printf("fwding to move thread\n");
-			msg = getMoveThreadMailbox()->alloc();
-
-			if (!msg)   {
-				printf("move thread mailbox full\n");
-				break;
-			}
-
-			memcpy(msg->content, message.payload, message.payloadlen);
-			msg->length = message.payloadlen;
-			getMoveThreadMailbox()->put(msg);
-			break;
-            */
         default:
-            /* do nothing */
-            printf("Unknown MQTT message\n");
+            /* unknown targets are dropped by ingressAdmit() */
             break;
     }
 }
 
+/**
+ * @brief      Boot stage that gets the robot itself ready. It runs in its own 
+ *             thread while main() brings up the ESP8266 and MQTT, which takes
+ *             several seconds, so the robot can be driven locally right away.
+ */
+static void robotInit()
+{
+    m3piMtx.lock();
+    m3pi.reset();
+    /* only does anything with 3pi firmware that can change its baud rate */
+    if (m3pi.set_baud(M3PI_FAST_BAUD))
+        printf("m3pi link at %d baud\n", M3PI_FAST_BAUD);
+    m3piMtx.unlock();
+    bootMark(BOOT_ROBOT_RESET);
+
+    /* Record the battery voltage before anything else so the power reports
+       have a baseline, and start sleeping whenever the threads are idle. */
+    powerInit();
+
+    /* the LCD only gets the characters that change (see Lcd.h) */
+    lcdThr.start(lcdThread);
+    lcdPrintf(0, "%u.%02uV", powerBatteryMillivolts() / 1000,
+              powerBatteryMillivolts() % 1000 / 10);
+
+    rangeWarmUp();
+    /* no spinning on every reset, the calibration is kept in flash */
+    lineInit();
+    bootMark(BOOT_SENSORS_WARM);
+
+    /* The motion thread owns the motors. Give it a higher priority than the 
+       rest of the threads so the wheel ramps tick on time. */
+    motionThr.start(motionThread);
+
+    /* Here, we do not pass the MQTT client in. This means the print worker
+       won't be able to publish any MQTT messages. Modify this accordingly if
+       you need to publish. */
+    startPrintThread(normalExecutor.queue());
+    bootMark(BOOT_CONTROL_UP);
+}
+
 int main()
 {
     /* Uncomment this to see how the m3pi moves. This sequence of functions
@@ -224,6 +363,26 @@ int main()
     // movement('s', 25, 100);
     // print("Hello", 5)
 
+    /* first thing, so everything after this can be recorded */
+    frInit();
+    bootMark(BOOT_START);
+
+    /* Load broker, wifi and tuning settings saved in flash (see Config.h) */
+    configInit();
+    lcdPrintf(1, "BOOT");
+
+#ifdef M3PI_BENCH
+    /* a benchmark build only runs the benchmarks (see Bench.h) */
+    benchRun();
+    Thread::wait(osWaitForever);
+#endif
+
+    /* Get the 3pi, sensors and local control threads going in parallel with
+       the wifi bring-up below (see Boot.h) */
+    topologyPrint();
+    normalExecutor.start();
+    robotInitThr.start(robotInit);
+
     wait(1); //delay startup 
     printf("Resetting ESP8266 Hardware...\n");
     wifiHwResetPin = 0;
@@ -233,63 +392,244 @@ int main()
     printf("Starting MQTT example with an ESP8266 wifi device using Mbed OS.\n");
     printf("Attempting to connect to access point...\n");
 
-    /* wifi ssid/pw and wifi interface settings are set in mbed_app.json. 
-     * NetworkInterface is mbed-OS's abstraction of any network interface */
-    NetworkInterface* wifi = easy_connect(EASY_CONNECT_LOGGING);
+    /* wifi ssid/pw and wifi interface settings are set in mbed_app.json, 
+     * unless the config store has its own ssid/pw. NetworkInterface is 
+     * mbed-OS's abstraction of any network interface */
+    NetworkInterface* wifi;
+    if (configHas(CFG_WIFI_SSID)) {
+        char ssid[CONFIG_MAX_VALUE_LEN + 1];
+        char password[CONFIG_MAX_VALUE_LEN + 1];
+        configGetString(CFG_WIFI_SSID, ssid, sizeof(ssid), "");
+        configGetString(CFG_WIFI_PASSWORD, password, sizeof(password), "");
+        wifi = easy_connect(EASY_CONNECT_LOGGING, ssid, password);
+    } else {
+        wifi = easy_connect(EASY_CONNECT_LOGGING);
+    }
     if (!wifi) {
         printf("Connection error! Your ESP8266 may not be responding.\n");
         printf("Try double checking your circuit or unplug/plug your LPC1768 board.\n");
-        printf("Exiting.\n");
-        return -1;
+        printf("The robot keeps running without the network.\n");
+        frRecord(FR_EVT_FAULT, FR_FAULT_WIFI_CONNECT, 0);
+        lcdPrintf(1, "NO WIFI");
+        Thread::wait(osWaitForever);
     }
+    bootMark(BOOT_WIFI_UP);
 
     const char *ipAddr = wifi->get_ip_address();
+    const char *lastOctet = strrchr(ipAddr, '.');
     printf("Success! My IP addr: %s\n", ipAddr);
+    lcdPrintf(1, "WIFI%4s", lastOctet ? lastOctet + 1 : "");
     char clientID[30];
     /* use ip addr as unique client ID */
     strcpy(clientID, ipAddr);
 
     /* wrapper for (NetworkInterface *wifi) to adapt to MQTTClient.h */
     MQTTNetwork mqttNetwork(wifi);
-    MQTT::Client<MQTTNetwork, Countdown> client(mqttNetwork);
+    MQTTClientType client(mqttNetwork);
+
+    char brokerAddr[CONFIG_MAX_VALUE_LEN + 1];
+    int brokerPort = configGetInt(CFG_BROKER_PORT, MQTT_BROKER_PORT);
+    configGetString(CFG_BROKER_ADDR, brokerAddr, sizeof(brokerAddr), 
+                    MQTT_BROKER_IPADDR);
 
-    printf("Connecting to %s:%d\n", MQTT_BROKER_IPADDR, MQTT_BROKER_PORT);
-    int retval = mqttNetwork.connect(MQTT_BROKER_IPADDR, MQTT_BROKER_PORT);
-    if (retval != 0)
+    printf("Connecting to %s:%d\n", brokerAddr, brokerPort);
+    int retval = mqttNetwork.connect(brokerAddr, brokerPort);
+    if (retval != 0) {
         printf("TCP connect returned %d\n", retval);
+        frRecord(FR_EVT_FAULT, FR_FAULT_TCP_CONNECT, retval);
+    }
 
     MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+#ifdef M3PI_MQTT5
+    data.MQTTVersion = 5;   //topic aliases and flow control (see Mqtt5Client.h)
+#else
     data.MQTTVersion = 3;   //support only available up to ver. 3
+#endif
     // data.keepAliveInterval = 60; //MQTTPacket_connectData_initializer sets this to 60
     data.clientID.cstring = clientID; 
-    if ((retval = client.connect(data)) != 0)
+    if ((retval = client.connect(data)) != 0) {
         printf("connect returned %d\n", retval);
+        frRecord(FR_EVT_FAULT, FR_FAULT_MQTT_CONNECT, retval);
+        lcdPrintf(1, "MQTT ERR");
+    }
 
 
     /* define MQTTCLIENT_QOS2 as 1 to enable QOS2 (see MQTTClient.h) */
     /* This call attaches the messageArrived callback to handle MQTT messages 
        that arrive */
-    if ((retval = client.subscribe(topic, MQTT::QOS0, messageArrived)) != 0)
+    if ((retval = client.subscribe(topic, MQTT::QOS0, messageArrived)) != 0) {
+        printf("MQTT subscribe returned %d\n", retval);
+        frRecord(FR_EVT_FAULT, FR_FAULT_SUBSCRIBE, retval);
+    }
+    snprintf(robotTopic, sizeof(robotTopic), "%s%s", ROBOT_TOPIC_PREFIX, 
+             clientID);
+    if ((retval = client.subscribe(robotTopic, MQTT::QOS0, 
+                                   messageArrived)) != 0) {
         printf("MQTT subscribe returned %d\n", retval);
+        frRecord(FR_EVT_FAULT, FR_FAULT_SUBSCRIBE, retval);
+    }
 
-    /* This is a good point to launch your threads. If you want to create 
-       another thread, you can look at the structure of the two threads we 
-       provided and make a copy of it. Otherewise, you can gut out the two 
-       threads and insert your application code. Read the LEDThread and 
-       PrintThread files to understand how these threads work.*/
-    Thread ledThr;
-    Thread printThr;
+    /* Every robot shares its pose and intent on the swarm topic. Without a 
+       configured id, the last byte of our IP address is unique enough. */
+    swarmInit(configGetInt(CFG_ROBOT_ID, lastOctet ? atoi(lastOctet + 1) : 0));
+    if ((retval = client.subscribe(SWARM_TOPIC, MQTT::QOS0, 
+                                   swarmMessageArrived)) != 0) {
+        printf("MQTT subscribe returned %d\n", retval);
+        frRecord(FR_EVT_FAULT, FR_FAULT_SUBSCRIBE, retval);
+    }
 
-    /* Here, we pass in a pointer to the MQTT client so the LED thread can 
-       client.publish() messages */
-    ledThr.start(callback(LEDThread, (void *)&client));
+    /* config updates get their own topic and callback (see Config.h) */
+    if ((retval = client.subscribe(CONFIG_TOPIC, MQTT::QOS1, 
+                                   configMessageArrived)) != 0) {
+        printf("MQTT subscribe returned %d\n", retval);
+        frRecord(FR_EVT_FAULT, FR_FAULT_SUBSCRIBE, retval);
+    }
 
-    /* Here, we do not pass the pointer in. This means the printing thread 
-       won't be able to publish any MQTT messages. Modify this accordingly if
-       you need to publish. */
-    printThr.start(printThread);
-    //added
-    char loc_dir = 'n';
+    /* the broker echoes our probes back to measure the link (see Link.h) */
+    linkInit(clientID);
+    gridInit(clientID, MQTT_MAX_PACKET_SIZE - MQTT_PUBLISH_OVERHEAD);
+    navInit(clientID);
+    if ((retval = client.subscribe(linkProbeTopic(), MQTT::QOS0, 
+                                   linkMessageArrived)) != 0) {
+        printf("MQTT subscribe returned %d\n", retval);
+        frRecord(FR_EVT_FAULT, FR_FAULT_SUBSCRIBE, retval);
+    }
+
+    /* the time server answers on our own topic (see TimeSync.h). This takes
+       the last of the MQTT_MESSAGE_HANDLERS subscriptions. */
+    timeInit(clientID);
+    if ((retval = client.subscribe(timeResponseTopic(), MQTT::QOS0, 
+                                   timeMessageArrived)) != 0) {
+        printf("MQTT subscribe returned %d\n", retval);
+        frRecord(FR_EVT_FAULT, FR_FAULT_SUBSCRIBE, retval);
+    }
+
+    bootMark(BOOT_MQTT_UP);
+    if (client.isConnected())
+        lcdPrintf(1, "MQTT%4s", lastOctet ? lastOctet + 1 : "");
+
+    /* This is a good point to launch your workers. If you want to create 
+       another one, you can look at the structure of the two workers we 
+       provided (a worker type in the header, a handler in the .cpp) and add
+       it to WORKER_TOPOLOGY in Topology.h. Otherewise, you can gut out the 
+       two workers and insert your application code. Read the LEDThread and 
+       PrintThread files to understand how these workers work. Workers that
+       do not need the network belong in robotInit() instead. */
+
+    /* The LED worker does not publish itself, its messages are published 
+       by the loop below (ledNextPublish()) */
+    startLEDThread(normalExecutor.queue());
+
+    MQTT::Message bootMsg;
+    char bootBuf[BOOT_TIMELINE_SIZE];
+    bool firstCommandReported = false;
+    bootMsg.qos = MQTT::QOS0;
+    bootMsg.retained = false;
+    bootMsg.dup = false;
+    bootMsg.payload = (void *)bootBuf;
+    bootMsg.payloadlen = bootFormatTimeline(bootBuf);
+    mqttMtx.lock();
+    client.publish(BOOT_TOPIC, bootMsg);
+    mqttMtx.unlock();
+    bootPrintTimeline();
+
+    /* Dump what the flight recorder captured before the last reset. This 
+       runs before the main loop, so pace it to not flood the ESP8266. */
+    char frBuf[FR_CHUNK_SIZE];
+    MQTT::Message frMsg;
+    frMsg.qos = MQTT::QOS0;
+    frMsg.retained = false;
+    frMsg.dup = false;
+    frMsg.payload = (void *)frBuf;
+    for (int chunk = 0; (frMsg.payloadlen = frFormatChunk(chunk, frBuf)) > 0;
+         chunk++) {
+        mqttMtx.lock();
+        retval = client.publish(FR_TOPIC, frMsg);
+        mqttMtx.unlock();
+        if (retval != 0) {
+            frRecord(FR_EVT_FAULT, FR_FAULT_PUBLISH, retval);
+            break;
+        }
+        client.yield(10);
+    }
+
+    MQTT::Message swarmMsg;
+    char swarmBuf[SWARM_RECORD_SIZE];
+    Timer swarmTimer;
+    swarmMsg.qos = MQTT::QOS0;
+    swarmMsg.retained = false;
+    swarmMsg.dup = false;
+    swarmMsg.payload = (void *)swarmBuf;
+    swarmTimer.start();
+
+    MQTT::Message ledMsg;
+    char ledBuf[LED_PUBLISH_SIZE];
+    ledMsg.qos = MQTT::QOS0;
+    ledMsg.retained = false;
+    ledMsg.dup = false;
+    ledMsg.payload = (void *)ledBuf;
+
+    MQTT::Message logMsg;
+    char logBuf[SERIAL_LOG_CHUNK_SIZE];
+    logMsg.qos = MQTT::QOS0;
+    logMsg.retained = false;
+    logMsg.dup = false;
+    logMsg.payload = (void *)logBuf;
+
+    MQTT::Message pathMsg;
+    char pathBuf[PATH_CHUNK_SIZE];
+    pathMsg.qos = MQTT::QOS0;
+    pathMsg.retained = false;
+    pathMsg.dup = false;
+    pathMsg.payload = (void *)pathBuf;
+
+    MQTT::Message linkMsg;
+    char linkBuf[LINK_STATUS_SIZE];
+    Timer linkTimer;
+    linkMsg.qos = MQTT::QOS0;
+    linkMsg.retained = false;
+    linkMsg.dup = false;
+    linkMsg.payload = (void *)linkBuf;
+    linkTimer.start();
+
+    MQTT::Message ingressMsg;
+    char ingressBuf[INGRESS_REPORT_SIZE];
+    ingressMsg.qos = MQTT::QOS0;
+    ingressMsg.retained = false;
+    ingressMsg.dup = false;
+    ingressMsg.payload = (void *)ingressBuf;
+
+    MQTT::Message timeMsg;
+    char timeBuf[TIME_MSG_MAX_SIZE];
+    Timer timeTimer;
+    timeMsg.qos = MQTT::QOS0;
+    timeMsg.retained = false;
+    timeMsg.dup = false;
+    timeMsg.payload = (void *)timeBuf;
+    timeTimer.start();
+
+    MQTT::Message gridMsg;
+    char gridBuf[GRID_DIFF_MAX_SIZE];
+    gridMsg.qos = MQTT::QOS0;
+    gridMsg.retained = false;
+    gridMsg.dup = false;
+    gridMsg.payload = (void *)gridBuf;
+
+    MQTT::Message navMsg;
+    char navBuf[NAV_STATUS_SIZE];
+    navMsg.qos = MQTT::QOS0;
+    navMsg.retained = false;
+    navMsg.dup = false;
+    navMsg.payload = (void *)navBuf;
+
+    MQTT::Message powerMsg;
+    char powerBuf[POWER_REPORT_SIZE];
+    Timer powerReportTimer;
+    powerMsg.qos = MQTT::QOS0;
+    powerMsg.retained = false;
+    powerMsg.dup = false;
+    powerMsg.payload = (void *)powerBuf;
+    powerReportTimer.start();
 
     /* The main thread will now run in the background to keep the MQTT/TCP 
      connection alive. MQTTClient is not an asynchronous library. Paho does
@@ -297,61 +637,119 @@ int main()
      be used by the MQTTAsync library. Please do NOT do anything else in this
      thread. Let it serve as your background MQTT thread. */
     while(1) {
-        Thread::wait(1000);
-        printf("main: yielding...\n", client.isConnected());
+        /* No per-loop printing here. The loop runs every MAIN_LOOP_YIELD_MS 
+           and printing keeps the CPU and the stdio UART awake for nothing. */
 
         // movement('a', 25, 100);
 
-        if(!client.isConnected())
+        if(!client.isConnected()) {
+            frRecord(FR_EVT_RECONNECT, 0, 0);
             mbed_reset(); //connection lost! software reset
-    //added
-/*        
-        if (dir_mut.trylock())  {
-
-			loc_dir = dir;
-			dir_mut.unlock();
-		}
-
-		switch (loc_dir)    {
-			case MOVE_LEFT:
-				movement('a', 25, 100);
-				break;
-			case MOVE_FORWARD_LEFT:
-				movement('w', 25, 100);
-				movement('a', 25, 100);
-				break;
-			case MOVE_FORWARD:
-				movement('w', 25, 100);
-				break;
-			case MOVE_FORWARD_RIGHT:
-				movement('w', 25, 100);
-				movement('d', 25, 100);
-				break;
-		 	case MOVE_RIGHT:
-		 		movement('d', 25, 100);
-				break;
-			case MOVE_BACK_RIGHT:
-				movement('s', 25, 100);
-				movement('d', 25, 100);
-				break;
-			case MOVE_BACK:
-				movement('s', 25, 100);
-				break;
-			case MOVE_BACK_LEFT:
-				movement('s', 25, 100);
-				movement('a', 25, 100);
-				break;
-			default:
-				break;
-		}
-
-
-		if(ultraSonic < 25){
-			
-		}
-
+        }
+
+        /* publish the timeline again once it includes time-to-first-command */
+        if (!firstCommandReported && bootReached(BOOT_FIRST_COMMAND)) {
+            firstCommandReported = true;
+            bootMsg.payloadlen = bootFormatTimeline(bootBuf);
+            mqttMtx.lock();
+            client.publish(BOOT_TOPIC, bootMsg);
+            mqttMtx.unlock();
+            bootPrintTimeline();
+        }
+
+        /* messages the LED worker was asked to publish */
+        while ((ledMsg.payloadlen = ledNextPublish(ledBuf)) > 0) {
+            mqttMtx.lock();
+            client.publish(LED_TOPIC, ledMsg);
+            mqttMtx.unlock();
+        }
+
+        /* a finished m3pi serial recording or replay to publish */
+        while ((logMsg.payloadlen = serialLogNextChunk(logBuf)) > 0) {
+            mqttMtx.lock();
+            client.publish(SERIAL_LOG_TOPIC, logMsg);
+            mqttMtx.unlock();
+            client.yield(10);
+        }
+
+        /* a requested download of the stored path */
+        while ((pathMsg.payloadlen = pathNextChunk(pathBuf)) > 0) {
+            mqttMtx.lock();
+            client.publish(PATH_TOPIC, pathMsg);
+            mqttMtx.unlock();
+            client.yield(10);
+        }
+
+        /* publish a probe, and the status from the probes so far */
+        if (linkTimer.read_ms() >= LINK_PROBE_INTERVAL_MS) {
+            linkTimer.reset();
+            linkMsg.payloadlen = linkFormatProbe(linkBuf);
+            mqttMtx.lock();
+            client.publish(linkProbeTopic(), linkMsg);
+            linkMsg.payloadlen = linkFormatStatus(linkBuf);
+            client.publish(LINK_STATUS_TOPIC, linkMsg);
+            mqttMtx.unlock();
+        }
+
+        /* a finished line sensor calibration to save */
+        linePoll();
+
+        /* drop counts, at most once per INGRESS_REPORT_INTERVAL_MS */
+        if ((ingressMsg.payloadlen = ingressNextReport(ingressBuf)) > 0) {
+            mqttMtx.lock();
+            client.publish(INGRESS_TOPIC, ingressMsg);
+            mqttMtx.unlock();
+        }
+
+        /* ask the time server, and publish how well we are synchronized */
+        if (timeTimer.read_ms() >= linkPeriod(timeRequestInterval())) {
+            timeTimer.reset();
+            mqttMtx.lock();
+            timeMsg.payloadlen = timeFormatStatus(timeBuf, teleopLatencyUs());
+            client.publish(TIME_STATUS_TOPIC, timeMsg);
+            timeMsg.payloadlen = timeFormatRequest(timeBuf);
+            client.publish(TIME_REQUEST_TOPIC, timeMsg);
+            mqttMtx.unlock();
+        }
+
+        /* plan and steer towards the goal, if there is one */
+        if ((navMsg.payloadlen = navPoll(navBuf)) > 0) {
+            mqttMtx.lock();
+            client.publish(navTopic(), navMsg);
+            mqttMtx.unlock();
+        }
+
+        /* the map cells that changed, at most once per GRID_EXPORT_MS (or
+           slower when the link is bad, like the other periodic publishes) */
+        gridMsg.payloadlen = gridNextDiff(gridBuf, linkPeriod(GRID_EXPORT_MS));
+        if (gridMsg.payloadlen > 0) {
+            mqttMtx.lock();
+            if (client.publish(gridTopic(), gridMsg) != 0)
+                gridDiffLost(gridBuf);
+            mqttMtx.unlock();
+        }
+
+        /* slows down when the link gets bad */
+        if (swarmTimer.read_ms() >= linkPeriod(SWARM_PERIOD_MS)) {
+            swarmTimer.reset();
+            swarmMsg.payloadlen = swarmFormatState(swarmBuf);
+            mqttMtx.lock();
+            client.publish(SWARM_TOPIC, swarmMsg);
+            mqttMtx.unlock();
+        }
+
+        if (powerReportTimer.read_ms() >= 
+            linkPeriod(POWER_REPORT_INTERVAL_MS)) {
+            powerReportTimer.reset();
+            powerMsg.payloadlen = powerFormatReport(powerBuf);
+            mqttMtx.lock();
+            client.publish(powerTopic, powerMsg);
+            mqttMtx.unlock();
+            lcdPrintf(0, "%u.%02uV", powerBatteryMillivolts() / 1000,
+                      powerBatteryMillivolts() % 1000 / 10);
+        }
         /* yield() needs to be called at least once per keepAliveInterval. */
-        client.yield(1000);
+        client.yield(MAIN_LOOP_YIELD_MS);
     }
 
     return 0;
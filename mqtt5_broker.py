@@ -0,0 +1,438 @@
+#!/usr/bin/env python3
+"""Local MQTT broker stand-in for testing Mqtt5Client.h.
+
+Speaks MQTT 5 and 3.1.1 (so mosquitto_pub/sub work against it too) with the
+features the robot's MQTT 5 client relies on:
+
+  - topic aliases from clients (up to --aliases per connection)
+  - the receive maximum of each client: QoS 1 messages beyond it wait at the
+    broker until the client acknowledges earlier ones
+  - the maximum packet size of each client: larger messages are dropped
+  - message expiry: waiting messages that expire are dropped
+
+It keeps no sessions and no retained messages. Point the robot at it by
+setting CFG_BROKER_ADDR and CFG_BROKER_PORT (see Config.h), then build with
+-DM3PI_MQTT5:
+
+    python3 mqtt5_broker.py --port 11000 -v
+
+Every few seconds it prints, per client, how many topic bytes aliases saved
+and how many messages are waiting or were dropped.
+"""
+import argparse
+import socket
+import socketserver
+import struct
+import sys
+import threading
+import time
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 1, 2, 3, 4
+SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 8, 9, 12, 13, 14
+
+PROP_MESSAGE_EXPIRY = 0x02
+PROP_RECEIVE_MAXIMUM = 0x21
+PROP_TOPIC_ALIAS_MAXIMUM = 0x22
+PROP_TOPIC_ALIAS = 0x23
+PROP_MAXIMUM_PACKET_SIZE = 0x27
+
+# property id: value kind
+PROPS = {}
+for _id in (0x01, 0x17, 0x19, 0x24, 0x25, 0x28, 0x29, 0x2A):
+    PROPS[_id] = "byte"
+for _id in (0x13, 0x21, 0x22, 0x23):
+    PROPS[_id] = "u16"
+for _id in (0x02, 0x11, 0x18, 0x27):
+    PROPS[_id] = "u32"
+for _id in (0x03, 0x08, 0x12, 0x15, 0x1A, 0x1C, 0x1F):
+    PROPS[_id] = "str"
+for _id in (0x09, 0x16):
+    PROPS[_id] = "bin"
+PROPS[0x0B] = "varint"
+PROPS[0x26] = "pair"
+
+
+class ProtocolError(Exception):
+    pass
+
+
+def encode_varint(n):
+    out = bytearray()
+    while True:
+        b = n % 128
+        n //= 128
+        out.append(b | 0x80 if n else b)
+        if not n:
+            return bytes(out)
+
+
+def decode_varint(buf, i):
+    value, mult = 0, 1
+    for _ in range(4):
+        if i >= len(buf):
+            raise ProtocolError("truncated varint")
+        b = buf[i]
+        i += 1
+        value += (b & 0x7F) * mult
+        mult *= 128
+        if not b & 0x80:
+            return value, i
+    raise ProtocolError("varint too long")
+
+
+def read_string(buf, i):
+    if i + 2 > len(buf):
+        raise ProtocolError("truncated string")
+    n = struct.unpack_from(">H", buf, i)[0]
+    return bytes(buf[i + 2:i + 2 + n]), i + 2 + n
+
+
+def read_props(buf, i):
+    """Returns ({id: value}, index after the properties)."""
+    length, i = decode_varint(buf, i)
+    end = i + length
+    props = {}
+    while i < end:
+        pid = buf[i]
+        i += 1
+        kind = PROPS.get(pid)
+        if kind == "byte":
+            props[pid] = buf[i]
+            i += 1
+        elif kind == "u16":
+            props[pid] = struct.unpack_from(">H", buf, i)[0]
+            i += 2
+        elif kind == "u32":
+            props[pid] = struct.unpack_from(">I", buf, i)[0]
+            i += 4
+        elif kind == "varint":
+            props[pid], i = decode_varint(buf, i)
+        elif kind in ("str", "bin"):
+            props[pid], i = read_string(buf, i)
+        elif kind == "pair":
+            _, i = read_string(buf, i)
+            _, i = read_string(buf, i)
+        else:
+            raise ProtocolError("unknown property 0x%02X" % pid)
+    return props, end
+
+
+def encode_props(props):
+    out = bytearray()
+    for pid, value in props:
+        out.append(pid)
+        kind = PROPS[pid]
+        if kind == "u16":
+            out += struct.pack(">H", value)
+        elif kind == "u32":
+            out += struct.pack(">I", value)
+        else:
+            out.append(value)
+    return encode_varint(len(out)) + bytes(out)
+
+
+def packet(ptype, flags, body):
+    return bytes([(ptype << 4) | flags]) + encode_varint(len(body)) + body
+
+
+def topic_matches(filt, topic):
+    f = filt.split("/")
+    t = topic.split("/")
+    for i, part in enumerate(f):
+        if part == "#":
+            return True
+        if i >= len(t):
+            return False
+        if part != "+" and part != t[i]:
+            return False
+    return len(f) == len(t) or (len(f) == len(t) + 1 and f[-1] == "#")
+
+
+class Broker(object):
+    def __init__(self, alias_max, verbose):
+        self.alias_max = alias_max
+        self.verbose = verbose
+        self.lock = threading.Lock()
+        self.sessions = set()
+
+    def log(self, fmt, *args):
+        if self.verbose:
+            print(fmt % args)
+
+    def route(self, sender, topic, payload, qos, expiry):
+        deadline = time.time() + expiry if expiry else None
+        with self.lock:
+            targets = list(self.sessions)
+        for s in targets:
+            granted = s.subscribed(topic)
+            if granted is not None:
+                s.enqueue(topic, payload, min(qos, granted), deadline)
+
+
+class Session(socketserver.BaseRequestHandler):
+    """One client connection."""
+
+    def setup(self):
+        self.broker = self.server.broker
+        self.send_lock = threading.Lock()
+        self.version = 4
+        self.client_id = "?"
+        self.subs = {}
+        self.aliases = {}
+        self.receive_max = 65535
+        self.max_packet = 268435455
+        self.inflight = {}
+        self.waiting = []
+        self.next_id = 0
+        self.stats = {"in": 0, "out": 0, "alias_saved": 0, "expired": 0,
+                      "too_big": 0}
+
+    # -- socket --------------------------------------------------------
+
+    def recv_exact(self, n):
+        buf = bytearray()
+        while len(buf) < n:
+            chunk = self.request.recv(n - len(buf))
+            if not chunk:
+                raise EOFError
+            buf += chunk
+        return buf
+
+    def read_packet(self):
+        first = self.recv_exact(1)[0]
+        length, mult = 0, 1
+        for _ in range(4):
+            b = self.recv_exact(1)[0]
+            length += (b & 0x7F) * mult
+            mult *= 128
+            if not b & 0x80:
+                break
+        else:
+            raise ProtocolError("bad remaining length")
+        return first >> 4, first & 0x0F, self.recv_exact(length)
+
+    def send(self, data):
+        with self.send_lock:
+            self.request.sendall(data)
+
+    # -- delivery ------------------------------------------------------
+
+    def subscribed(self, topic):
+        granted = None
+        for filt, qos in self.subs.items():
+            if topic_matches(filt, topic):
+                granted = qos if granted is None else max(granted, qos)
+        return granted
+
+    def enqueue(self, topic, payload, qos, deadline):
+        with self.broker.lock:
+            self.waiting.append((topic, payload, qos, deadline))
+        self.flush()
+
+    def flush(self):
+        """Sends waiting messages as far as the receive maximum allows."""
+        while True:
+            with self.broker.lock:
+                if not self.waiting:
+                    return
+                topic, payload, qos, deadline = self.waiting[0]
+                if qos and len(self.inflight) >= self.receive_max:
+                    return
+                self.waiting.pop(0)
+                if deadline is not None and deadline <= time.time():
+                    self.stats["expired"] += 1
+                    continue
+                pid = 0
+                if qos:
+                    self.next_id = self.next_id % 65535 + 1
+                    pid = self.next_id
+                    self.inflight[pid] = topic
+            data = self.encode_publish(topic, payload, qos, pid, deadline)
+            if len(data) > self.max_packet:
+                self.stats["too_big"] += 1
+                with self.broker.lock:
+                    self.inflight.pop(pid, None)
+                continue
+            self.stats["out"] += 1
+            self.send(data)
+
+    def encode_publish(self, topic, payload, qos, pid, deadline):
+        t = topic.encode()
+        body = struct.pack(">H", len(t)) + t
+        if qos:
+            body += struct.pack(">H", pid)
+        if self.version == 5:
+            props = []
+            if deadline is not None:
+                props.append((PROP_MESSAGE_EXPIRY,
+                              max(1, int(deadline - time.time()))))
+            body += encode_props(props)
+        return packet(PUBLISH, qos << 1, body + payload)
+
+    # -- packets -------------------------------------------------------
+
+    def on_connect(self, body):
+        name, i = read_string(body, 0)
+        self.version = body[i]
+        flags = body[i + 1]
+        keepalive = struct.unpack_from(">H", body, i + 2)[0]
+        i += 4
+        if name != b"MQTT" or self.version not in (4, 5):
+            raise ProtocolError("unsupported protocol %r %d" %
+                                (name, self.version))
+        if self.version == 5:
+            props, i = read_props(body, i)
+            self.receive_max = props.get(PROP_RECEIVE_MAXIMUM, 65535)
+            self.max_packet = props.get(PROP_MAXIMUM_PACKET_SIZE,
+                                        self.max_packet)
+        cid, i = read_string(body, i)
+        self.client_id = cid.decode("utf-8", "replace")
+        if flags & 0x04:
+            raise ProtocolError("wills are not supported")
+
+        if self.version == 5:
+            ack = bytes([0, 0]) + encode_props(
+                [(PROP_TOPIC_ALIAS_MAXIMUM, self.broker.alias_max)])
+        else:
+            ack = bytes([0, 0])
+        self.send(packet(CONNACK, 0, ack))
+        self.broker.log("%s: connected, MQTT %s, keepalive %d s, receive "
+                        "maximum %d, maximum packet %d", self.client_id,
+                        "5" if self.version == 5 else "3.1.1", keepalive,
+                        self.receive_max, self.max_packet)
+
+    def on_publish(self, flags, body):
+        qos = (flags >> 1) & 3
+        if qos > 1:
+            raise ProtocolError("QoS 2 is not supported")
+        topic, i = read_string(body, 0)
+        topic = topic.decode("utf-8", "replace")
+        pid = 0
+        if qos:
+            pid = struct.unpack_from(">H", body, i)[0]
+            i += 2
+        expiry = None
+        if self.version == 5:
+            props, i = read_props(body, i)
+            expiry = props.get(PROP_MESSAGE_EXPIRY)
+            alias = props.get(PROP_TOPIC_ALIAS)
+            if alias is not None:
+                if not 0 < alias <= self.broker.alias_max:
+                    raise ProtocolError("topic alias %d out of range" % alias)
+                if topic:
+                    self.aliases[alias] = topic
+                    self.broker.log("%s: alias %d is %s", self.client_id,
+                                    alias, topic)
+                elif alias in self.aliases:
+                    topic = self.aliases[alias]
+                    self.stats["alias_saved"] += len(topic.encode())
+                else:
+                    raise ProtocolError("unknown topic alias %d" % alias)
+        if not topic:
+            raise ProtocolError("publish without a topic")
+        self.stats["in"] += 1
+        if qos:
+            self.send(packet(PUBACK, 0, struct.pack(">H", pid)))
+        self.broker.route(self, topic, bytes(body[i:]), qos, expiry)
+
+    def on_puback(self, body):
+        pid = struct.unpack_from(">H", body, 0)[0]
+        with self.broker.lock:
+            self.inflight.pop(pid, None)
+        self.flush()
+
+    def on_subscribe(self, body):
+        pid = struct.unpack_from(">H", body, 0)[0]
+        i = 2
+        if self.version == 5:
+            _, i = read_props(body, i)
+        codes = bytearray()
+        while i < len(body):
+            filt, i = read_string(body, i)
+            qos = min(body[i] & 3, 1)
+            i += 1
+            self.subs[filt.decode("utf-8", "replace")] = qos
+            codes.append(qos)
+            self.broker.log("%s: subscribed to %s", self.client_id,
+                            filt.decode("utf-8", "replace"))
+        props = encode_props([]) if self.version == 5 else b""
+        self.send(packet(SUBACK, 0, struct.pack(">H", pid) + props +
+                         bytes(codes)))
+
+    def handle(self):
+        try:
+            ptype, flags, body = self.read_packet()
+            if ptype != CONNECT:
+                raise ProtocolError("expected CONNECT")
+            self.on_connect(body)
+            with self.broker.lock:
+                self.broker.sessions.add(self)
+            while True:
+                ptype, flags, body = self.read_packet()
+                if ptype == PUBLISH:
+                    self.on_publish(flags, body)
+                elif ptype == PUBACK:
+                    self.on_puback(body)
+                elif ptype == SUBSCRIBE:
+                    self.on_subscribe(body)
+                elif ptype == PINGREQ:
+                    self.send(packet(PINGRESP, 0, b""))
+                elif ptype == DISCONNECT:
+                    break
+                else:
+                    raise ProtocolError("unexpected packet type %d" % ptype)
+        except ProtocolError as e:
+            print("%s: protocol error: %s" % (self.client_id, e))
+        except (EOFError, socket.error):
+            pass
+        finally:
+            with self.broker.lock:
+                self.broker.sessions.discard(self)
+            self.broker.log("%s: disconnected %s", self.client_id,
+                            self.stats)
+
+
+class Server(socketserver.ThreadingTCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=11000)
+    parser.add_argument("--aliases", type=int, default=10,
+                        help="topic aliases allowed per client (default: 10)")
+    parser.add_argument("--stats", type=float, default=5.0,
+                        help="seconds between statistics, 0 for none")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    server = Server((args.host, args.port), Session)
+    server.broker = Broker(args.aliases, args.verbose)
+    print("listening on %s:%d" % (args.host, args.port))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+
+    try:
+        while True:
+            time.sleep(args.stats or 3600)
+            if not args.stats:
+                continue
+            with server.broker.lock:
+                sessions = list(server.broker.sessions)
+            for s in sessions:
+                print("%-20s in %d out %d waiting %d in flight %d "
+                      "alias bytes saved %d expired %d too big %d" %
+                      (s.client_id, s.stats["in"], s.stats["out"],
+                       len(s.waiting), len(s.inflight),
+                       s.stats["alias_saved"], s.stats["expired"],
+                       s.stats["too_big"]))
+    except KeyboardInterrupt:
+        pass
+    server.shutdown()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Time server for the robots' clock synchronization (see TimeSync.h).
+
+Run it on a computer with a good clock (NTP synchronized) next to the
+broker, so the round trips stay short:
+
+    python3 timeserver.py serve
+
+Watch how well each robot is synchronized, and the offset between the
+robots' clocks as they see each other:
+
+    python3 timeserver.py watch
+
+Convert a robot's local timestamp (e.g. from the flight recorder) to wall
+clock time with its last status:
+
+    python3 timeserver.py convert 192.168.1.23 12345678
+"""
+import argparse
+import datetime
+import struct
+import sys
+import time
+
+REQUEST_TOPIC = "m3pi-mqtt-ee250/time/request"
+RESPONSE_TOPIC_PREFIX = "m3pi-mqtt-ee250/time/"
+STATUS_TOPIC = "m3pi-mqtt-ee250/time/status"
+
+
+def now_us():
+    return int(time.time() * 1e6)
+
+
+def parse_status(payload):
+    local, synced, error, drift, ok, latency = struct.unpack(
+        "<QQIiBi", payload[:29])
+    return {"id": payload[29:].decode("ascii", "replace"), "local": local,
+            "synced": synced, "error": error, "drift": drift, "ok": ok,
+            "latency": latency, "received": now_us()}
+
+
+def connect(args):
+    import paho.mqtt.client as mqtt
+
+    client = mqtt.Client()
+    client.connect(args.host, args.port)
+    return client
+
+
+def cmd_serve(args):
+    client = connect(args)
+
+    def on_message(client, userdata, msg):
+        t2 = now_us()
+        p = bytes(msg.payload)
+        if len(p) < 9:
+            return
+        robot = p[8:].decode("ascii", "replace")
+        # t3 as late as possible, right before the publish
+        client.publish(RESPONSE_TOPIC_PREFIX + robot,
+                       p[:8] + struct.pack("<QQ", t2, now_us()))
+        if args.verbose:
+            print("%s: request at local %d us" % (robot,
+                                                   struct.unpack("<Q", p[:8])[0]))
+
+    client.on_message = on_message
+    client.subscribe(REQUEST_TOPIC)
+    print("serving time on %s" % REQUEST_TOPIC)
+    client.loop_forever()
+
+
+def cmd_watch(args):
+    client = connect(args)
+    robots = {}
+
+    def on_message(client, userdata, msg):
+        s = parse_status(bytes(msg.payload))
+        robots[s["id"]] = s
+        # how far the robot's synchronized clock is from ours, minus the
+        # time the status took to get here (unknown, so this is an upper
+        # bound)
+        behind = (s["received"] - s["synced"]) / 1000.0
+        print("%-16s %s error %7.3f ms drift %+8.3f ppm  %+8.3f ms behind us"
+              % (s["id"], "synced  " if s["ok"] else "unsynced",
+                 s["error"] / 1000.0, s["drift"] / 1000.0, behind))
+
+    client.on_message = on_message
+    client.subscribe(STATUS_TOPIC)
+    client.loop_forever()
+
+
+def cmd_convert(args):
+    client = connect(args)
+    found = []
+
+    def on_message(client, userdata, msg):
+        s = parse_status(bytes(msg.payload))
+        if s["id"] == args.robot and s["ok"]:
+            found.append(s)
+            client.disconnect()
+
+    client.on_message = on_message
+    client.subscribe(STATUS_TOPIC)
+    print("waiting for a status from %s..." % args.robot)
+    client.loop_forever()
+
+    # ignores the drift since the status, which is well under a ms per
+    # minute
+    s = found[0]
+    synced = s["synced"] + (args.local_us - s["local"])
+    print("%d us = %s" % (synced, datetime.datetime.fromtimestamp(
+        synced / 1e6).isoformat()))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="eclipse.usc.edu")
+    parser.add_argument("--port", type=int, default=11000)
+    sub = parser.add_subparsers(dest="cmd")
+
+    p = sub.add_parser("serve", help="answer time requests")
+    p.add_argument("-v", "--verbose", action="store_true")
+
+    sub.add_parser("watch", help="print the robots' time status")
+
+    p = sub.add_parser("convert", help="local robot time to wall clock time")
+    p.add_argument("robot", help="client id of the robot (its IP address)")
+    p.add_argument("local_us", type=int)
+
+    args = parser.parse_args()
+    if args.cmd == "serve":
+        return cmd_serve(args)
+    elif args.cmd == "watch":
+        return cmd_watch(args)
+    elif args.cmd == "convert":
+        return cmd_convert(args)
+    parser.print_help()
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())